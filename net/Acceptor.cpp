@@ -11,6 +11,8 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
 
 using namespace muduo;
@@ -21,6 +23,9 @@ Acceptor::Acceptor(muduo::net::EventLoop *loop, const muduo::net::InetAddress &l
           acceptSocket_(sockets::createNonblockingOrDie(listenAddr.family())),
           acceptChannel_(loop, acceptSocket_.fd()),
           listenning_(false),
+          maxAcceptsPerEvent_(1),
+          accepted_(0),
+          readEvents_(0),
           idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)) {
     assert(idleFd_ >= 0);
     // 设置服务端socket选项，并绑定到指定ip和port
@@ -52,25 +57,58 @@ void Acceptor::listen()
 }
 
 
+/*
+ * 一次可读事件中连续accept，直到EAGAIN或者接受了maxAcceptsPerEvent_个，
+ * 连接风暴时少走几轮epoll_wait，也让上层可以成批地把连接交给IO loop。
+ */
 void Acceptor::handleRead() {
     loop_->assertInLoopThread();
-    InetAddress peerAddr;
-    int connfd = acceptSocket_.accept(&peerAddr);
-    if (connfd >= 0) //新的连接成功
+    readEvents_.fetch_add(1, std::memory_order_relaxed);
+    int connfd = -1;
+    int savedErrno = 0;
+    for (int i = 0; i < maxAcceptsPerEvent_; ++i)
     {
+        InetAddress peerAddr;
+        connfd = acceptSocket_.accept(&peerAddr);
+        if (connfd < 0)
+        {
+            savedErrno = errno;
+            break;
+        }
         // string hostport = peerAddr.toIpPort();
         // LOG_TRACE << "Accepts of " << hostport;
-        if (newConnectionCallback_){
-            // 建立新的连接，调用TcpServer的回调，返回已连接的socketfd和peer端地址
-            newConnectionCallback_(connfd, peerAddr);
+        acceptedList_.push_back(std::make_pair(connfd, peerAddr));
+    }
+
+    const size_t count = acceptedList_.size();
+    if (count > 0) //新的连接成功
+    {
+        accepted_.fetch_add(static_cast<int64_t>(count), std::memory_order_relaxed);
+        if (newConnectionsCallback_)
+        {
+            newConnectionsCallback_(acceptedList_);
         }
-        else{
-            // 若上层应用TcpServer未注册新连接回调函数，则直接关闭当前连接
-            sockets::close(connfd);
+        else
+        {
+            for (const auto& item : acceptedList_)
+            {
+                if (newConnectionCallback_){
+                    // 建立新的连接，调用TcpServer的回调，返回已连接的socketfd和peer端地址
+                    newConnectionCallback_(item.first, item.second);
+                }
+                else{
+                    // 若上层应用TcpServer未注册新连接回调函数，则直接关闭当前连接
+                    sockets::close(item.first);
+                }
+            }
         }
+        acceptedList_.clear();
     }
-    else  // 连接异常，处理服务端fd耗尽
+
+    // 已经接受过连接时，EAGAIN只说明队列取空了
+    if (connfd < 0 && !(savedErrno == EAGAIN && count > 0))  // 连接异常，处理服务端fd耗尽
     {
+        errno = savedErrno;
         LOG_SYSERR << "in Acceptor::handleRead";
         // Read the section named "The special problem of
         // accept()ing when you can't" in libev's doc.
@@ -85,6 +123,15 @@ void Acceptor::handleRead() {
     }
 }
 
-
-
-
+bool Acceptor::acceptQueue(int* length, int* limit) const
+{
+    struct tcp_info info;
+    if (!acceptSocket_.getTcpInfo(&info))
+    {
+        return false;
+    }
+    // 监听socket的tcpi_unacked是accept队列的长度，tcpi_sacked是上限
+    *length = static_cast<int>(info.tcpi_unacked);
+    *limit = static_cast<int>(info.tcpi_sacked);
+    return true;
+}
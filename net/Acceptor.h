@@ -6,28 +6,53 @@
 #define MUDUO_NET_ACCEPTOR_H
 #include "Socket.h"
 #include "Channel.h"
+#include "InetAddress.h"
 
+#include <atomic>
 #include <functional>
+#include <utility>
+#include <vector>
 
 
 namespace muduo{
     namespace net{
         class EventLoop;
-        class InetAddress;
 
         class Acceptor : noncopyable{
         public:
             typedef std::function<void (int sockfd, const InetAddress&)> NewConnectionCallback;
+            // 一次可读事件中接受的所有连接
+            typedef std::vector<std::pair<int, InetAddress>> AcceptedList;
+            typedef std::function<void (const AcceptedList&)> NewConnectionsCallback;
 
             Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reuseport);
             ~Acceptor();
 
             void setNewConnectionCallback(const NewConnectionCallback& cb)
             { newConnectionCallback_ = cb; }
+            // 设置后代替NewConnectionCallback，一次可读事件接受的连接一起交出去
+            void setNewConnectionsCallback(const NewConnectionsCallback& cb)
+            { newConnectionsCallback_ = cb; }
+
+            // 每次可读事件最多accept几个连接，直到EAGAIN或者用完，默认1个（与原来相同）
+            void setMaxAcceptsPerEvent(int n)
+            { maxAcceptsPerEvent_ = n > 0 ? n : 1; }
+
+            // 统计，可以在任意线程读取
+            int64_t accepted() const { return accepted_.load(std::memory_order_relaxed); }  // 接受的连接数
+            int64_t readEvents() const { return readEvents_.load(std::memory_order_relaxed); } // 可读事件次数
+            // 从tcp_info读取accept队列当前的长度和上限（listen的backlog），可以在任意线程调用
+            bool acceptQueue(int* length, int* limit) const;
 
             bool listenning() const { return listenning_; }
             void listen();
 
+            // reuseport组的连接分配，见Socket::setIncomingCpu()和Socket::attachReusePortCpuMap()
+            bool setIncomingCpu(int cpu)
+            { return acceptSocket_.setIncomingCpu(cpu); }
+            bool attachReusePortCpuMap(const std::vector<std::vector<int>>& cpusOfIndex)
+            { return acceptSocket_.attachReusePortCpuMap(cpusOfIndex); }
+
         private:
 
             // 当有客户端发起连接时，监听channel触发读事件，
@@ -38,7 +63,12 @@ namespace muduo{
             Socket acceptSocket_; // 用于接收新连接的scoket封装
             Channel acceptChannel_;  // 封装acceptSocket_的channel，监听其上的事件
             NewConnectionCallback newConnectionCallback_; // 建立新连接时调用的回调函数
+            NewConnectionsCallback newConnectionsCallback_;
             bool listenning_;
+            int maxAcceptsPerEvent_;
+            AcceptedList acceptedList_;         // 复用空间
+            std::atomic<int64_t> accepted_;
+            std::atomic<int64_t> readEvents_;
 
             // 一个文件描述符号，用于占用一个空闲的文件描述符号，避免在调用 accept() 函数时返回一个非预期的文件描述符号。
             // idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC)
@@ -28,15 +28,20 @@ ssize_t Buffer::readFd(int fd, int* savedErrno)
 {
     // saved an ioctl()/FIONREAD call to tell how much to read
     char extrabuf[65536];
+    // when extrabuf is used, we read 128k-1 bytes at most.
+    return readFd(fd, savedErrno, extrabuf, sizeof extrabuf);
+}
+
+ssize_t Buffer::readFd(int fd, int* savedErrno, char* extrabuf, size_t extraLen)
+{
     struct iovec vec[2];
     const size_t writable = writableBytes();
     vec[0].iov_base = begin()+writerIndex_;
     vec[0].iov_len = writable;
     vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof extrabuf;
+    vec[1].iov_len = extraLen;
     // when there is enough space in this buffer, don't read into extrabuf.
-    // when extrabuf is used, we read 128k-1 bytes at most.
-    const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
+    const int iovcnt = (writable < extraLen) ? 2 : 1;
     const ssize_t n = sockets::readv(fd, vec, iovcnt);
     if (n < 0)
     {
@@ -51,9 +56,5 @@ ssize_t Buffer::readFd(int fd, int* savedErrno)
         writerIndex_ = buffer_.size();
         append(extrabuf, n - writable);
     }
-    // if (n == writable + sizeof extrabuf)
-    // {
-    //   goto line_30;
-    // }
     return n;
 }
@@ -8,6 +8,7 @@
 #include "../base/StringPiece.h"
 #include "../base/Types.h"
 #include "Endian.h"
+#include "Scan.h"
 
 #include <algorithm>
 #include <vector>
@@ -53,34 +54,46 @@ namespace muduo{
             { return begin() + readerIndex_; }
 
             // 在缓冲区中查找回车换行符（"\r\n"），如果找到了则返回指向回车换行符的位置，否则返回空指针。
+            // 查找都使用scan::中运行时选择的SIMD实现
             const char* findCRLF() const
             {
-                // FIXME: replace with memmem()?
-                const char* crlf = std::search(peek(), beginWrite(), kCRLF, kCRLF+2);
-                return crlf == beginWrite() ? NULL : crlf;
+                return scan::findCRLF(peek(), beginWrite());
             }
 
             const char* findCRLF(const char* start) const
             {
                 assert(peek() <= start);
                 assert(start <= beginWrite());
-                // FIXME: replace with memmem()?
-                const char* crlf = std::search(start, beginWrite(), kCRLF, kCRLF+2);
-                return crlf == beginWrite() ? NULL : crlf;
+                return scan::findCRLF(start, beginWrite());
+            }
+
+            // 查找"\r\n\r\n"，可以用来判断HTTP头部是否已经收全
+            const char* findCRLFCRLF() const
+            {
+                return scan::findCRLFCRLF(peek(), beginWrite());
             }
 
             const char* findEOL() const
             {
-                const void* eol = memchr(peek(), '\n', readableBytes());
-                return static_cast<const char*>(eol);
+                return scan::findByte(peek(), beginWrite(), '\n');
             }
 
             const char* findEOL(const char* start) const
             {
                 assert(peek() <= start);
                 assert(start <= beginWrite());
-                const void* eol = memchr(start, '\n', beginWrite() - start);
-                return static_cast<const char*>(eol);
+                return scan::findByte(start, beginWrite(), '\n');
+            }
+
+            const char* findChar(char c) const
+            {
+                return scan::findByte(peek(), beginWrite(), c);
+            }
+
+            // set中任意一个字符第一次出现的位置
+            const char* findAnyOf(const StringPiece& set) const
+            {
+                return scan::findAnyOf(peek(), beginWrite(), set.data(), set.size());
             }
 
             // 从缓冲区读取指定长度的内容
@@ -341,12 +354,35 @@ namespace muduo{
                 return buffer_.capacity();
             }
 
+            // 底层存储的大小（prependable + readable + writable）
+            size_t storageSize() const
+            {
+                return buffer_.size();
+            }
+
+            // 与外部的一块存储交换，用于BufferPool。只能在没有可读数据时调用，storage至少有kCheapPrepend字节
+            void swapStorage(std::vector<char>* storage)
+            {
+                assert(readableBytes() == 0);
+                assert(storage->size() >= kCheapPrepend);
+                buffer_.swap(*storage);
+                readerIndex_ = kCheapPrepend;
+                writerIndex_ = kCheapPrepend;
+            }
+
             /// Read data directly into buffer.
             ///
             /// It may implement with readv(2)
             /// @return result of read(2), @c errno is saved
             ssize_t readFd(int fd, int* savedErrno);
 
+            /// Read data directly into buffer, overflow goes to the caller-provided extrabuf
+            /// (e.g. EventLoop::readArena()) and is then appended.
+            ///
+            /// extrabuf只在可写空间小于extraLen时使用
+            /// @return result of readv(2), @c errno is saved
+            ssize_t readFd(int fd, int* savedErrno, char* extrabuf, size_t extraLen);
+
 
 
         private:
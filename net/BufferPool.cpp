@@ -0,0 +1,123 @@
+//
+// Created by fight on 2023/7/6.
+//
+
+#include "BufferPool.h"
+#include "Buffer.h"
+
+#include <assert.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t BufferPool::kDefaultMaxBytesHeld;
+const size_t BufferPool::kDefaultMaxStorageSize;
+
+BufferPool::BufferPool(size_t maxBytesHeld, size_t maxStorageSize)
+        : maxBytesHeld_(maxBytesHeld),
+          maxStorageSize_(maxStorageSize),
+          bytesHeld_(0),
+          lowWater_(0),
+          hits_(0),
+          misses_(0),
+          trimmedBytes_(0)
+{
+}
+
+BufferPool::~BufferPool() = default;
+
+bool BufferPool::isHusk(const Buffer& buf)
+{
+    return buf.storageSize() <= Buffer::kCheapPrepend;
+}
+
+void BufferPool::borrow(Buffer* buf)
+{
+    if (buf->readableBytes() != 0 || !isHusk(*buf))
+    {
+        return;
+    }
+    Storage storage;
+    if (!free_.empty())
+    {
+        ++hits_;
+        storage.swap(free_.back());
+        free_.pop_back();
+        bytesHeld_ -= storage.capacity();
+        if (free_.size() < lowWater_)
+        {
+            lowWater_ = free_.size();
+        }
+    }
+    else
+    {
+        ++misses_;
+        storage.resize(Buffer::kCheapPrepend + Buffer::kInitialSize);
+    }
+    buf->swapStorage(&storage);
+    // 换下来的是空壳，留着下次giveBack()用
+    husks_.push_back(Storage());
+    husks_.back().swap(storage);
+}
+
+void BufferPool::giveBack(Buffer* buf)
+{
+    if (buf->readableBytes() != 0 || isHusk(*buf))
+    {
+        return;
+    }
+    Storage storage;
+    if (!husks_.empty())
+    {
+        storage.swap(husks_.back());
+        husks_.pop_back();
+    }
+    else
+    {
+        storage.resize(Buffer::kCheapPrepend);
+    }
+    buf->swapStorage(&storage);
+
+    // 太大的存储，或池已满时直接释放
+    const size_t bytes = storage.capacity();
+    if (bytes <= maxStorageSize_ && bytesHeld_ + bytes <= maxBytesHeld_)
+    {
+        bytesHeld_ += bytes;
+        free_.push_back(Storage());
+        free_.back().swap(storage);
+    }
+}
+
+void BufferPool::forget(const Buffer& buf)
+{
+    if (!isHusk(buf) && !husks_.empty())
+    {
+        husks_.pop_back();
+    }
+}
+
+void BufferPool::trim()
+{
+    // lowWater_个存储整个周期都没有被用到，从最久未用的一端释放
+    release(lowWater_);
+    lowWater_ = free_.size();
+}
+
+void BufferPool::clear()
+{
+    release(free_.size());
+    lowWater_ = 0;
+}
+
+void BufferPool::release(size_t count)
+{
+    assert(count <= free_.size());
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        bytes += free_[i].capacity();
+    }
+    free_.erase(free_.begin(), free_.begin() + count);
+    bytesHeld_ -= bytes;
+    trimmedBytes_ += bytes;
+}
@@ -0,0 +1,77 @@
+//
+// Created by fight on 2023/7/6.
+//
+
+#ifndef MUDUO_NET_BUFFERPOOL_H
+#define MUDUO_NET_BUFFERPOOL_H
+
+#include "../base/noncopyable.h"
+#include "../base/Types.h"
+
+#include <vector>
+
+namespace muduo{
+    namespace net{
+        class Buffer;
+
+        /*
+         * 每个EventLoop一个的Buffer存储池，只在loop线程中使用。
+         *
+         * TcpConnection的inputBuffer_/outputBuffer_平时只保留kCheapPrepend大小的空壳，
+         * 有数据要放时borrow()从池中换上一块存储，数据处理完（读空）后giveBack()还回来。
+         * 这样空闲连接几乎不占内存，突发流量用过的大块存储在连接之间复用，而不是每个连接各自增长、直到析构才释放。
+         *
+         * 池中的存储由EventLoop定时trim()：上一个周期内一直空闲的存储被释放，
+         * 超过maxStorageSize的存储在归还时直接释放，池中总量不超过maxBytesHeld。
+         */
+        class BufferPool : noncopyable{
+        public:
+            static const size_t kDefaultMaxBytesHeld = 16*1024*1024;
+            static const size_t kDefaultMaxStorageSize = 1024*1024;
+
+            explicit BufferPool(size_t maxBytesHeld = kDefaultMaxBytesHeld,
+                                size_t maxStorageSize = kDefaultMaxStorageSize);
+            ~BufferPool();
+
+            // buf没有可读数据且只有空壳时，换上池中的一块存储；池空时新分配一块（记为miss）
+            void borrow(Buffer* buf);
+            // buf没有可读数据时把它的存储还给池，buf只保留空壳
+            void giveBack(Buffer* buf);
+            // buf借用的存储不会再还回来（比如连接销毁时还有没处理完的数据，存储随buf一起释放），
+            // 丢掉借出时为它留的空壳，否则husks_只增不减
+            void forget(const Buffer& buf);
+            // buf是否只有空壳（没有借用存储）
+            static bool isHusk(const Buffer& buf);
+
+            // 释放上次trim()以来一直没有被借出过的存储
+            void trim();
+            // 释放所有空闲存储
+            void clear();
+
+            int64_t hits() const { return hits_; }          // borrow()时池中有存储
+            int64_t misses() const { return misses_; }      // borrow()时需要新分配
+            int64_t trimmedBytes() const { return trimmedBytes_; }  // trim()释放的字节数
+            size_t bytesHeld() const { return bytesHeld_; } // 池中空闲存储的总字节数
+            size_t storagesHeld() const { return free_.size(); }
+            size_t husksHeld() const { return husks_.size(); }    // 借出未还的存储个数
+
+        private:
+            typedef std::vector<char> Storage;
+
+            void release(size_t count);
+
+            std::vector<Storage> free_;    // 空闲存储，尾部是最近归还的
+            std::vector<Storage> husks_;   // kCheapPrepend大小的空壳，与借出的存储交换
+            const size_t maxBytesHeld_;
+            const size_t maxStorageSize_;
+            size_t bytesHeld_;
+            size_t lowWater_;              // 上次trim()以来free_的最小长度
+            int64_t hits_;
+            int64_t misses_;
+            int64_t trimmedBytes_;
+        };
+
+    }
+}
+
+#endif //MUDUO_NET_BUFFERPOOL_H
@@ -0,0 +1,456 @@
+//
+// Created by fight on 2023/7/2.
+//
+
+#include "ChainBuffer.h"
+#include "Endian.h"
+#include "SocketsOpts.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <limits.h>
+#include <new>
+#include <memory>
+#include <sys/uio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t ChainBuffer::kCheapPrepend;
+const size_t ChainBuffer::kDefaultSlabSize;
+const size_t ChainBuffer::kMaxSpareSlabs;
+
+namespace
+{
+    // 一次readFd()至少提供的可读空间，与Buffer::readFd()的extrabuf保持一致
+    const size_t kReadSpace = 65536;
+    const int kMaxReadSlabs = 8;
+}
+
+/*
+ * slab的头部和数据区一次分配，数据区紧跟在头部之后。
+ * appendExternal()/appendBlock()产生的外部节点只有头部，data指向外部内存，
+ * 由owner保证其生命期，外部节点只读，不能再往里面追加或prepend。
+ * appendFile()产生的文件节点没有内存数据，表示文件fd从fileOffset开始的capacity字节，
+ * readerIndex记录已经发送的部分。
+ * 0 <= readerIndex <= writerIndex <= capacity
+ */
+struct ChainBuffer::Slab
+{
+    char* data;
+    size_t readerIndex;
+    size_t writerIndex;
+    size_t capacity;
+    int fd;              // 文件节点的fd，内存节点为-1
+    off_t fileOffset;
+    std::shared_ptr<const void> owner;
+
+    bool external() const { return static_cast<bool>(owner); }
+    bool isFile() const { return fd >= 0; }
+
+    char* begin() { return data; }
+    const char* begin() const { return data; }
+    const char* peek() const { return begin() + readerIndex; }
+    char* beginWrite() { return begin() + writerIndex; }
+
+    size_t readableBytes() const { return writerIndex - readerIndex; }
+    size_t writableBytes() const { return capacity - writerIndex; }
+};
+
+ChainBuffer::ChainBuffer(size_t slabSize)
+        : slabSize_(slabSize),
+          readable_(0)
+{
+    assert(slabSize_ > 2 * kCheapPrepend);
+}
+
+ChainBuffer::~ChainBuffer()
+{
+    for (Slab* slab : slabs_)
+    {
+        deleteSlab(slab);
+    }
+    shrink();
+}
+
+void ChainBuffer::swap(ChainBuffer& rhs)
+{
+    slabs_.swap(rhs.slabs_);
+    spare_.swap(rhs.spare_);
+    std::swap(slabSize_, rhs.slabSize_);
+    std::swap(readable_, rhs.readable_);
+}
+
+void ChainBuffer::deleteSlab(Slab* slab)
+{
+    slab->~Slab();
+    ::operator delete(slab);
+}
+
+ChainBuffer::Slab* ChainBuffer::newSlab()
+{
+    Slab* slab = NULL;
+    if (!spare_.empty())
+    {
+        slab = spare_.back();
+        spare_.pop_back();
+    }
+    else
+    {
+        void* p = ::operator new(sizeof(Slab) + slabSize_);
+        slab = new (p) Slab;
+        slab->data = reinterpret_cast<char*>(slab + 1);
+        slab->capacity = slabSize_;
+        slab->fd = -1;
+        slab->fileOffset = 0;
+    }
+    slab->readerIndex = 0;
+    slab->writerIndex = 0;
+    return slab;
+}
+
+void ChainBuffer::recycle(Slab* slab)
+{
+    if (!slab->external() && spare_.size() < kMaxSpareSlabs && slab->capacity == slabSize_)
+    {
+        spare_.push_back(slab);
+    }
+    else
+    {
+        deleteSlab(slab);
+    }
+}
+
+// 返回还有剩余空间的最后一个slab，没有则新挂一个
+ChainBuffer::Slab* ChainBuffer::tailWithRoom()
+{
+    if (slabs_.empty())
+    {
+        // 第一个slab预留kCheapPrepend，方便prepend()长度字段
+        Slab* slab = newSlab();
+        slab->readerIndex = kCheapPrepend;
+        slab->writerIndex = kCheapPrepend;
+        slabs_.push_back(slab);
+    }
+    else if (slabs_.back()->writableBytes() == 0)
+    {
+        slabs_.push_back(newSlab());
+    }
+    return slabs_.back();
+}
+
+const char* ChainBuffer::peek() const
+{
+    return slabs_.empty() ? NULL : slabs_.front()->peek();
+}
+
+size_t ChainBuffer::peekableBytes() const
+{
+    return slabs_.empty() ? 0 : slabs_.front()->readableBytes();
+}
+
+int ChainBuffer::fillIovec(struct iovec* iov, int maxSegments) const
+{
+    int n = 0;
+    for (std::vector<Slab*>::const_iterator it = slabs_.begin();
+         it != slabs_.end() && n < maxSegments; ++it)
+    {
+        const Slab* slab = *it;
+        if (slab->isFile())
+        {
+            break;
+        }
+        if (slab->readableBytes() > 0)
+        {
+            iov[n].iov_base = const_cast<char*>(slab->peek());
+            iov[n].iov_len = slab->readableBytes();
+            ++n;
+        }
+    }
+    return n;
+}
+
+void ChainBuffer::copyOut(void* dest, size_t len) const
+{
+    assert(len <= readableBytes());
+    char* d = static_cast<char*>(dest);
+    for (std::vector<Slab*>::const_iterator it = slabs_.begin(); len > 0; ++it)
+    {
+        assert(!(*it)->isFile());
+        size_t n = std::min(len, (*it)->readableBytes());
+        ::memcpy(d, (*it)->peek(), n);
+        d += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::retrieve(size_t len)
+{
+    assert(len <= readableBytes());
+    readable_ -= len;
+    // 读完的slab一次从头部删除
+    size_t done = 0;
+    while (len > 0)
+    {
+        Slab* slab = slabs_[done];
+        size_t n = std::min(len, slab->readableBytes());
+        slab->readerIndex += n;
+        len -= n;
+        if (slab->readableBytes() == 0)
+        {
+            recycle(slab);
+            ++done;
+        }
+    }
+    slabs_.erase(slabs_.begin(), slabs_.begin() + done);
+}
+
+void ChainBuffer::retrieveAll()
+{
+    for (Slab* slab : slabs_)
+    {
+        recycle(slab);
+    }
+    slabs_.clear();
+    readable_ = 0;
+}
+
+string ChainBuffer::retrieveAsString(size_t len)
+{
+    assert(len <= readableBytes());
+    string result(len, '\0');
+    if (len > 0)
+    {
+        copyOut(&*result.begin(), len);
+        retrieve(len);
+    }
+    return result;
+}
+
+void ChainBuffer::append(const char* data, size_t len)
+{
+    readable_ += len;
+    while (len > 0)
+    {
+        Slab* slab = tailWithRoom();
+        size_t n = std::min(len, slab->writableBytes());
+        ::memcpy(slab->beginWrite(), data, n);
+        slab->writerIndex += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::appendExternal(const char* data, size_t len,
+                                 const std::shared_ptr<const void>& owner)
+{
+    assert(owner);
+    if (len == 0)
+    {
+        return;
+    }
+    void* p = ::operator new(sizeof(Slab));
+    Slab* slab = new (p) Slab;
+    slab->data = const_cast<char*>(data);
+    slab->readerIndex = 0;
+    slab->writerIndex = len;
+    slab->capacity = len;
+    slab->fd = -1;
+    slab->fileOffset = 0;
+    slab->owner = owner;
+    slabs_.push_back(slab);
+    readable_ += len;
+}
+
+void ChainBuffer::appendFile(int fd, off_t offset, size_t len,
+                             const std::shared_ptr<const void>& owner)
+{
+    assert(fd >= 0 && owner);
+    if (len == 0)
+    {
+        return;
+    }
+    void* p = ::operator new(sizeof(Slab));
+    Slab* slab = new (p) Slab;
+    slab->data = NULL;
+    slab->readerIndex = 0;
+    slab->writerIndex = len;
+    slab->capacity = len;
+    slab->fd = fd;
+    slab->fileOffset = offset;
+    slab->owner = owner;
+    slabs_.push_back(slab);
+    readable_ += len;
+}
+
+std::shared_ptr<const void> ChainBuffer::peekOwner() const
+{
+    if (slabs_.empty() || !slabs_.front()->external() || slabs_.front()->isFile())
+    {
+        return std::shared_ptr<const void>();
+    }
+    return slabs_.front()->owner;
+}
+
+int ChainBuffer::peekFile(off_t* offset, size_t* len) const
+{
+    if (slabs_.empty() || !slabs_.front()->isFile())
+    {
+        return -1;
+    }
+    const Slab* slab = slabs_.front();
+    *offset = slab->fileOffset + static_cast<off_t>(slab->readerIndex);
+    *len = slab->readableBytes();
+    return slab->fd;
+}
+
+void ChainBuffer::appendBlock(const char* data, size_t len)
+{
+    std::shared_ptr<string> block(new string(data, len));
+    appendExternal(block->data(), block->size(), block);
+}
+
+/*
+ * 先用掉第一个slab头部的空闲空间，不够时在链表头插入新的slab，
+ * 新slab的数据放在末尾，这样后续的prepend()还能继续往前写。
+ */
+void ChainBuffer::prepend(const void* data, size_t len)
+{
+    const char* d = static_cast<const char*>(data);
+    readable_ += len;
+    if (!slabs_.empty() && !slabs_.front()->external() && !slabs_.front()->isFile())
+    {
+        Slab* front = slabs_.front();
+        size_t n = std::min(len, front->readerIndex);
+        front->readerIndex -= n;
+        ::memcpy(front->begin() + front->readerIndex, d + len - n, n);
+        len -= n;
+    }
+    while (len > 0)
+    {
+        Slab* slab = newSlab();
+        size_t n = std::min(len, slab->capacity);
+        slab->writerIndex = slab->capacity;
+        slab->readerIndex = slab->capacity - n;
+        ::memcpy(slab->begin() + slab->readerIndex, d + len - n, n);
+        slabs_.insert(slabs_.begin(), slab);
+        len -= n;
+    }
+}
+
+void ChainBuffer::appendInt32(int32_t x)
+{
+    int32_t be32 = sockets::hostToNetwork32(x);
+    append(&be32, sizeof be32);
+}
+
+void ChainBuffer::prependInt32(int32_t x)
+{
+    int32_t be32 = sockets::hostToNetwork32(x);
+    prepend(&be32, sizeof be32);
+}
+
+int32_t ChainBuffer::peekInt32() const
+{
+    assert(readableBytes() >= sizeof(int32_t));
+    int32_t be32 = 0;
+    copyOut(&be32, sizeof be32);
+    return sockets::networkToHost32(be32);
+}
+
+void ChainBuffer::shrink()
+{
+    for (Slab* slab : spare_)
+    {
+        deleteSlab(slab);
+    }
+    spare_.clear();
+}
+
+/*
+ * 与Buffer::readFd()一样一次readv(2)尽量多读，但不使用栈上的extrabuf：
+ * 第一块iovec指向最后一个slab的剩余空间，后面几块直接指向新取出的slab，
+ * 读到的数据就地挂到链表尾部，没有用到的slab再放回spare_。
+ */
+ssize_t ChainBuffer::readFd(int fd, int* savedErrno)
+{
+    struct iovec vec[kMaxReadSlabs + 1];
+    Slab* fresh[kMaxReadSlabs];
+    int iovcnt = 0;
+    size_t tailWritable = 0;
+    if (!slabs_.empty() && slabs_.back()->writableBytes() > 0)
+    {
+        Slab* tail = slabs_.back();
+        tailWritable = tail->writableBytes();
+        vec[0].iov_base = tail->beginWrite();
+        vec[0].iov_len = tailWritable;
+        iovcnt = 1;
+    }
+
+    int nfresh = static_cast<int>(std::min<size_t>(kMaxReadSlabs, kReadSpace / slabSize_ + 1));
+    for (int i = 0; i < nfresh; ++i)
+    {
+        fresh[i] = newSlab();
+        vec[iovcnt].iov_base = fresh[i]->begin();
+        vec[iovcnt].iov_len = fresh[i]->capacity;
+        ++iovcnt;
+    }
+
+    const ssize_t n = sockets::readv(fd, vec, iovcnt);
+    if (n < 0)
+    {
+        *savedErrno = errno;
+    }
+
+    size_t remaining = n > 0 ? static_cast<size_t>(n) : 0;
+    readable_ += remaining;
+    if (tailWritable > 0)
+    {
+        size_t m = std::min(remaining, tailWritable);
+        slabs_.back()->writerIndex += m;
+        remaining -= m;
+    }
+    for (int i = 0; i < nfresh; ++i)
+    {
+        if (remaining > 0)
+        {
+            size_t m = std::min(remaining, fresh[i]->capacity);
+            fresh[i]->writerIndex = m;
+            remaining -= m;
+            slabs_.push_back(fresh[i]);
+        }
+        else
+        {
+            recycle(fresh[i]);
+        }
+    }
+    return n;
+}
+
+// 链表头是文件节点时用sendfile(2)发送该节点，否则writev(2)发送文件节点之前的内存数据
+ssize_t ChainBuffer::writeFd(int fd, int* savedErrno)
+{
+    ssize_t n = 0;
+    off_t offset = 0;
+    size_t len = 0;
+    int filefd = peekFile(&offset, &len);
+    if (filefd >= 0)
+    {
+        n = sockets::sendfile(fd, filefd, &offset, len);
+    }
+    else
+    {
+        struct iovec vec[IOV_MAX];
+        int iovcnt = fillIovec(vec, IOV_MAX);
+        n = sockets::writev(fd, vec, iovcnt);
+    }
+    if (n < 0)
+    {
+        *savedErrno = errno;
+    }
+    else
+    {
+        retrieve(static_cast<size_t>(n));
+    }
+    return n;
+}
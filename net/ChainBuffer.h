@@ -0,0 +1,133 @@
+//
+// Created by fight on 2023/7/2.
+//
+
+#ifndef MUDUO_NET_CHAINBUFFER_H
+#define MUDUO_NET_CHAINBUFFER_H
+
+#include "../base/noncopyable.h"
+#include "../base/StringPiece.h"
+#include "../base/Types.h"
+
+#include <memory>
+#include <vector>
+
+#include <sys/types.h>
+
+struct iovec;
+
+namespace muduo{
+    namespace net{
+
+        /*
+         * ChainBuffer是Buffer的另一种表示：由若干固定大小的slab串成的链表。
+         *
+         * Buffer是一整块连续的std::vector<char>，makeSpace()要么把可读数据整体搬到前面，
+         * 要么resize()重新分配，输出缓冲区堆积到数MB时会反复memmove/realloc。
+         * ChainBuffer追加数据只写最后一个slab，写满就挂一个新slab，已有数据永远不会被移动；
+         * retrieve()读完的slab回收到spare_中复用，prepend()空间不够时在链表头插入新slab。
+         *
+         *    slab0               slab1               slab2
+         * +---+-------+      +-----------+      +-------+---+
+         * |   |xxxxxxx| ---> |xxxxxxxxxxx| ---> |xxxxxxx|   |
+         * +---+-------+      +-----------+      +-------+---+
+         *     ^peek()                                   ^tail writable
+         *
+         * 由于数据不连续，peek()只返回第一个连续段，整体发送使用fillIovec()/writeFd()走writev(2)。
+         */
+        class ChainBuffer : noncopyable{
+        public:
+            static const size_t kCheapPrepend = 8;
+            static const size_t kDefaultSlabSize = 16*1024;
+            // 空闲slab最多缓存的个数，超出部分直接释放
+            static const size_t kMaxSpareSlabs = 8;
+
+            explicit ChainBuffer(size_t slabSize = kDefaultSlabSize);
+            ~ChainBuffer();
+
+            void swap(ChainBuffer& rhs);
+
+            size_t readableBytes() const { return readable_; }
+            size_t slabSize() const { return slabSize_; }
+            size_t numSlabs() const { return slabs_.size(); }
+            // 包括空闲slab在内实际占用的内存
+            size_t internalCapacity() const { return (slabs_.size() + spare_.size()) * slabSize_; }
+
+            // 第一个连续段的起始位置和长度，没有数据时返回NULL和0
+            const char* peek() const;
+            size_t peekableBytes() const;
+
+            // 依次取出各个连续段，最多maxSegments个，遇到文件节点停止，返回填充的个数
+            int fillIovec(struct iovec* iov, int maxSegments) const;
+            // 链表头是appendExternal()/appendBlock()产生的内存节点时返回其owner，否则返回空
+            std::shared_ptr<const void> peekOwner() const;
+            // 链表头是文件节点时返回其fd，并给出待发送的文件偏移和长度；否则返回-1
+            int peekFile(off_t* offset, size_t* len) const;
+            // 拷贝前len字节到dest中（可跨越slab），不移动读位置，范围内不能有文件节点
+            void copyOut(void* dest, size_t len) const;
+
+            void retrieve(size_t len);
+            void retrieveAll();
+            string retrieveAsString(size_t len);
+            string retrieveAllAsString()
+            { return retrieveAsString(readableBytes()); }
+
+            void append(const StringPiece& str)
+            { append(str.data(), str.size()); }
+            void append(const char* /*restrict*/ data, size_t len);
+            void append(const void* /*restrict*/ data, size_t len)
+            { append(static_cast<const char*>(data), len); }
+
+            // 不拷贝数据，直接把[data, data+len)作为一个只读节点挂到链表尾部，
+            // owner负责在节点被retrieve()之前保持这块内存有效
+            void appendExternal(const char* data, size_t len,
+                                const std::shared_ptr<const void>& owner);
+            // 追加文件fd中[offset, offset+len)这一段，发送时使用sendfile(2)，数据不经过用户空间；
+            // owner负责在节点被retrieve()之前保持fd打开
+            void appendFile(int fd, off_t offset, size_t len,
+                            const std::shared_ptr<const void>& owner);
+            // 拷贝一次，数据单独占用一个节点，不与前后的数据拼接在同一个slab中，用于大块数据
+            void appendBlock(const char* data, size_t len);
+
+            // 在头部插入数据，不会移动已有数据
+            void prepend(const void* /*restrict*/ data, size_t len);
+
+            void appendInt32(int32_t x);
+            void prependInt32(int32_t x);
+            int32_t peekInt32() const;
+
+            // 释放所有空闲slab
+            void shrink();
+
+            /// Read data directly into slabs.
+            ///
+            /// 读入最后一个slab的剩余空间和若干个新slab，不需要额外拷贝
+            /// @return result of readv(2), @c errno is saved
+            ssize_t readFd(int fd, int* savedErrno);
+
+            /// Write as much data as possible with writev(2),
+            /// or sendfile(2) when a file region is at the front.
+            ///
+            /// @return result of writev(2), @c errno is saved
+            ssize_t writeFd(int fd, int* savedErrno);
+
+        private:
+            struct Slab;
+
+            static void deleteSlab(Slab* slab);
+            Slab* newSlab();
+            void recycle(Slab* slab);
+            Slab* tailWithRoom();
+
+            // 按顺序保存数据的slab。用vector而不是deque：空的deque也要分配内存，每个连接都有一个ChainBuffer；
+            // 头部删除/插入搬动的只是指针，slab个数不多
+            std::vector<Slab*> slabs_;
+            std::vector<Slab*> spare_;     // 回收后可复用的空闲slab
+            size_t slabSize_;              // 每个slab的大小
+            size_t readable_;              // 链表中所有可读数据的总长度
+        };
+
+    }
+}
+
+#endif //MUDUO_NET_CHAINBUFFER_H
@@ -8,6 +8,7 @@
 
 #include <sstream>
 #include <poll.h>
+#include <sys/epoll.h>
 
 using namespace muduo;
 using namespace muduo::net;
@@ -15,6 +16,8 @@ using namespace muduo::net;
 const int Channel::kNoneEvent = 0;
 const int Channel::kReadEvent = POLLIN | POLLPRI;
 const int Channel::kWriteEvent = POLLOUT;
+const int Channel::kRdHupEvent = POLLRDHUP;
+const int Channel::kEdgeTriggered = EPOLLET;
 
 // 监听的文件描述符 和 属于的EventLoop
 Channel::Channel(EventLoop* loop, int fd__)
@@ -85,7 +88,9 @@ void Channel::handleEventWithGuard(muduo::Timestamp receiveTime) {
     }
 
     if (revents_ & (POLLERR | POLLNVAL)){  //发生错误或者描述符不可打开
-        if (errorCallback_) errorCallback_();
+        // 错误队列中有消息时epoll同样报告EPOLLERR，交给errQueueCallback_区分是通知还是真正的错误
+        if ((revents_ & POLLERR) && errQueueCallback_) errQueueCallback_();
+        else if (errorCallback_) errorCallback_();
     }
     if (revents_ & (POLLIN | POLLPRI | POLLRDHUP)){ //关于读的事件
         if (readCallback_) readCallback_(receiveTime);
@@ -126,6 +131,8 @@ string Channel::eventsToString(int fd, int ev)
         oss << "ERR ";
     if (ev & POLLNVAL)
         oss << "NVAL ";
+    if (ev & EPOLLET)
+        oss << "ET ";
 
     return oss.str();
 }
\ No newline at end of file
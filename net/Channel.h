@@ -36,6 +36,10 @@ namespace muduo{
             { closeCallback_ = std::move(cb); }
             void setErrorCallback(EventCallback cb)
             { errorCallback_ = std::move(cb); }
+            // 设置后POLLERR先交给它处理（读取socket的错误队列，如MSG_ZEROCOPY的完成通知），
+            // 而不是直接回调errorCallback_
+            void setErrQueueCallback(EventCallback cb)
+            { errQueueCallback_ = std::move(cb); }
 
             // 将此通道绑定到由 shared_ptr 管理的所有者对象，
             // 防止所有者对象在 handleEvent 中被销毁。
@@ -43,6 +47,7 @@ namespace muduo{
 
             int fd() const { return fd_; }
             int events() const { return events_; }   //返回注册的事件
+            int revents() const { return revents_; }  // 返回发生的事件
             void set_revents(int revt) { revents_ = revt; }  // 设置发生的事件:poller中调用
 
             bool isNoneEvent() const { return events_ == kNoneEvent; } // 判断是否注册了事件
@@ -52,12 +57,19 @@ namespace muduo{
             void enableWriting()  { events_ |=  kWriteEvent; update(); } // 注册可写事件
             void disableWriting() { events_ &= ~kWriteEvent; update(); } // 注销可写事件
             void disableAll()     { events_ =   kNoneEvent;  update(); } // 注销所有事件
+            // 边沿触发：一次性注册IN|OUT|RDHUP|EPOLLET，之后不再修改，
+            // 由使用者自己记录fd是否可读/可写并读写到EAGAIN。只能用于EPollPoller
+            void enableEdgeTriggered()  { events_ = kReadEvent | kWriteEvent | kRdHupEvent | kEdgeTriggered; update(); }
+            // 回到水平触发，只保留可读事件，可写事件由调用者按需重新开启
+            void disableEdgeTriggered() { events_ &= kReadEvent; update(); }
 
 
              // 是否有可写事件
             bool isWriting() const { return events_ & kWriteEvent; }
              // 是否有可读事件
             bool isReading() const { return events_ & kReadEvent; }
+            // 是否以边沿触发方式注册
+            bool isEdgeTriggered() const { return events_ & kEdgeTriggered; }
 
             // for Poller
             int index() { return index_; }
@@ -67,6 +79,7 @@ namespace muduo{
             // for debug
             string reventsToString() const;
             string eventsToString() const;
+            static string eventsToString(int fd, int ev);
 
             void doNotLogHup() { logHup_ = false; }
 
@@ -74,14 +87,14 @@ namespace muduo{
             void remove();
 
         private:
-            static string eventsToString(int fd, int ev);
-
             void update();    // 注册事件后更新到EventLoop
             void handleEventWithGuard(Timestamp receiveTime);  // 加锁的事件处理
 
             static const int kNoneEvent;
             static const int kReadEvent;
             static const int kWriteEvent;
+            static const int kRdHupEvent;
+            static const int kEdgeTriggered;
 
             EventLoop* loop_;     // channel所属的EventLoop
             const int  fd_;       // channel负责的文件描述符，但不负责关闭该文件描述符
@@ -106,6 +119,7 @@ namespace muduo{
             EventCallback writeCallback_;     // 写事件回调
             EventCallback closeCallback_;     // 关闭事件回调
             EventCallback errorCallback_;     // 出错事件回调
+            EventCallback errQueueCallback_;  // 错误队列可读回调
 
         };
 
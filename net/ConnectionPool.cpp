@@ -0,0 +1,98 @@
+//
+// Created by fight on 2023/7/16.
+//
+
+#include "ConnectionPool.h"
+
+#include <new>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t ConnectionPool::kDefaultMaxFreeBlocks;
+
+ConnectionPool::ConnectionPool(size_t maxFreeBlocks)
+        : maxFreeBlocks_(maxFreeBlocks),
+          blockSize_(0),
+          hits_(0),
+          misses_(0)
+{
+}
+
+ConnectionPool::~ConnectionPool()
+{
+    clear();
+}
+
+void* ConnectionPool::allocate(size_t size)
+{
+    {
+        MutexLockGuard lock(mutex_);
+        if (blockSize_ == 0)
+        {
+            blockSize_ = size;
+        }
+        if (size == blockSize_)
+        {
+            if (!free_.empty())
+            {
+                ++hits_;
+                void* p = free_.back();
+                free_.pop_back();
+                return p;
+            }
+            ++misses_;
+        }
+    }
+    return ::operator new(size);
+}
+
+void ConnectionPool::deallocate(void* p, size_t size)
+{
+    {
+        MutexLockGuard lock(mutex_);
+        if (size == blockSize_ && free_.size() < maxFreeBlocks_)
+        {
+            free_.push_back(p);
+            return;
+        }
+    }
+    ::operator delete(p);
+}
+
+void ConnectionPool::clear()
+{
+    std::vector<void*> blocks;
+    {
+        MutexLockGuard lock(mutex_);
+        blocks.swap(free_);
+    }
+    for (void* p : blocks)
+    {
+        ::operator delete(p);
+    }
+}
+
+int64_t ConnectionPool::hits() const
+{
+    MutexLockGuard lock(mutex_);
+    return hits_;
+}
+
+int64_t ConnectionPool::misses() const
+{
+    MutexLockGuard lock(mutex_);
+    return misses_;
+}
+
+size_t ConnectionPool::freeBlocks() const
+{
+    MutexLockGuard lock(mutex_);
+    return free_.size();
+}
+
+size_t ConnectionPool::blockSize() const
+{
+    MutexLockGuard lock(mutex_);
+    return blockSize_;
+}
@@ -0,0 +1,89 @@
+//
+// Created by fight on 2023/7/16.
+//
+
+#ifndef MUDUO_NET_CONNECTIONPOOL_H
+#define MUDUO_NET_CONNECTIONPOOL_H
+
+#include "../base/Mutex.h"
+#include "../base/noncopyable.h"
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace muduo{
+    namespace net{
+
+        /*
+         * 每个EventLoop一个的连接对象存储池。
+         *
+         * TcpServer::setConnectionPooling()之后用std::allocate_shared()创建TcpConnection，
+         * 连接对象和shared_ptr的控制块在同一块内存中（一次分配），这块内存来自所属loop的池：
+         * 连接销毁（connectDestroyed之后最后一个TcpConnectionPtr释放）时还回池中，下一个连接直接复用。
+         * 池中的块大小固定为第一次分配的大小，其他大小的请求直接使用operator new。
+         *
+         * 最后一个TcpConnectionPtr可能在任意线程释放，所以allocate()/deallocate()加锁，
+         * 通常只有loop线程在使用，锁没有竞争。Allocator持有池的shared_ptr，池比所有的块活得久。
+         */
+        class ConnectionPool : noncopyable{
+        public:
+            static const size_t kDefaultMaxFreeBlocks = 4096;
+
+            // 给std::allocate_shared()用的分配器
+            template <typename T>
+            class Allocator
+            {
+            public:
+                typedef T value_type;
+
+                explicit Allocator(const std::shared_ptr<ConnectionPool>& pool) : pool_(pool) { }
+                template <typename U>
+                Allocator(const Allocator<U>& other) : pool_(other.pool()) { }
+
+                T* allocate(size_t n)
+                { return static_cast<T*>(pool_->allocate(n * sizeof(T))); }
+                void deallocate(T* p, size_t n)
+                { pool_->deallocate(p, n * sizeof(T)); }
+
+                const std::shared_ptr<ConnectionPool>& pool() const { return pool_; }
+
+            private:
+                std::shared_ptr<ConnectionPool> pool_;
+            };
+
+            // 最多保留maxFreeBlocks个空闲块，更多的在归还时直接释放
+            explicit ConnectionPool(size_t maxFreeBlocks = kDefaultMaxFreeBlocks);
+            ~ConnectionPool();
+
+            // 可以在任意线程调用
+            void* allocate(size_t size);
+            void deallocate(void* p, size_t size);
+            // 释放所有空闲块
+            void clear();
+
+            int64_t hits() const;           // allocate()时池中有空闲块
+            int64_t misses() const;         // allocate()时需要新分配
+            size_t freeBlocks() const;
+            size_t blockSize() const;
+
+        private:
+            mutable MutexLock mutex_;
+            const size_t maxFreeBlocks_;
+            size_t blockSize_ GUARDED_BY(mutex_);        // 0表示还没有分配过
+            std::vector<void*> free_ GUARDED_BY(mutex_);
+            int64_t hits_ GUARDED_BY(mutex_);
+            int64_t misses_ GUARDED_BY(mutex_);
+        };
+
+        template <typename T, typename U>
+        bool operator==(const ConnectionPool::Allocator<T>& lhs, const ConnectionPool::Allocator<U>& rhs)
+        { return lhs.pool() == rhs.pool(); }
+
+        template <typename T, typename U>
+        bool operator!=(const ConnectionPool::Allocator<T>& lhs, const ConnectionPool::Allocator<U>& rhs)
+        { return !(lhs == rhs); }
+    }
+}
+
+#endif //MUDUO_NET_CONNECTIONPOOL_H
@@ -5,6 +5,8 @@
 #include "../base/Mutex.h"
 
 #include "EventLoop.h"
+#include "BufferPool.h"
+#include "ConnectionPool.h"
 #include "Channel.h"
 #include "Poller.h"
 #include "TimerQueue.h"
@@ -25,6 +27,16 @@ namespace {
     __thread EventLoop *t_loopInThisThread = 0;
     const int kPollTimeMs = 10000;
 
+    // 只有loop线程写的计数，不需要原子的fetch_add
+    void addRelaxed(std::atomic<int64_t>* counter, int64_t delta){
+        counter->store(counter->load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    // 忙轮询窗口小于上限的1/64时停止空转
+    int64_t minBusyPollWindow(int64_t maxUs){
+        return std::max<int64_t>(1, maxUs / 64);
+    }
+
     int createEventfd(){
         int event_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
         if(event_fd < 0){
@@ -55,11 +67,34 @@ EventLoop::EventLoop():
     threadId_(CurrentThread::tid()),
     eventHandling_(false),
     callingPendingFunctors_(false),
+    callingIterationEnd_(false),
+    corking_(false),
+    callbackTiming_(false),
+    corkedSends_(0),
+    corkFlushes_(0),
     iteration_(0),
+    busyPollMaxUs_(0),
+    busyPollWindowUs_(0),
+    busyPollHits_(0),
+    busyPollMisses_(0),
+    spinMicroseconds_(0),
+    sleepMicroseconds_(0),
+    channelMicroseconds_(0),
+    functorMicroseconds_(0),
+    loadWindowDispatchUs_(0),
+    loadUpdatedUs_(0),
+    busyPermille_(0),
+    connectionCount_(0),
+    slowFloorUs_(0),
     poller_(Poller::newDefaultPoller(this)),
     timerQueue_(new TimerQueue(this)),
     wakeupFd_(createEventfd()),
+    sleeping_(false),
+    wakeupPending_(false),
+    wakeupsIssued_(0),
+    wakeupsSuppressed_(0),
     wakeupChannel_(new Channel(this, wakeupFd_)),
+    connectionPool_(std::make_shared<ConnectionPool>()),
     currentActiveChannel_(nullptr){
 
     LOG_TRACE << "EventLoop create" << this << " in thread" << threadId_;
@@ -93,6 +128,30 @@ EventLoop::~EventLoop(){
 }
 
 
+const size_t EventLoop::kReadArenaSize;
+
+char* EventLoop::readArena(size_t* len){
+    assertInLoopThread();
+    if(!readArena_){
+        readArena_.reset(new char[kReadArenaSize]);
+    }
+    *len = kReadArenaSize;
+    return readArena_.get();
+}
+
+const int EventLoop::kBufferPoolTrimInterval;
+const int EventLoop::kLoadWindowMs;
+const size_t EventLoop::kSlowCallbacks;
+
+BufferPool* EventLoop::bufferPool(){
+    assertInLoopThread();
+    if(!bufferPool_){
+        bufferPool_.reset(new BufferPool);
+        runEvery(kBufferPoolTrimInterval, std::bind(&BufferPool::trim, bufferPool_.get()));
+    }
+    return bufferPool_.get();
+}
+
 EventLoop* EventLoop::getEventLoopOfCurrentThread(){
     return t_loopInThisThread;
 }
@@ -112,12 +171,16 @@ void EventLoop::loop() {
     quit_ = false;
     LOG_TRACE << "EventLoop " << this << " start looping";
 
+    Timestamp iterationEnd(Timestamp::now());
+    loadWindowDispatchUs_ = dispatchMicroseconds();
+    loadUpdatedUs_.store(iterationEnd.microSecondsSinceEpoch(), std::memory_order_relaxed);
     while(!quit_){
 
         // 定期检查是否有就绪的IO事件（超时事件为kPollTimeMs = 10s）
         activeChannels_.clear();
-        pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
-        ++iteration_;
+        pollReturnTime_ = pollEvents(iterationEnd);
+        iteration_.store(iteration_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        activeChannelsHistogram_.record(static_cast<int64_t>(activeChannels_.size()));
 
         if (Logger::logLevel() <= Logger::TRACE)
         {
@@ -126,20 +189,137 @@ void EventLoop::loop() {
 
         // 依次处理有就绪的IO事件的回调
         eventHandling_ = true;    // IO事件处理标志
+        Timestamp start(pollReturnTime_);
         for (Channel* channel : activeChannels_)
         {
+            // 回调中channel可能被销毁，先记下fd和事件
+            const int fd = channel->fd();
+            const int revents = channel->revents();
             currentActiveChannel_ = channel;
             currentActiveChannel_->handleEvent(pollReturnTime_);
+            if (callbackTiming_)
+            {
+                start = finishCallback(start, fd, revents, NULL);
+            }
         }
         currentActiveChannel_ = NULL ;
         eventHandling_ = false;
+        if (!callbackTiming_)
+        {
+            start = Timestamp::now();
+        }
+        addRelaxed(&channelMicroseconds_, start.microSecondsSinceEpoch() - pollReturnTime_.microSecondsSinceEpoch());
         doPendingFunctors();
+        doIterationEndCallbacks();
 
+        iterationEnd = Timestamp::now();
+        addRelaxed(&functorMicroseconds_, iterationEnd.microSecondsSinceEpoch() - start.microSecondsSinceEpoch());
+        if (iterationEnd.microSecondsSinceEpoch() - loadUpdatedUs_.load(std::memory_order_relaxed)
+            >= kLoadWindowMs * 1000)
+        {
+            updateBusyRatio(iterationEnd);
+        }
     }
     LOG_TRACE << "EventLoop " << this << " stop looping";
     looping_ = false;
 }
 
+void EventLoop::updateBusyRatio(Timestamp now)
+{
+    const int64_t elapsed = now.microSecondsSinceEpoch() - loadUpdatedUs_.load(std::memory_order_relaxed);
+    const int64_t busy = dispatchMicroseconds() - loadWindowDispatchUs_;
+    const int sample = static_cast<int>(std::min<int64_t>(1000, busy * 1000 / std::max<int64_t>(1, elapsed)));
+    // 新旧各占一半，几个窗口内就能反映负载的变化
+    busyPermille_.store((busyPermille_.load(std::memory_order_relaxed) + sample) / 2, std::memory_order_relaxed);
+    loadWindowDispatchUs_ = dispatchMicroseconds();
+    loadUpdatedUs_.store(now.microSecondsSinceEpoch(), std::memory_order_relaxed);
+}
+
+double EventLoop::busyRatio() const
+{
+    double ratio = busyPermille_.load(std::memory_order_relaxed) / 1000.0;
+    const int64_t window = kLoadWindowMs * 1000;
+    const int64_t since = Timestamp::now().microSecondsSinceEpoch() - loadUpdatedUs_.load(std::memory_order_relaxed);
+    // 阻塞在poll中说明这段时间空闲；不在poll中时是正在处理一批很长的事件，保持原值
+    if (since > window && sleeping_.load(std::memory_order_relaxed))
+    {
+        ratio = ratio * static_cast<double>(window) / static_cast<double>(since);
+    }
+    return ratio;
+}
+
+Timestamp EventLoop::pollEvents(Timestamp start)
+{
+    bool spun = false;
+    const int64_t window = busyPollWindow();
+    if (window > 0 && !hasPendingWork())
+    {
+        // 空转期间sleeping_为false，其他线程queueInLoop()不写eventfd，靠这里检查hasPendingWork()
+        const int64_t deadline = start.microSecondsSinceEpoch() + window;
+        Timestamp now;
+        do
+        {
+            now = poller_->poll(0, &activeChannels_);
+            if (!activeChannels_.empty() || hasPendingWork())
+            {
+                addRelaxed(&spinMicroseconds_, now.microSecondsSinceEpoch() - start.microSecondsSinceEpoch());
+                addRelaxed(&busyPollHits_, 1);
+                adjustBusyPollWindow(true);
+                return now;
+            }
+        } while (now.microSecondsSinceEpoch() < deadline && !quit_);
+        addRelaxed(&spinMicroseconds_, now.microSecondsSinceEpoch() - start.microSecondsSinceEpoch());
+        addRelaxed(&busyPollMisses_, 1);
+        start = now;
+        spun = true;
+    }
+
+    // 先公布即将阻塞，再检查是否还有回调没执行：queueInLoop()那边先提交再检查sleeping_，
+    // 两边都有fence，要么这里看到新的回调不阻塞，要么对方看到sleeping_而写eventfd
+    sleeping_.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int timeoutMs = hasPendingWork() || quit_ ? 0 : kPollTimeMs;
+    Timestamp now(poller_->poll(timeoutMs, &activeChannels_));
+    sleeping_.store(false, std::memory_order_relaxed);
+
+    const int64_t slept = now.microSecondsSinceEpoch() - start.microSecondsSinceEpoch();
+    addRelaxed(&sleepMicroseconds_, slept);
+    if (busyPollMaxUs_ > 0 && timeoutMs != 0)
+    {
+        // 窗口已经关闭时也按睡眠时长判断事件是否重新变密；空转过但没等到时，
+        // 睡眠时长就是窗口之后还要再等多久
+        if (spun || busyPollWindow() == 0)
+        {
+            adjustBusyPollWindow(slept < busyPollMaxUs_);
+        }
+    }
+    return now;
+}
+
+void EventLoop::adjustBusyPollWindow(bool grow)
+{
+    int64_t window = busyPollWindow();
+    if (grow)
+    {
+        window = std::min(busyPollMaxUs_, std::max(window * 2, minBusyPollWindow(busyPollMaxUs_)));
+    }
+    else
+    {
+        window /= 2;
+        if (window < minBusyPollWindow(busyPollMaxUs_))
+        {
+            window = 0;
+        }
+    }
+    busyPollWindowUs_.store(window, std::memory_order_relaxed);
+}
+
+void EventLoop::setBusyPoll(int64_t microseconds)
+{
+    busyPollMaxUs_ = std::max<int64_t>(0, microseconds);
+    busyPollWindowUs_.store(busyPollMaxUs_, std::memory_order_relaxed);
+}
+
 void EventLoop::quit()
 {
     quit_ = true;
@@ -152,7 +332,7 @@ void EventLoop::quit()
     }
 }
 
-void EventLoop::runInLoop(Functor cb)
+void EventLoop::runInLoop(Task cb)
 {
     // 是当前线程的任务，就直接执行
     if(isInLoopThread()){
@@ -166,23 +346,46 @@ void EventLoop::runInLoop(Functor cb)
 
 /*
  * 由于IO线程平时阻塞在时间循环EventLoop::loop()中的poll函数上，
- * 为能让IO线程立刻执行用户回调，需要执行唤醒操作，有两种情况。
- * 第一种，是在其他线程调用，必须唤醒，否则阻塞直到超时才执行。
- * 第二种，在当前IO线程，但Loop正处理任务队列的任务，
- * Functor可能再调用queueInLoop，
- * 这种情况就必须执行wakeup，否则新加入到pendingFunctors_的cb就不能及时执行。
+ * 为能让IO线程立刻执行用户回调，需要执行唤醒操作。
+ *
+ * loop在poll之前会检查队列，所以只有loop已经（或即将）阻塞在poll中时才需要唤醒：
+ * 在loop线程中提交的回调（比如在pendingFunctors或迭代结束的回调中再调用queueInLoop）不需要唤醒；
+ * 其他线程提交时，loop正在处理事件，或者别的线程已经写过eventfd而loop还没有取走回调，也不需要再写。
  */
-void EventLoop::queueInLoop(Functor cb)
+void EventLoop::queueInLoop(Task cb)
 {
+    pendingFunctors_.push(std::move(cb));
+
+    if (isInLoopThread())
     {
-        MutexLockGuard lock(mutex_);
-        pendingFunctors_.push_back(std::move(cb));
+        if (callingPendingFunctors_ || callingIterationEnd_)
+        {
+            wakeupsSuppressed_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
     }
-
-    if (!isInLoopThread() || callingPendingFunctors_)
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed) &&
+        !wakeupPending_.exchange(true))
     {
         wakeup();
     }
+    else
+    {
+        wakeupsSuppressed_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void EventLoop::runAtIterationEnd(Functor cb)
+{
+    assertInLoopThread();
+    iterationEndCallbacks_.push_back(std::move(cb));
+    // 不是在处理IO事件或pendingFunctors时登记的（比如本身就在迭代结束的回调里），
+    // 由loop()在poll之前的hasPendingWork()检查到，下一轮不阻塞，不需要写eventfd
+    if (!eventHandling_ && !callingPendingFunctors_)
+    {
+        wakeupsSuppressed_.fetch_add(1, std::memory_order_relaxed);
+    }
 }
 
 
@@ -208,6 +411,11 @@ void EventLoop::cancel(TimerId timerId)
     return timerQueue_->cancel(timerId);
 }
 
+bool EventLoop::useTimingWheel(double tickSeconds)
+{
+    return timerQueue_->useTimingWheel(tickSeconds);
+}
+
 
 /*
  * Channel对象构造后，需要至少设置一个关注事件及其回调函数，设置关注事件内部会调用EventLoop::updateChannel(this)，将其注册到Poller上；
@@ -241,26 +449,146 @@ bool EventLoop::hasChannel(Channel* channel)
     return poller_->hasChannel(channel);
 }
 
+bool EventLoop::supportsEdgeTriggered() const
+{
+    return poller_->supportsEdgeTriggered();
+}
+
+int64_t EventLoop::pollerCtlCalls() const
+{
+    return poller_->ctlCalls();
+}
+
+const char* EventLoop::pollerName() const
+{
+    return poller_->name();
+}
+
+bool EventLoop::setBatchedPollerUpdates(bool on)
+{
+    assertInLoopThread();
+    return poller_->setBatchedUpdates(on);
+}
+
 
+/*
+ * 一次取出队列中已经提交的所有回调再依次执行，执行过程中新提交的回调留到下一轮，
+ * 与原来swap整个vector的语义相同。runningFunctors_的空间重复使用。
+ */
 void EventLoop::doPendingFunctors()
 {
-    std::vector<Functor> functors;
     callingPendingFunctors_ = true;
-
+    // 先清除wakeupPending_再取回调：之后提交的回调如果没有被这次取到，提交者一定会看到false而重新唤醒
+    if (wakeupPending_.load(std::memory_order_relaxed))
     {
-        MutexLockGuard lock(mutex_);
-        functors.swap(pendingFunctors_);
+        wakeupPending_.store(false);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
     }
+    pendingFunctors_.popAll(&runningFunctors_);
+    queueDepth_.record(static_cast<int64_t>(runningFunctors_.size()));
 
-    for (const Functor& functor : functors)
+    Timestamp start(callbackTiming_ && !runningFunctors_.empty() ? Timestamp::now() : Timestamp());
+    for (Task& functor : runningFunctors_)
     {
         functor();
+        if (callbackTiming_)
+        {
+            start = finishCallback(start, -1, 0, "functor");
+        }
     }
+    runningFunctors_.clear();
     callingPendingFunctors_ = false;
 }
 
+void EventLoop::doIterationEndCallbacks()
+{
+    if (iterationEndCallbacks_.empty())
+    {
+        return;
+    }
+    std::vector<Functor> callbacks;
+    callbacks.swap(iterationEndCallbacks_);
+    callingIterationEnd_ = true;
+    Timestamp start(callbackTiming_ ? Timestamp::now() : Timestamp());
+    for (const Functor& cb : callbacks)
+    {
+        cb();
+        if (callbackTiming_)
+        {
+            start = finishCallback(start, -1, 0, "iteration end");
+        }
+    }
+    callingIterationEnd_ = false;
+}
+
+/*
+ * 每个回调的耗时记入直方图；比保留的最慢回调中最短的还要长时才加锁更新slowest_，
+ * 描述字符串也只在这时生成，平时只多一次读时钟
+ */
+Timestamp EventLoop::finishCallback(Timestamp start, int fd, int revents, const char* what)
+{
+    Timestamp end(Timestamp::now());
+    if (!start.valid())
+    {
+        // 在这一批回调中途才setCallbackTiming(true)
+        return end;
+    }
+    const int64_t us = end.microSecondsSinceEpoch() - start.microSecondsSinceEpoch();
+    callbackUs_.record(us);
+    if (us > slowFloorUs_)
+    {
+        SlowCallback slow;
+        slow.when = start;
+        slow.microseconds = us;
+        slow.what = fd >= 0 ? "fd " + Channel::eventsToString(fd, revents) : what;
+        MutexLockGuard lock(slowMutex_);
+        auto pos = std::find_if(slowest_.begin(), slowest_.end(),
+                                [us](const SlowCallback& s) { return s.microseconds < us; });
+        slowest_.insert(pos, std::move(slow));
+        if (slowest_.size() > kSlowCallbacks)
+        {
+            slowest_.pop_back();
+        }
+        if (slowest_.size() == kSlowCallbacks)
+        {
+            slowFloorUs_ = slowest_.back().microseconds;
+        }
+    }
+    return end;
+}
+
+LoopStats EventLoop::stats() const
+{
+    LoopStats s;
+    s.loop = const_cast<EventLoop*>(this);
+    s.sampled = Timestamp::now();
+    s.iterations = iterations();
+    // 空转和阻塞合起来是等待事件的时间
+    s.pollMicroseconds = spinMicroseconds() + sleepMicroseconds();
+    s.channelMicroseconds = channelMicroseconds();
+    s.functorMicroseconds = functorMicroseconds();
+    s.connections = connectionCount();
+    s.queued = queueSize();
+    s.busyRatio = busyRatio();
+    s.activeChannels = activeChannelsHistogram_.summary();
+    s.queueDepth = queueDepth_.summary();
+    s.callbackMicroseconds = callbackUs_.summary();
+    s.timerLagMicroseconds = timerLag_.summary();
+    {
+        MutexLockGuard lock(slowMutex_);
+        s.slowest = slowest_;
+    }
+    return s;
+}
+
+bool EventLoop::hasPendingWork() const
+{
+    return !pendingFunctors_.empty() || !iterationEndCallbacks_.empty();
+}
+
 void EventLoop::wakeup() const
 {
+    wakeupsIssued_.fetch_add(1, std::memory_order_relaxed);
     uint64_t one = 1;
     ssize_t n = sockets::write(wakeupFd_, &one, sizeof one);
     if (n != sizeof one)
@@ -7,6 +7,7 @@
 
 #include <atomic>
 #include <functional>
+#include <memory>
 #include <vector>
 #include <boost/any.hpp>
 
@@ -14,11 +15,15 @@
 #include "../base/CurrentThread.h"
 #include "../base/Timestamp.h"
 #include "Callbacks.h"
+#include "LoopStats.h"
+#include "TaskQueue.h"
 #include "TimerId.h"
 
 namespace muduo{
     namespace net{
+        class BufferPool;
         class Channel;
+        class ConnectionPool;
         class Poller;
         class TimerQueue;
 
@@ -44,6 +49,9 @@ namespace muduo{
 
             static EventLoop* getEventLoopOfCurrentThread();
 
+            // 本轮poll返回的时刻，处理IO事件时可以代替Timestamp::now()
+            Timestamp pollReturnTime() const { return pollReturnTime_; }
+
 
 
             //在循环线程中立即运行回调。
@@ -59,13 +67,21 @@ namespace muduo{
              * 以调用runInLoop函数，并将需要执行的操作封装为一个Functor对象（即一个可调用对象），
              * 作为参数传递给runInLoop函数。runInLoop函数会将这个Functor对象添加到I/O线程的任务队列中，等待I/O线程在下一个事件循环中执行。
              */
-            void runInLoop(Functor cb);
+            void runInLoop(Task cb);
 
             /*
              * 在循环线程中排队回调。
              * 在完成池化后运行。
+             * 回调保存在无锁的TaskQueue中，较小的闭包不分配内存。
              */
-            void queueInLoop(Functor cb);
+            void queueInLoop(Task cb);
+            // 等待执行的回调个数（近似值），可以在任意线程调用
+            size_t queueSize() const { return pendingFunctors_.sizeApprox(); }
+
+            // 唤醒合并：loop公布自己是否阻塞在poll中、是否已经有一次唤醒在路上，
+            // 其他线程queueInLoop()时只在确实需要时才写eventfd
+            int64_t wakeupsIssued() const { return wakeupsIssued_.load(std::memory_order_relaxed); }       // 实际写eventfd的次数
+            int64_t wakeupsSuppressed() const { return wakeupsSuppressed_.load(std::memory_order_relaxed); } // 省掉的唤醒次数
 
 
             //在指定时间戳time处添加一个定时器，并在定时器超时时执行回调函数cb
@@ -76,7 +92,85 @@ namespace muduo{
             TimerId runEvery(double interval, TimerCallback cb);
             //关闭计时器
             void cancel(TimerId timerId);
-
+            // 定时器改用分层时间轮保存，精度为tickSeconds秒，插入/取消O(1)、复用Timer对象，
+            // 适合大量连接各自带超时的场景。只能在loop线程中、添加任何定时器之前调用，见TimerQueue::useTimingWheel()
+            bool useTimingWheel(double tickSeconds = 0.001);
+
+
+            // 本轮迭代结束时（IO事件和pendingFunctors都处理完之后）在loop线程中执行cb，只能在loop线程中调用
+            void runAtIterationEnd(Functor cb);
+
+            // cork模式：loop线程中的TcpConnection::send()先暂存，本轮迭代结束时
+            // 每个有数据的连接只用一次write/writev发出，减少小包和系统调用。只影响本loop上的连接
+            void setCorking(bool on) { corking_ = on; }
+            bool corking() const { return corking_; }
+            int64_t corkedSends() const { return corkedSends_; }    // 被暂存的send次数
+            int64_t corkFlushes() const { return corkFlushes_; }    // 实际flush的次数
+            int64_t corkSyscallsSaved() const { return corkedSends_ - corkFlushes_; }
+            /// Internal use only.
+            void countCorkedSend() { ++corkedSends_; }
+            void countCorkFlush() { ++corkFlushes_; }
+
+            // 忙轮询：阻塞在poll之前，先用0超时的poll空转最多microseconds微秒，省掉睡眠和唤醒的延迟，0表示关闭。
+            // 实际的空转窗口按最近的事件间隔自适应：空转中等到了事件，或者阻塞后很快（不到microseconds）就有事件，
+            // 说明事件来得密，窗口加倍；阻塞了更久才有事件就减半，减到很小时停止空转，直到事件重新变密。
+            // 只能在loop线程中或loop()之前调用
+            void setBusyPoll(int64_t microseconds);
+            // 以下统计只有loop线程写，可以在任意线程读取
+            int64_t busyPollWindow() const { return busyPollWindowUs_.load(std::memory_order_relaxed); }   // 当前的空转窗口（微秒）
+            int64_t busyPollHits() const { return busyPollHits_.load(std::memory_order_relaxed); }         // 空转期间等到事件的次数
+            int64_t busyPollMisses() const { return busyPollMisses_.load(std::memory_order_relaxed); }     // 空转到窗口结束仍转入阻塞的次数
+            // loop()中的时间分布（微秒）：空转poll、阻塞poll、处理事件和回调
+            int64_t spinMicroseconds() const { return spinMicroseconds_.load(std::memory_order_relaxed); }
+            int64_t sleepMicroseconds() const { return sleepMicroseconds_.load(std::memory_order_relaxed); }
+            int64_t dispatchMicroseconds() const { return channelMicroseconds() + functorMicroseconds(); }
+            // 处理事件和回调的时间再分为：处理IO事件（包括定时器回调），执行pendingFunctors和迭代结束的回调
+            int64_t channelMicroseconds() const { return channelMicroseconds_.load(std::memory_order_relaxed); }
+            int64_t functorMicroseconds() const { return functorMicroseconds_.load(std::memory_order_relaxed); }
+
+            // 负载信号，由loop自己顺带维护，可以在任意线程读取，EventLoopThreadPool按它们分配新连接
+            // 属于这个loop的TcpConnection个数：构造时加一，析构时减一（最后一个TcpConnectionPtr可能在任意线程释放）
+            int connectionCount() const { return connectionCount_.load(std::memory_order_relaxed); }
+            // 最近处理事件和回调的时间占比（0~1），每kLoadWindowMs毫秒在迭代结束时更新并平滑；
+            // loop阻塞在poll中、很久没有更新时按经过的时间衰减
+            static const int kLoadWindowMs = 100;
+            double busyRatio() const;
+            /// Internal use only.
+            void countConnection(int delta) { connectionCount_.fetch_add(delta, std::memory_order_relaxed); }
+
+            // 运行统计（见LoopStats），loop线程顺带维护，每轮迭代多读一次时钟；可以在任意线程调用
+            LoopStats stats() const;
+            int64_t iterations() const { return iteration_.load(std::memory_order_relaxed); }
+            // 逐个统计IO事件、回调的耗时（stats().callbackMicroseconds和slowest），每个回调多读一次时钟，默认关闭。
+            // 只能在loop线程中或loop()之前调用
+            void setCallbackTiming(bool on) { callbackTiming_ = on; }
+            bool callbackTiming() const { return callbackTiming_; }
+            // stats().slowest保留的个数
+            static const size_t kSlowCallbacks = 8;
+            /// Internal use only.
+            void recordTimerLag(int64_t microseconds) { timerLag_.record(microseconds); }
+
+            // loop线程内所有连接共享的读缓冲，TcpConnection::handleRead()中
+            // inputBuffer_放不下的数据先读到这里再追加，代替每次在栈上准备64KB。第一次使用时分配
+            static const size_t kReadArenaSize = 256*1024;
+            char* readArena(size_t* len);
+
+            // loop线程内连接共享的Buffer存储池，第一次使用时创建，并每隔kBufferPoolTrimInterval秒trim()一次
+            static const int kBufferPoolTrimInterval = 10;
+            BufferPool* bufferPool();
+            // 本loop上连接对象的存储池（见TcpServer::setConnectionPooling()），构造时创建，可以在任意线程调用
+            const std::shared_ptr<ConnectionPool>& connectionPool() const
+            { return connectionPool_; }
+
+            // 当前Poller是否支持边沿触发（MUDUO_USE_POLL时不支持）
+            bool supportsEdgeTriggered() const;
+            // Poller注册/修改/删除事件的系统调用次数，用来观察LT模式下反复开关可写事件的开销
+            int64_t pollerCtlCalls() const;
+            // 当前使用的Poller后端，见Poller::newDefaultPoller()
+            const char* pollerName() const;
+            // 本轮迭代中的注册修改（开关可写事件等）推迟到下一次poll之前，按净变化提交，
+            // 返回Poller是否支持，见Poller::setBatchedUpdates()。只能在loop线程中调用
+            bool setBatchedPollerUpdates(bool on);
 
             // 内部使用
             void wakeup() const;
@@ -89,6 +183,18 @@ namespace muduo{
             void handleRead() const; // waked up;
             // 执行待执行的函数事件
             void doPendingFunctors();
+            // 执行runAtIterationEnd()登记的回调
+            void doIterationEndCallbacks();
+            // 是否还有要在下一轮迭代中执行的回调，决定poll()是否阻塞
+            bool hasPendingWork() const;
+            // 等待IO事件：忙轮询打开时先空转，再阻塞，返回poll返回的时刻
+            Timestamp pollEvents(Timestamp start);
+            // 根据这一轮等到事件的方式调整忙轮询窗口
+            void adjustBusyPollWindow(bool grow);
+            // 结束一个负载统计窗口，更新busyPermille_
+            void updateBusyRatio(Timestamp now);
+            // 一个IO事件（fd >= 0）或回调执行完，记录耗时，返回结束时刻，即下一个回调的开始时刻
+            Timestamp finishCallback(Timestamp start, int fd, int revents, const char* what);
 
 
             typedef std::vector<Channel*> ChannelList;
@@ -97,7 +203,32 @@ namespace muduo{
             std::atomic<bool> quit_;    // 是否退出 终止了
             bool eventHandling_;        // 是否正在处理I/O事件
             bool callingPendingFunctors_;   // 是否处理待处理的函数
-            int64_t iteration_;         // 处理I/O的次数
+            bool callingIterationEnd_;      // 是否正在执行本轮迭代结束时的回调
+            bool corking_;                  // cork模式
+            bool callbackTiming_;           // 是否逐个统计回调耗时
+            int64_t corkedSends_;
+            int64_t corkFlushes_;
+            std::atomic<int64_t> iteration_;    // 处理I/O的次数
+            int64_t busyPollMaxUs_;     // setBusyPoll()设置的空转窗口上限
+            std::atomic<int64_t> busyPollWindowUs_;     // 当前的空转窗口
+            std::atomic<int64_t> busyPollHits_;
+            std::atomic<int64_t> busyPollMisses_;
+            std::atomic<int64_t> spinMicroseconds_;
+            std::atomic<int64_t> sleepMicroseconds_;
+            std::atomic<int64_t> channelMicroseconds_;
+            std::atomic<int64_t> functorMicroseconds_;
+            int64_t loadWindowDispatchUs_;              // 当前负载窗口开始时的dispatchMicroseconds()
+            std::atomic<int64_t> loadUpdatedUs_;        // 当前负载窗口开始（上一次更新）的时刻
+            std::atomic<int> busyPermille_;             // 平滑后的忙碌比例，千分之一
+            std::atomic<int> connectionCount_;
+            // 运行统计，只有loop线程写
+            Histogram activeChannelsHistogram_;
+            Histogram queueDepth_;
+            Histogram callbackUs_;
+            Histogram timerLag_;
+            int64_t slowFloorUs_;                       // slowest_已满时其中最短的耗时，更短的不用加锁比较
+            mutable MutexLock slowMutex_;
+            std::vector<SlowCallback> slowest_ GUARDED_BY(slowMutex_);  // 从长到短
             const pid_t threadId_;      // 当前thread id
 
             Timestamp pollReturnTime_;                  //
@@ -106,17 +237,26 @@ namespace muduo{
             std::unique_ptr<TimerQueue> timerQueue_;    // TimerQueue对象(timerfd封装的channel)
 
             int wakeupFd_;              // eventfd描述符，用于唤醒阻塞的poll
+            std::atomic<bool> sleeping_;        // loop即将或正在阻塞在poll中
+            std::atomic<bool> wakeupPending_;   // 已经写过eventfd，loop还没有取走回调
+            mutable std::atomic<int64_t> wakeupsIssued_;
+            std::atomic<int64_t> wakeupsSuppressed_;
             std::unique_ptr<Channel> wakeupChannel_;
             boost::any context_;
+            std::unique_ptr<char[]> readArena_;
+            std::unique_ptr<BufferPool> bufferPool_;
+            const std::shared_ptr<ConnectionPool> connectionPool_;
 
             // 暂存变量
             ChannelList activeChannels_;
             Channel* currentActiveChannel_;
 
-            mutable MutexLock mutex_;
-
-            //待执行的函数队列
-            std::vector<Functor> pendingFunctors_ GUARDED_BY(mutex_);
+            //待执行的函数队列，多个线程提交，只有loop线程取出
+            TaskQueue pendingFunctors_;
+            // doPendingFunctors()每次取出的回调，复用它的空间
+            std::vector<Task> runningFunctors_;
+            // 本轮迭代结束时执行的回调，只在loop线程中访问
+            std::vector<Functor> iterationEndCallbacks_;
 
 
             void printActiveChannels() const;
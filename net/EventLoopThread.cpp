@@ -41,17 +41,22 @@ EventLoop* EventLoopThread::startLoop()
 
 void EventLoopThread::threadFunc()
 {
+    // 先绑定再创建EventLoop，loop和之后在这个线程中分配的内存都在绑定的节点上
+    LoopPlacement::bindCurrentThread(placement_);
     EventLoop loop;  // 线程中创建一个EventLoop对象
 
     if (callback_){
         callback_(&loop);  // 执行初始化回调函数
     }
 
-    {
-        MutexLockGuard lock(mutex_);
-        loop_ = &loop;
-        cond_.notify();  // 初始化成功，通知用户启动成功
-    }
+    // 在第一轮迭代中才通知，保证startLoop()返回时loop()已经开始运行，
+    // 否则紧接着调用的quit()会被loop()开头的quit_ = false覆盖，线程永远不会退出
+    loop.queueInLoop([this, &loop]
+                     {
+                         MutexLockGuard lock(mutex_);
+                         loop_ = &loop;
+                         cond_.notify();  // 初始化成功，通知用户启动成功
+                     });
 
     loop.loop();		// 线程中执行事件循环
     //assert(exiting_);
@@ -8,6 +8,7 @@
 #include "../base/Mutex.h"
 #include "../base/Condition.h"
 #include "../base/Thread.h"
+#include "LoopPlacement.h"
 
 namespace muduo{
     namespace net{
@@ -21,6 +22,8 @@ namespace muduo{
                             const string& name = string());
             ~EventLoopThread();
             EventLoop* startLoop();
+            // 线程启动后、创建EventLoop之前把自己绑定到slot，需在startLoop()前调用
+            void setPlacement(const CpuSlot& slot) { placement_ = slot; }
 
         private:
             void threadFunc();
@@ -31,6 +34,7 @@ namespace muduo{
             MutexLock mutex_;       // 锁
             Condition cond_ GUARDED_BY(mutex_);  // 初始化的条件变量
             ThreadInitCallback callback_;        // 线程的初始化回调函数
+            CpuSlot placement_;                  // 绑定的CPU和NUMA节点，默认不绑定
         };
 
 
@@ -5,7 +5,9 @@
 #include "EventLoopThreadPool.h"
 #include "EventLoopThread.h"
 #include "EventLoop.h"
+#include "../base/Logging.h"
 
+#include <algorithm>
 #include <stdio.h>
 
 using namespace muduo;
@@ -16,7 +18,8 @@ EventLoopThreadPool::EventLoopThreadPool(EventLoop* baseLoop, const string& name
           name_(nameArg),
           started_(false),
           numThreads_(0),
-          next_(0)
+          next_(0),
+          policy_(kRoundRobin)
 {
 }
 
@@ -31,12 +34,23 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb) {
 
     started_ = true;
 
+    slots_ = placement_.assign(numThreads_);
+    if (placement_.policy() != LoopPlacement::kNone && slots_.empty() && numThreads_ > 0){
+        LOG_WARN << "EventLoopThreadPool [" << name_ << "] - placement " << placement_.policyName()
+                 << " found no usable cpu, loops are not bound";
+    }
+
     for(int i = 0; i < numThreads_; i++){
         char buf[name_.size()+32];
         snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
 
         // 调用回调函数创建一个EventLoopThread
         EventLoopThread* t = new EventLoopThread(cb,name_);
+        if (implicit_cast<size_t>(i) < slots_.size()){
+            t->setPlacement(slots_[i]);
+            LOG_INFO << "EventLoopThreadPool [" << name_ << "] placement " << placement_.policyName()
+                     << " - loop " << i << " -> " << LoopPlacement::toString(slots_[i]);
+        }
         // EventLoopThread进入队列
         threads_.push_back(std::unique_ptr<EventLoopThread>(t));
         // EventLoop进入队列
@@ -54,22 +68,110 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb) {
 }
 
 
+constexpr double EventLoopThreadPool::kBusyTolerance;
+
 EventLoop *EventLoopThreadPool::getNextLoop() {
     baseLoop_->assertInLoopThread();
     assert(started_);
     EventLoop* loop = baseLoop_;
 
-    if(!loops_.empty()){
-        loop =loops_[next_];
-        ++next_;
-        if(implicit_cast<size_t>(next_) >= loops_.size()){
-            next_ = 0;
+    if(loops_.empty()){
+        return loop;
+    }
+    if(dispatchFunction_){
+        return dispatchFunction_(loops_);
+    }
+
+    size_t index = next_;
+    switch (policy_){
+        case kLeastConnections:
+            index = pickLowest([this](size_t i) { return loops_[i]->connectionCount(); });
+            break;
+        case kShortestQueue:
+            index = pickLowest([this](size_t i) { return loops_[i]->queueSize(); });
+            break;
+        case kLeastBusy:{
+            // 先找出最低的忙碌比例，容差内的loop再按连接数比较
+            std::vector<double> busy(loops_.size());
+            double lowest = 1.0;
+            for(size_t i = 0; i < loops_.size(); ++i){
+                busy[i] = loops_[i]->busyRatio();
+                lowest = std::min(lowest, busy[i]);
+            }
+            index = pickLowest([this, &busy, lowest](size_t i) {
+                return std::make_pair(busy[i] > lowest + kBusyTolerance, loops_[i]->connectionCount());
+            });
+            break;
         }
+        case kPowerOfTwoChoices:
+            if(loops_.size() > 1){
+                const size_t a = random_() % loops_.size();
+                const size_t b = (a + 1 + random_() % (loops_.size() - 1)) % loops_.size();
+                const int ca = loops_[a]->connectionCount();
+                const int cb = loops_[b]->connectionCount();
+                if(ca != cb){
+                    index = ca < cb ? a : b;
+                }else{
+                    index = loops_[a]->busyRatio() <= loops_[b]->busyRatio() ? a : b;
+                }
+            }
+            break;
+        default:
+            break;
     }
 
+    loop = loops_[index];
+    // 下一次从选中的下一个开始，round-robin时就是原来的行为
+    next_ = static_cast<int>(index + 1);
+    if(implicit_cast<size_t>(next_) >= loops_.size()){
+        next_ = 0;
+    }
     return loop;
 }
 
+template<typename Score>
+size_t EventLoopThreadPool::pickLowest(Score score)
+{
+    size_t best = next_;
+    auto bestScore = score(best);
+    for(size_t k = 1; k < loops_.size(); ++k){
+        const size_t i = (next_ + k) % loops_.size();
+        auto s = score(i);
+        if(s < bestScore){
+            best = i;
+            bestScore = s;
+        }
+    }
+    return best;
+}
+
+std::vector<LoopLoad> EventLoopThreadPool::loads() const
+{
+    std::vector<LoopLoad> result;
+    const std::vector<EventLoop*> loops(loops_.empty() ? std::vector<EventLoop*>(1, baseLoop_) : loops_);
+    for(EventLoop* loop : loops){
+        LoopLoad load;
+        load.loop = loop;
+        load.connections = loop->connectionCount();
+        load.queued = loop->queueSize();
+        load.busyRatio = loop->busyRatio();
+        result.push_back(load);
+    }
+    return result;
+}
+
+
+std::vector<LoopStats> EventLoopThreadPool::stats() const
+{
+    std::vector<LoopStats> result;
+    const std::vector<EventLoop*> loops(loops_.empty() ? std::vector<EventLoop*>(1, baseLoop_) : loops_);
+    result.reserve(loops.size());
+    for(EventLoop* loop : loops){
+        result.push_back(loop->stats());
+    }
+    return result;
+}
+
 
 EventLoop *EventLoopThreadPool::getLoopForHash(size_t hashCode) {
     baseLoop_->assertInLoopThread();
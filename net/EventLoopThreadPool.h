@@ -7,9 +7,12 @@
 
 #include "../base/noncopyable.h"
 #include "../base/Types.h"
+#include "LoopPlacement.h"
+#include "LoopStats.h"
 
 #include <functional>
 #include <memory>
+#include <random>
 #include <vector>
 
 namespace muduo{
@@ -21,21 +24,59 @@ namespace muduo{
          * EventLoopThreadPool是封装了多个EventLoopThread的线程池，管理所有客户端上的IO事件，每个线程都有唯一一个事件循环。
          * 主线程的EventLoopThread负责新的客户端连接，线程池中的EventLoopThread负责客户端的IO事件，客户端IO事件的分配按照一定规则执行。
          */
+        // 一个loop的负载信号，见EventLoop::connectionCount()、queueSize()、busyRatio()
+        struct LoopLoad
+        {
+            EventLoop* loop;
+            int connections;
+            size_t queued;
+            double busyRatio;
+        };
+
         class EventLoopThreadPool:noncopyable{
         public:
             typedef std::function<void(EventLoop*)> ThreadInitCallback;
+            // 自定义的分配函数，从start()之后的全部IO loop中选一个
+            typedef std::function<EventLoop*(const std::vector<EventLoop*>&)> DispatchFunction;
+
+            /*
+             * getNextLoop()的分配策略，除round-robin外都按各loop自己维护的负载信号选择，
+             * 相等时从上次选中的下一个loop开始轮流，避免一批新连接都落在同一个loop上：
+             *   kRoundRobin        : 轮流（默认）
+             *   kLeastConnections  : 连接数最少
+             *   kShortestQueue     : 等待执行的回调最少
+             *   kLeastBusy         : 忙碌比例最低，相差不到kBusyTolerance的按连接数比较（忙碌比例变化慢，单独使用会扎堆）
+             *   kPowerOfTwoChoices : 随机取两个loop，连接数少的胜出，相等时比较忙碌比例
+             */
+            enum DispatchPolicy { kRoundRobin, kLeastConnections, kShortestQueue, kLeastBusy, kPowerOfTwoChoices };
+            static constexpr double kBusyTolerance = 0.05;
             EventLoopThreadPool(EventLoop* baseLoop, const string& nameArg);
             ~EventLoopThreadPool();
 
             void setThreadNum(int numThreads){ numThreads_ = numThreads;};
+            // loop线程的CPU/NUMA放置策略，需在start()前调用；numThreads为0时baseLoop在调用者的线程中，不绑定
+            void setPlacement(const LoopPlacement& placement){ placement_ = placement; }
+            // start()之后第i个loop线程的绑定，没有绑定时为空
+            const std::vector<CpuSlot>& placements() const { return slots_; }
 
             // 启动EventLoopThreadPool
             void start(const ThreadInitCallback& cb = ThreadInitCallback());
 
-            // 启动后有效，使用round-robin策略获取线程池中的EventLoop对象
+            // 启动后有效，按分配策略获取线程池中的EventLoop对象
             EventLoop* getNextLoop();
 
-            // 使用固定的hash方法，获取相同的线程对象
+            // 设置分配策略，可以在start()前后调用，只能在baseLoop线程中
+            void setDispatchPolicy(DispatchPolicy policy) { policy_ = policy; }
+            DispatchPolicy dispatchPolicy() const { return policy_; }
+            // 设置后代替分配策略，传入空函数恢复
+            void setDispatchFunction(const DispatchFunction& fn) { dispatchFunction_ = fn; }
+
+            // start()之后各IO loop（没有IO线程时为baseLoop）当前的负载，用于监控，可以在任意线程调用
+            std::vector<LoopLoad> loads() const;
+            // start()之后各IO loop（没有IO线程时为baseLoop）的运行统计快照，见EventLoop::stats()，可以在任意线程调用
+            std::vector<LoopStats> stats() const;
+
+            // 使用固定的hash方法，获取相同的线程对象，不受分配策略影响
             EventLoop* getLoopForHash(size_t hashCode);
 
             // 返回所有EvenetLoop，含baseloop
@@ -46,13 +87,22 @@ namespace muduo{
             const string& name() const { return name_; }
 
         private:
+            // 从next_开始轮流比较score(下标)，返回最小的下标，相等时先比较到的胜出
+            template<typename Score>
+            size_t pickLowest(Score score);
+
             EventLoop* baseLoop_;		// Acceptor所属EventLoop   就是主循环
             string name_;				// 线程池名称
             bool started_;			    // 是否已经启动
             int numThreads_;			// 线程数
             int next_;				    // 新连接到来，所选择的EventLoop对象下标
+            DispatchPolicy policy_;
+            DispatchFunction dispatchFunction_;
+            std::minstd_rand random_;   // kPowerOfTwoChoices使用
             std::vector<std::unique_ptr<EventLoopThread>> threads_; // EventLoopThread--I/O线程列表
             std::vector<EventLoop*> loops_;	// EventLoop列表
+            LoopPlacement placement_;       // 放置策略
+            std::vector<CpuSlot> slots_;    // 按策略为每个线程计算出的绑定
 
         };
     }
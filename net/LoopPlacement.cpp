@@ -0,0 +1,362 @@
+//
+// Created by fight on 2023/7/15.
+//
+
+#include "LoopPlacement.h"
+#include "../base/FileUtil.h"
+#include "../base/Logging.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <linux/mempolicy.h>
+#include <map>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+    // 读取sysfs中的一个整数，失败时返回defaultValue
+    int readSysInt(const char* path, int defaultValue)
+    {
+        string content;
+        if (FileUtil::readFile(path, 64, &content) != 0 || content.empty())
+        {
+            return defaultValue;
+        }
+        return atoi(content.c_str());
+    }
+
+    bool readSysCpuList(const char* path, std::vector<int>* cpus)
+    {
+        string content;
+        if (FileUtil::readFile(path, 4096, &content) != 0)
+        {
+            return false;
+        }
+        return LoopPlacement::parseCpuList(content, cpus);
+    }
+
+    struct PhysicalCore
+    {
+        int node;
+        int package;
+        int core;
+        std::vector<int> cpus;
+    };
+}
+
+LoopPlacement LoopPlacement::cpuList(const std::vector<int>& cpus)
+{
+    LoopPlacement placement;
+    placement.policy_ = kCpuList;
+    placement.cpus_ = cpus;
+    return placement;
+}
+
+LoopPlacement LoopPlacement::physicalCores()
+{
+    LoopPlacement placement;
+    placement.policy_ = kPhysicalCore;
+    return placement;
+}
+
+LoopPlacement LoopPlacement::numaNodes()
+{
+    LoopPlacement placement;
+    placement.policy_ = kNumaNode;
+    return placement;
+}
+
+const char* LoopPlacement::policyName() const
+{
+    switch (policy_)
+    {
+        case kCpuList:
+            return "cpu-list";
+        case kPhysicalCore:
+            return "physical-core";
+        case kNumaNode:
+            return "numa-node";
+        default:
+            return "none";
+    }
+}
+
+std::vector<CpuSlot> LoopPlacement::assign(int numLoops, const std::vector<CpuInfo>& topology) const
+{
+    std::vector<CpuSlot> slots;
+    if (policy_ == kNone || numLoops <= 0 || topology.empty())
+    {
+        return slots;
+    }
+
+    if (policy_ == kCpuList)
+    {
+        std::vector<const CpuInfo*> usable;
+        for (int cpu : cpus_)
+        {
+            std::vector<CpuInfo>::const_iterator it =
+                    std::find_if(topology.begin(), topology.end(), [cpu](const CpuInfo& info) { return info.cpu == cpu; });
+            if (it == topology.end())
+            {
+                LOG_WARN << "LoopPlacement::assign - cpu " << cpu << " is not available, ignored";
+                continue;
+            }
+            usable.push_back(&*it);
+        }
+        for (int i = 0; !usable.empty() && i < numLoops; ++i)
+        {
+            const CpuInfo* info = usable[i % usable.size()];
+            CpuSlot slot;
+            slot.cpus.push_back(info->cpu);
+            slot.node = info->node;
+            slots.push_back(slot);
+        }
+    }
+    else if (policy_ == kPhysicalCore)
+    {
+        // 按(node, package, core)归并超线程，再在各节点之间轮流取核，loop少于核数时各节点的负载也均衡
+        std::map<std::vector<int>, PhysicalCore> cores;
+        for (const CpuInfo& info : topology)
+        {
+            std::vector<int> key = { info.node, info.package, info.core };
+            PhysicalCore& core = cores[key];
+            core.node = info.node;
+            core.package = info.package;
+            core.core = info.core;
+            core.cpus.push_back(info.cpu);
+        }
+        std::map<int, std::vector<const PhysicalCore*>> byNode;
+        for (const auto& item : cores)
+        {
+            byNode[item.second.node].push_back(&item.second);
+        }
+        std::vector<const PhysicalCore*> order;
+        for (size_t round = 0; order.size() < cores.size(); ++round)
+        {
+            for (const auto& item : byNode)
+            {
+                if (round < item.second.size())
+                {
+                    order.push_back(item.second[round]);
+                }
+            }
+        }
+        if (implicit_cast<size_t>(numLoops) > order.size())
+        {
+            LOG_WARN << "LoopPlacement::assign - " << numLoops << " loops on " << order.size()
+                     << " physical cores, some cores are shared";
+        }
+        for (int i = 0; i < numLoops; ++i)
+        {
+            const PhysicalCore* core = order[i % order.size()];
+            CpuSlot slot;
+            slot.cpus = core->cpus;
+            slot.node = core->node;
+            slots.push_back(slot);
+        }
+    }
+    else if (policy_ == kNumaNode)
+    {
+        std::map<int, std::vector<int>> nodes;
+        for (const CpuInfo& info : topology)
+        {
+            nodes[info.node].push_back(info.cpu);
+        }
+        std::vector<std::pair<int, std::vector<int>>> order(nodes.begin(), nodes.end());
+        for (int i = 0; i < numLoops; ++i)
+        {
+            CpuSlot slot;
+            slot.node = order[i % order.size()].first;
+            slot.cpus = order[i % order.size()].second;
+            slots.push_back(slot);
+        }
+    }
+    return slots;
+}
+
+std::vector<CpuInfo> LoopPlacement::detectTopology()
+{
+    std::vector<CpuInfo> topology;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (::sched_getaffinity(0, sizeof allowed, &allowed) != 0)
+    {
+        LOG_SYSERR << "LoopPlacement::detectTopology - sched_getaffinity";
+        return topology;
+    }
+
+    // 逻辑CPU到NUMA节点，内核没有NUMA信息时都在节点0
+    std::map<int, int> nodeOf;
+    std::vector<int> nodes;
+    if (readSysCpuList("/sys/devices/system/node/online", &nodes))
+    {
+        for (int node : nodes)
+        {
+            char path[64];
+            snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist", node);
+            std::vector<int> cpus;
+            if (readSysCpuList(path, &cpus))
+            {
+                for (int cpu : cpus)
+                {
+                    nodeOf[cpu] = node;
+                }
+            }
+        }
+    }
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (!CPU_ISSET(cpu, &allowed))
+        {
+            continue;
+        }
+        char path[96];
+        CpuInfo info;
+        info.cpu = cpu;
+        snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+        info.core = readSysInt(path, cpu);
+        snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+        info.package = readSysInt(path, 0);
+        std::map<int, int>::const_iterator it = nodeOf.find(cpu);
+        info.node = it == nodeOf.end() ? 0 : it->second;
+        topology.push_back(info);
+    }
+    return topology;
+}
+
+bool LoopPlacement::parseCpuList(StringPiece text, std::vector<int>* cpus)
+{
+    cpus->clear();
+    const char* p = text.data();
+    const char* end = p + text.size();
+    while (p < end && (*p == ' ' || *p == '\n'))
+    {
+        ++p;
+    }
+    while (end > p && (end[-1] == ' ' || end[-1] == '\n'))
+    {
+        --end;
+    }
+    while (p < end)
+    {
+        char* next = NULL;
+        long first = strtol(p, &next, 10);
+        if (next == p || first < 0)
+        {
+            return false;
+        }
+        long last = first;
+        p = next;
+        if (p < end && *p == '-')
+        {
+            ++p;
+            last = strtol(p, &next, 10);
+            if (next == p || last < first)
+            {
+                return false;
+            }
+            p = next;
+        }
+        for (long cpu = first; cpu <= last; ++cpu)
+        {
+            cpus->push_back(static_cast<int>(cpu));
+        }
+        if (p < end)
+        {
+            if (*p != ',')
+            {
+                return false;
+            }
+            ++p;
+        }
+    }
+    return true;
+}
+
+string LoopPlacement::toString(const CpuSlot& slot)
+{
+    if (slot.cpus.empty())
+    {
+        return "unbound";
+    }
+    // 连续的编号合并成区间，和sysfs的cpulist格式相同
+    string result("cpus ");
+    char buf[32];
+    for (size_t i = 0; i < slot.cpus.size(); )
+    {
+        size_t j = i;
+        while (j + 1 < slot.cpus.size() && slot.cpus[j + 1] == slot.cpus[j] + 1)
+        {
+            ++j;
+        }
+        if (j == i)
+        {
+            snprintf(buf, sizeof buf, "%s%d", i == 0 ? "" : ",", slot.cpus[i]);
+        }
+        else
+        {
+            snprintf(buf, sizeof buf, "%s%d-%d", i == 0 ? "" : ",", slot.cpus[i], slot.cpus[j]);
+        }
+        result += buf;
+        i = j + 1;
+    }
+    if (slot.node >= 0)
+    {
+        snprintf(buf, sizeof buf, " node %d", slot.node);
+        result += buf;
+    }
+    return result;
+}
+
+bool LoopPlacement::bindCurrentThread(const CpuSlot& slot)
+{
+    if (slot.cpus.empty())
+    {
+        return true;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : slot.cpus)
+    {
+        CPU_SET(cpu, &set);
+    }
+    int ret = ::pthread_setaffinity_np(::pthread_self(), sizeof set, &set);
+    if (ret != 0)
+    {
+        errno = ret;
+        LOG_SYSERR << "LoopPlacement::bindCurrentThread - pthread_setaffinity_np " << toString(slot);
+        return false;
+    }
+
+    if (slot.node >= 0)
+    {
+        // 只设置优先节点，本节点内存不足时仍可以从其他节点分配
+        unsigned long mask[(CPU_SETSIZE + 8 * sizeof(unsigned long) - 1) / (8 * sizeof(unsigned long))] = { 0 };
+        const size_t bits = 8 * sizeof(unsigned long);
+        if (implicit_cast<size_t>(slot.node) >= bits * (sizeof mask / sizeof mask[0]))
+        {
+            LOG_WARN << "LoopPlacement::bindCurrentThread - node " << slot.node << " out of range";
+            return false;
+        }
+        mask[slot.node / bits] |= 1UL << (slot.node % bits);
+        if (::syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, bits * (sizeof mask / sizeof mask[0])) != 0)
+        {
+            // 内核没有编译NUMA支持时为ENOSYS，只绑定CPU
+            if (errno != ENOSYS)
+            {
+                LOG_SYSERR << "LoopPlacement::bindCurrentThread - set_mempolicy node " << slot.node;
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,79 @@
+//
+// Created by fight on 2023/7/15.
+//
+
+#ifndef MUDUO_NET_LOOPPLACEMENT_H
+#define MUDUO_NET_LOOPPLACEMENT_H
+
+#include "../base/copyable.h"
+#include "../base/StringPiece.h"
+#include "../base/Types.h"
+
+#include <vector>
+
+namespace muduo{
+    namespace net{
+
+        // 一个逻辑CPU在拓扑中的位置，从/sys/devices/system读取
+        struct CpuInfo
+        {
+            int cpu;        // 逻辑CPU编号
+            int core;       // 物理核编号（同一个package内唯一）
+            int package;    // 物理CPU（socket）编号
+            int node;       // NUMA节点，没有NUMA信息时为0
+        };
+
+        // 一个loop线程的绑定：可以运行的CPU和优先分配内存的NUMA节点，cpus为空表示不绑定
+        struct CpuSlot
+        {
+            CpuSlot() : node(-1) { }
+
+            std::vector<int> cpus;
+            int node;       // -1表示不设置内存策略
+        };
+
+        /*
+         * EventLoopThreadPool中loop线程的放置策略：
+         *   kNone         : 不绑定（默认），由调度器决定
+         *   kCpuList      : 按给定的CPU列表，第i个loop绑定到cpus[i % n]
+         *   kPhysicalCore : 每个loop独占一个物理核（绑定到它的全部超线程），物理核在各NUMA节点间轮流分配
+         *   kNumaNode     : 第i个loop绑定到第i % n个NUMA节点的全部CPU
+         * 后三种都把线程的内存策略设为优先从所在节点分配（MPOL_PREFERRED），
+         * EventLoop、BufferPool和连接的缓冲区都在loop线程中分配，因此落在本节点上。
+         * 只考虑进程当前允许运行的CPU（sched_getaffinity）。
+         */
+        class LoopPlacement : public copyable{
+        public:
+            enum Policy { kNone, kCpuList, kPhysicalCore, kNumaNode };
+
+            LoopPlacement() : policy_(kNone) { }
+
+            static LoopPlacement cpuList(const std::vector<int>& cpus);
+            static LoopPlacement physicalCores();
+            static LoopPlacement numaNodes();
+
+            Policy policy() const { return policy_; }
+            const char* policyName() const;
+
+            // 按topology为numLoops个loop计算绑定，kNone或拓扑中没有可用的CPU时返回空
+            std::vector<CpuSlot> assign(int numLoops, const std::vector<CpuInfo>& topology) const;
+            std::vector<CpuSlot> assign(int numLoops) const
+            { return policy_ == kNone ? std::vector<CpuSlot>() : assign(numLoops, detectTopology()); }
+
+            // 读取本机允许当前进程使用的逻辑CPU的拓扑，按CPU编号排序
+            static std::vector<CpuInfo> detectTopology();
+            // 解析"0-3,8,10-11"格式的CPU列表，格式错误返回false
+            static bool parseCpuList(StringPiece text, std::vector<int>* cpus);
+            static string toString(const CpuSlot& slot);
+
+            // 把当前线程绑定到slot，失败时记录日志并返回false
+            static bool bindCurrentThread(const CpuSlot& slot);
+
+        private:
+            Policy policy_;
+            std::vector<int> cpus_;
+        };
+    }
+}
+
+#endif //MUDUO_NET_LOOPPLACEMENT_H
@@ -0,0 +1,99 @@
+//
+// Created by fight on 2023/7/16.
+//
+
+#include "LoopStats.h"
+
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int Histogram::kBuckets;
+
+Histogram::Histogram()
+        : count_(0),
+          sum_(0),
+          max_(0)
+{
+    for (int i = 0; i < kBuckets; ++i)
+    {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+int Histogram::bucketOf(int64_t value)
+{
+    if (value <= 0)
+    {
+        return 0;
+    }
+    // value在[2^(b-1), 2^b)中
+    const int b = 64 - __builtin_clzll(static_cast<unsigned long long>(value));
+    return std::min(b, kBuckets - 1);
+}
+
+int64_t Histogram::bucketUpperBound(int bucket)
+{
+    if (bucket <= 0)
+    {
+        return 0;
+    }
+    if (bucket >= kBuckets - 1)
+    {
+        return INT64_MAX;
+    }
+    return (static_cast<int64_t>(1) << bucket) - 1;
+}
+
+// 单写者，读-改-写不需要原子的fetch_add
+void Histogram::record(int64_t value)
+{
+    std::atomic<int64_t>& bucket = buckets_[bucketOf(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    if (value > max_.load(std::memory_order_relaxed))
+    {
+        max_.store(value, std::memory_order_relaxed);
+    }
+    count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+int64_t Histogram::percentile(double fraction) const
+{
+    int64_t counts[kBuckets];
+    int64_t total = 0;
+    for (int i = 0; i < kBuckets; ++i)
+    {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+    const int64_t rank = std::max<int64_t>(1, static_cast<int64_t>(fraction * static_cast<double>(total) + 0.5));
+    int64_t seen = 0;
+    int bucket = kBuckets - 1;
+    for (int i = 0; i < kBuckets; ++i)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            bucket = i;
+            break;
+        }
+    }
+    return std::min(bucketUpperBound(bucket), max());
+}
+
+Histogram::Summary Histogram::summary() const
+{
+    Summary s;
+    s.count = count();
+    s.mean = s.count > 0 ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / static_cast<double>(s.count) : 0.0;
+    s.p50 = percentile(0.5);
+    s.p99 = percentile(0.99);
+    s.max = max();
+    return s;
+}
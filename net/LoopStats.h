@@ -0,0 +1,94 @@
+//
+// Created by fight on 2023/7/16.
+//
+
+#ifndef MUDUO_NET_LOOPSTATS_H
+#define MUDUO_NET_LOOPSTATS_H
+
+#include "../base/noncopyable.h"
+#include "../base/Timestamp.h"
+#include "../base/Types.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+namespace muduo{
+    namespace net{
+        class EventLoop;
+
+        /*
+         * 按2的幂分桶的直方图：第0个桶是0，第i个桶是[2^(i-1), 2^i)，最后一个桶包括更大的值。
+         * 只有一个线程（loop线程）record()，任意线程都可以读取，计数用relaxed原子变量，不加锁；
+         * 读到的各个桶之间不是同一时刻的快照，用于监控足够了。
+         */
+        class Histogram : noncopyable{
+        public:
+            static const int kBuckets = 40;
+
+            struct Summary
+            {
+                int64_t count;
+                double mean;
+                int64_t p50;        // 所在桶的上界，不超过max
+                int64_t p99;
+                int64_t max;
+            };
+
+            Histogram();
+
+            // 只能在一个线程中调用
+            void record(int64_t value);
+
+            int64_t count() const { return count_.load(std::memory_order_relaxed); }
+            int64_t max() const { return max_.load(std::memory_order_relaxed); }
+            // 大于等于一定比例（0~1）的记录值不超过的上界
+            int64_t percentile(double fraction) const;
+            Summary summary() const;
+
+            static int bucketOf(int64_t value);
+            // 第i个桶包含的最大值
+            static int64_t bucketUpperBound(int bucket);
+
+        private:
+            std::atomic<int64_t> buckets_[kBuckets];
+            std::atomic<int64_t> count_;
+            std::atomic<int64_t> sum_;
+            std::atomic<int64_t> max_;
+        };
+
+        // 一次耗时较长的回调
+        struct SlowCallback
+        {
+            Timestamp when;             // 回调开始的时刻
+            int64_t microseconds;
+            string what;                // 比如"fd 12 IN"、"functor"、"iteration end"
+        };
+
+        /*
+         * EventLoop::stats()返回的运行统计快照，从loop()开始累计。时间的单位是微秒：
+         *   poll     : 等待事件（包括忙轮询空转）
+         *   channels : 处理IO事件（包括定时器回调，它们在timerfd的事件中执行）
+         *   functors : doPendingFunctors()和runAtIterationEnd()登记的回调
+         */
+        struct LoopStats
+        {
+            EventLoop* loop;
+            Timestamp sampled;
+            int64_t iterations;
+            int64_t pollMicroseconds;
+            int64_t channelMicroseconds;
+            int64_t functorMicroseconds;
+            int connections;
+            size_t queued;                          // 当前等待执行的回调个数
+            double busyRatio;
+            Histogram::Summary activeChannels;      // 每轮迭代的就绪channel个数
+            Histogram::Summary queueDepth;          // 每次doPendingFunctors()取出的回调个数
+            Histogram::Summary callbackMicroseconds;    // 每个IO事件、回调的耗时，见EventLoop::setCallbackTiming()
+            Histogram::Summary timerLagMicroseconds;    // 定时器实际执行时刻减去到期时刻
+            std::vector<SlowCallback> slowest;      // 耗时最长的几个回调，从长到短，同样需要setCallbackTiming()
+        };
+    }
+}
+
+#endif //MUDUO_NET_LOOPSTATS_H
@@ -9,7 +9,8 @@ using namespace muduo;
 using namespace muduo::net;
 
 Poller::Poller(EventLoop* loop)
-        : ownerLoop_(loop)
+        : ctlCalls_(0),
+          ownerLoop_(loop)
 {
 }
 
@@ -18,8 +19,7 @@ Poller::~Poller() = default;
 bool Poller::hasChannel(Channel* channel) const
 {
     assertInLoopThread();
-    ChannelMap::const_iterator it = channels_.find(channel->fd());
-    return it != channels_.end() && it->second == channel;
+    return channels_.find(channel->fd()) == channel;
 }
 
 void Poller::assertInLoopThread() const {
@@ -0,0 +1,399 @@
+//
+// Created by fight on 2023/7/7.
+//
+
+#include "Scan.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MUDUO_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+    struct ScanFunctions
+    {
+        scan::Isa isa;
+        const char* (*findByte)(const char*, const char*, char);
+        const char* (*findAnyOf)(const char*, const char*, const char*, size_t);
+        const char* (*findCRLF)(const char*, const char*);
+        const char* (*findCRLFCRLF)(const char*, const char*);
+    };
+
+    // ---------------- 标量实现 ----------------
+
+    const char* findByteScalar(const char* begin, const char* end, char c)
+    {
+        return static_cast<const char*>(memchr(begin, c, end - begin));
+    }
+
+    const char* findAnyOfScalar(const char* begin, const char* end, const char* set, size_t setSize)
+    {
+        bool table[256] = { false };
+        for (size_t i = 0; i < setSize; ++i)
+        {
+            table[static_cast<unsigned char>(set[i])] = true;
+        }
+        for (const char* p = begin; p < end; ++p)
+        {
+            if (table[static_cast<unsigned char>(*p)])
+            {
+                return p;
+            }
+        }
+        return NULL;
+    }
+
+    const char* findCRLFScalar(const char* begin, const char* end)
+    {
+        const char* p = begin;
+        while (end - p >= 2)
+        {
+            p = static_cast<const char*>(memchr(p, '\r', end - p - 1));
+            if (p == NULL)
+            {
+                return NULL;
+            }
+            if (p[1] == '\n')
+            {
+                return p;
+            }
+            ++p;
+        }
+        return NULL;
+    }
+
+    const char* findCRLFCRLFScalar(const char* begin, const char* end)
+    {
+        const char* p = begin;
+        while (end - p >= 4)
+        {
+            p = static_cast<const char*>(memchr(p, '\r', end - p - 3));
+            if (p == NULL)
+            {
+                return NULL;
+            }
+            if (p[1] == '\n' && p[2] == '\r' && p[3] == '\n')
+            {
+                return p;
+            }
+            ++p;
+        }
+        return NULL;
+    }
+
+    const ScanFunctions kScalarFunctions =
+    {
+        scan::kScalar, findByteScalar, findAnyOfScalar, findCRLFScalar, findCRLFCRLFScalar
+    };
+
+#ifdef MUDUO_SCAN_X86
+
+    // ---------------- SSE2实现，一次16字节 ----------------
+    // 每个函数先按块比较得到位掩码，剩下不足一块的尾部交给标量实现
+
+    __attribute__((target("sse2")))
+    const char* findByteSse2(const char* begin, const char* end, char c)
+    {
+        const __m128i needle = _mm_set1_epi8(c);
+        const char* p = begin;
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, needle));
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+        return findByteScalar(p, end, c);
+    }
+
+    __attribute__((target("sse2")))
+    const char* findAnyOfSse2(const char* begin, const char* end, const char* set, size_t setSize)
+    {
+        if (setSize > 16)
+        {
+            return findAnyOfScalar(begin, end, set, setSize);
+        }
+        __m128i needles[16];
+        for (size_t i = 0; i < setSize; ++i)
+        {
+            needles[i] = _mm_set1_epi8(set[i]);
+        }
+        const char* p = begin;
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i hit = _mm_setzero_si128();
+            for (size_t i = 0; i < setSize; ++i)
+            {
+                hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, needles[i]));
+            }
+            int mask = _mm_movemask_epi8(hit);
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+        return findAnyOfScalar(p, end, set, setSize);
+    }
+
+    __attribute__((target("sse2")))
+    const char* findCRLFSse2(const char* begin, const char* end)
+    {
+        const __m128i cr = _mm_set1_epi8('\r');
+        const __m128i lf = _mm_set1_epi8('\n');
+        const char* p = begin;
+        // 第二次load从p+1开始，所以需要17字节
+        for (; end - p >= 17; p += 16)
+        {
+            __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+            int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(v0, cr), _mm_cmpeq_epi8(v1, lf)));
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+        return findCRLFScalar(p, end);
+    }
+
+    __attribute__((target("sse2")))
+    const char* findCRLFCRLFSse2(const char* begin, const char* end)
+    {
+        const __m128i cr = _mm_set1_epi8('\r');
+        const __m128i lf = _mm_set1_epi8('\n');
+        const char* p = begin;
+        for (; end - p >= 19; p += 16)
+        {
+            __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+            __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2));
+            __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 3));
+            __m128i hit = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(v0, cr), _mm_cmpeq_epi8(v1, lf)),
+                                        _mm_and_si128(_mm_cmpeq_epi8(v2, cr), _mm_cmpeq_epi8(v3, lf)));
+            int mask = _mm_movemask_epi8(hit);
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+        return findCRLFCRLFScalar(p, end);
+    }
+
+    const ScanFunctions kSse2Functions =
+    {
+        scan::kSse2, findByteSse2, findAnyOfSse2, findCRLFSse2, findCRLFCRLFSse2
+    };
+
+    // ---------------- AVX2实现，一次32字节 ----------------
+
+    __attribute__((target("avx2")))
+    const char* findByteAvx2(const char* begin, const char* end, char c)
+    {
+        const __m256i needle = _mm256_set1_epi8(c);
+        const char* p = begin;
+        for (; end - p >= 32; p += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle)));
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+        return findByteSse2(p, end, c);
+    }
+
+    __attribute__((target("avx2")))
+    const char* findAnyOfAvx2(const char* begin, const char* end, const char* set, size_t setSize)
+    {
+        if (setSize > 16)
+        {
+            return findAnyOfScalar(begin, end, set, setSize);
+        }
+        __m256i needles[16];
+        for (size_t i = 0; i < setSize; ++i)
+        {
+            needles[i] = _mm256_set1_epi8(set[i]);
+        }
+        const char* p = begin;
+        for (; end - p >= 32; p += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i hit = _mm256_setzero_si256();
+            for (size_t i = 0; i < setSize; ++i)
+            {
+                hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, needles[i]));
+            }
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+        return findAnyOfSse2(p, end, set, setSize);
+    }
+
+    __attribute__((target("avx2")))
+    const char* findCRLFAvx2(const char* begin, const char* end)
+    {
+        const __m256i cr = _mm256_set1_epi8('\r');
+        const __m256i lf = _mm256_set1_epi8('\n');
+        const char* p = begin;
+        for (; end - p >= 33; p += 32)
+        {
+            __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+            __m256i hit = _mm256_and_si256(_mm256_cmpeq_epi8(v0, cr), _mm256_cmpeq_epi8(v1, lf));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+        return findCRLFSse2(p, end);
+    }
+
+    __attribute__((target("avx2")))
+    const char* findCRLFCRLFAvx2(const char* begin, const char* end)
+    {
+        const __m256i cr = _mm256_set1_epi8('\r');
+        const __m256i lf = _mm256_set1_epi8('\n');
+        const char* p = begin;
+        for (; end - p >= 35; p += 32)
+        {
+            __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+            __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2));
+            __m256i v3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 3));
+            __m256i hit = _mm256_and_si256(
+                    _mm256_and_si256(_mm256_cmpeq_epi8(v0, cr), _mm256_cmpeq_epi8(v1, lf)),
+                    _mm256_and_si256(_mm256_cmpeq_epi8(v2, cr), _mm256_cmpeq_epi8(v3, lf)));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+            if (mask != 0)
+            {
+                return p + __builtin_ctz(mask);
+            }
+        }
+        return findCRLFCRLFSse2(p, end);
+    }
+
+    const ScanFunctions kAvx2Functions =
+    {
+        scan::kAvx2, findByteAvx2, findAnyOfAvx2, findCRLFAvx2, findCRLFCRLFAvx2
+    };
+
+#endif  // MUDUO_SCAN_X86
+
+    bool supported(scan::Isa isa)
+    {
+#ifdef MUDUO_SCAN_X86
+        switch (isa)
+        {
+            case scan::kScalar:
+                return true;
+            case scan::kSse2:
+                return __builtin_cpu_supports("sse2");
+            case scan::kAvx2:
+                return __builtin_cpu_supports("avx2");
+        }
+        return false;
+#else
+        return isa == scan::kScalar;
+#endif
+    }
+
+    const ScanFunctions* functionsOf(scan::Isa isa)
+    {
+#ifdef MUDUO_SCAN_X86
+        if (isa == scan::kAvx2)
+        {
+            return &kAvx2Functions;
+        }
+        if (isa == scan::kSse2)
+        {
+            return &kSse2Functions;
+        }
+#endif
+        return &kScalarFunctions;
+    }
+
+    const ScanFunctions* selectFunctions()
+    {
+        __builtin_cpu_init();
+        if (supported(scan::kAvx2))
+        {
+            return functionsOf(scan::kAvx2);
+        }
+        if (supported(scan::kSse2))
+        {
+            return functionsOf(scan::kSse2);
+        }
+        return &kScalarFunctions;
+    }
+
+    // 静态初始化完成前（其他编译单元的全局对象构造时）使用标量实现，结果同样正确
+    const ScanFunctions* g_functions = &kScalarFunctions;
+
+    struct ScanInit
+    {
+        ScanInit() { g_functions = selectFunctions(); }
+    };
+    ScanInit initObj;
+}
+
+const char* scan::findByte(const char* begin, const char* end, char c)
+{
+    return g_functions->findByte(begin, end, c);
+}
+
+const char* scan::findAnyOf(const char* begin, const char* end, const char* set, size_t setSize)
+{
+    return g_functions->findAnyOf(begin, end, set, setSize);
+}
+
+const char* scan::findCRLF(const char* begin, const char* end)
+{
+    return g_functions->findCRLF(begin, end);
+}
+
+const char* scan::findCRLFCRLF(const char* begin, const char* end)
+{
+    return g_functions->findCRLFCRLF(begin, end);
+}
+
+scan::Isa scan::isa()
+{
+    return g_functions->isa;
+}
+
+const char* scan::isaName(Isa isa)
+{
+    switch (isa)
+    {
+        case kScalar:
+            return "scalar";
+        case kSse2:
+            return "sse2";
+        case kAvx2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+bool scan::setIsa(Isa isa)
+{
+    if (!supported(isa))
+    {
+        return false;
+    }
+    g_functions = functionsOf(isa);
+    return true;
+}
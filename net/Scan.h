@@ -0,0 +1,45 @@
+//
+// Created by fight on 2023/7/7.
+//
+
+#ifndef MUDUO_NET_SCAN_H
+#define MUDUO_NET_SCAN_H
+
+#include <stddef.h>
+
+namespace muduo{
+    namespace net{
+
+        /*
+         * 在[begin, end)中查找分隔符，找不到时返回NULL。
+         *
+         * x86-64上按CPU在运行时选择AVX2（一次比较32字节）或SSE2（16字节）实现，其他平台使用标量实现。
+         * 查找CRLF时把p和p+1开始的两段分别与'\r'、'\n'比较再按位与，一次得到一整块中所有"\r\n"的位置，
+         * 不需要像std::search那样逐字节匹配。Buffer::findCRLF()和HttpContext都走这里。
+         */
+        namespace scan{
+            enum Isa
+            {
+                kScalar,
+                kSse2,
+                kAvx2,
+            };
+
+            const char* findByte(const char* begin, const char* end, char c);
+            // set中任意一个字符第一次出现的位置，setSize不超过16时使用SIMD
+            const char* findAnyOf(const char* begin, const char* end, const char* set, size_t setSize);
+            const char* findCRLF(const char* begin, const char* end);
+            // 查找"\r\n\r\n"，即HTTP头部的结尾
+            const char* findCRLFCRLF(const char* begin, const char* end);
+
+            // 当前使用的实现
+            Isa isa();
+            const char* isaName(Isa isa);
+            // 切换实现，用于测试和基准；CPU不支持时返回false，保持原来的实现
+            bool setIsa(Isa isa);
+        }
+
+    }
+}
+
+#endif //MUDUO_NET_SCAN_H
@@ -0,0 +1,57 @@
+//
+// Created by fight on 2023/7/8.
+//
+
+#ifndef MUDUO_NET_SHAREDMESSAGE_H
+#define MUDUO_NET_SHAREDMESSAGE_H
+
+#include "../base/copyable.h"
+#include "../base/StringPiece.h"
+#include "../base/Types.h"
+
+#include <memory>
+#include <utility>
+
+namespace muduo{
+    namespace net{
+
+        /*
+         * 不可变、引用计数的消息，用于把同一条消息发给大量连接（广播、pub/sub扇出）。
+         *
+         * 构造时最多拷贝一次，之后SharedMessage的拷贝只增加引用计数。
+         * TcpConnection::send(const SharedMessage&)跨线程时不拷贝数据，
+         * 内核没有一次写完时剩下的部分以引用方式挂到输出队列（ChainBuffer的外部节点），
+         * 所以无论发给多少个连接、在哪个loop中发送，数据本身都只有一份，最后一个连接发完后释放。
+         */
+        class SharedMessage : public muduo::copyable{
+        public:
+            SharedMessage()
+            { }
+
+            explicit SharedMessage(const StringPiece& data)
+                    : payload_(std::make_shared<const string>(data.data(), data.size()))
+            { }
+
+            // 接管data，不拷贝
+            explicit SharedMessage(string&& data)
+                    : payload_(std::make_shared<const string>(std::move(data)))
+            { }
+
+            const char* data() const { return payload_ ? payload_->data() : NULL; }
+            size_t size() const { return payload_ ? payload_->size() : 0; }
+            bool empty() const { return size() == 0; }
+            StringPiece toStringPiece() const { return StringPiece(data(), static_cast<int>(size())); }
+
+            // 保证数据有效的owner，交给TcpConnection::send(data, owner)
+            const std::shared_ptr<const string>& payload() const { return payload_; }
+            // 当前有多少份引用（包括各个连接输出队列中的），用于观察/测试
+            long useCount() const { return payload_.use_count(); }
+
+        private:
+            std::shared_ptr<const string> payload_;
+        };
+
+    }
+}
+
+#endif //MUDUO_NET_SHAREDMESSAGE_H
@@ -7,6 +7,7 @@
 #include "InetAddress.h"
 #include "SocketsOpts.h"
 
+#include <linux/filter.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <stdio.h>
@@ -134,6 +135,60 @@ void Socket::setReusePort(bool on)
 #endif
 }
 
+bool Socket::setIncomingCpu(int cpu)
+{
+#ifdef SO_INCOMING_CPU
+    int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_INCOMING_CPU,
+                           &cpu, static_cast<socklen_t>(sizeof cpu));
+    if (ret < 0)
+    {
+        LOG_SYSERR << "SO_INCOMING_CPU failed.";
+        return false;
+    }
+    return true;
+#else
+    LOG_ERROR << "SO_INCOMING_CPU is not supported.";
+    return false;
+#endif
+}
+
+bool Socket::attachReusePortCpuMap(const std::vector<std::vector<int>>& cpusOfIndex)
+{
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+    // A = 当前CPU；逐个比较，相等时返回对应的下标；都不相等时返回越界的下标，内核退回hash选择
+    std::vector<sock_filter> code;
+    code.push_back(sock_filter{ BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) });
+    for (size_t i = 0; i < cpusOfIndex.size(); ++i)
+    {
+        for (int cpu : cpusOfIndex[i])
+        {
+            code.push_back(sock_filter{ BPF_JMP | BPF_JEQ | BPF_K, 0, 1, static_cast<uint32_t>(cpu) });
+            code.push_back(sock_filter{ BPF_RET | BPF_K, 0, 0, static_cast<uint32_t>(i) });
+        }
+    }
+    code.push_back(sock_filter{ BPF_RET | BPF_K, 0, 0, 0xffffffff });
+    if (code.size() > BPF_MAXINSNS)
+    {
+        LOG_ERROR << "Socket::attachReusePortCpuMap - too many cpus";
+        return false;
+    }
+    sock_fprog prog;
+    prog.len = static_cast<unsigned short>(code.size());
+    prog.filter = code.data();
+    int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                           &prog, static_cast<socklen_t>(sizeof prog));
+    if (ret < 0)
+    {
+        LOG_SYSERR << "SO_ATTACH_REUSEPORT_CBPF failed.";
+        return false;
+    }
+    return true;
+#else
+    LOG_ERROR << "SO_ATTACH_REUSEPORT_CBPF is not supported.";
+    return false;
+#endif
+}
+
 void Socket::setKeepAlive(bool on)
 {
     int optval = on ? 1 : 0;
@@ -141,3 +196,23 @@ void Socket::setKeepAlive(bool on)
                  &optval, static_cast<socklen_t>(sizeof optval));
     // FIXME CHECK
 }
+
+bool Socket::setZeroCopy(bool on)
+{
+#ifdef SO_ZEROCOPY
+    int optval = on ? 1 : 0;
+    int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY,
+                           &optval, static_cast<socklen_t>(sizeof optval));
+    if (ret < 0 && on)
+    {
+        LOG_SYSERR << "SO_ZEROCOPY failed.";
+    }
+    return ret == 0;
+#else
+    if (on)
+    {
+        LOG_ERROR << "SO_ZEROCOPY is not supported.";
+    }
+    return false;
+#endif
+}
@@ -7,6 +7,8 @@
 
 #include "../base/noncopyable.h"
 
+#include <vector>
+
 // struct tcp_info is in <netinet/tcp.h>
 struct tcp_info;
 
@@ -51,10 +53,20 @@ namespace muduo{
             // Enable/disable SO_REUSEPORT
             void setReusePort(bool on);
 
+            // SO_INCOMING_CPU：reuseport组内优先把在cpu上收到的连接交给这个socket（Linux 6.2+），失败返回false
+            bool setIncomingCpu(int cpu);
+
+            // 在本socket所在的reuseport组上挂一个classic BPF程序：在cpusOfIndex[i]中的CPU上收到的连接
+            // 交给组内第i个socket（组内下标是各socket调用listen()的顺序），其他CPU上的仍按hash选择。失败返回false
+            bool attachReusePortCpuMap(const std::vector<std::vector<int>>& cpusOfIndex);
+
 
             // Enable/disable SO_KEEPALIVE
             void setKeepAlive(bool on);
 
+            // Enable/disable SO_ZEROCOPY, return false if not supported
+            bool setZeroCopy(bool on);
+
         private:
             const int sockfd_;
         };
@@ -4,15 +4,19 @@
 
 #include "SocketsOpts.h"
 
+#include "../base/FileUtil.h"
 #include "../base/Logging.h"
 #include "../base/Types.h"
 #include "Endian.h"
 
 #include <errno.h>
 #include <fcntl.h>
+#include <sstream>
 #include <stdio.h>  // snprintf
+#include <stdlib.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
-#include <sys/uio.h>  // readv
+#include <sys/uio.h>  // readv, writev
 #include <unistd.h>
 
 using namespace muduo;
@@ -122,7 +126,11 @@ int sockets::accept(int sockfd, struct sockaddr_in6* addr)
     if (connfd < 0)
     {
         int savedErrno = errno;
-        LOG_SYSERR << "Socket::accept";
+        // 批量accept时EAGAIN只表示队列已经取空，由调用者决定是否记录
+        if (savedErrno != EAGAIN)
+        {
+            LOG_SYSERR << "Socket::accept";
+        }
         switch (savedErrno)
         {
             case EAGAIN:
@@ -173,6 +181,26 @@ ssize_t sockets::write(int sockfd, const void *buf, size_t count)
     return ::write(sockfd, buf, count);
 }
 
+ssize_t sockets::writev(int sockfd, const struct iovec *iov, int iovcnt)
+{
+    return ::writev(sockfd, iov, iovcnt);
+}
+
+ssize_t sockets::sendfile(int sockfd, int infd, off_t *offset, size_t count)
+{
+    return ::sendfile(sockfd, infd, offset, count);
+}
+
+ssize_t sockets::send(int sockfd, const void *buf, size_t count, int flags)
+{
+    return ::send(sockfd, buf, count, flags);
+}
+
+ssize_t sockets::recvmsg(int sockfd, struct msghdr *msg, int flags)
+{
+    return ::recvmsg(sockfd, msg, flags);
+}
+
 void sockets::close(int sockfd)
 {
     if (::close(sockfd) < 0)
@@ -301,3 +329,43 @@ bool sockets::isSelfConnect(int sockfd)
 }
 
 
+
+bool sockets::getListenOverflows(int64_t* overflows, int64_t* drops)
+{
+    string content;
+    if (FileUtil::readFile("/proc/net/netstat", 64 * 1024, &content) != 0)
+    {
+        return false;
+    }
+    // 每个协议两行："TcpExt: 名字..."，接着"TcpExt: 数值..."
+    std::istringstream lines(content);
+    string names;
+    string values;
+    while (std::getline(lines, names) && std::getline(lines, values))
+    {
+        if (names.compare(0, 7, "TcpExt:") != 0)
+        {
+            continue;
+        }
+        std::istringstream nameStream(names);
+        std::istringstream valueStream(values);
+        string name;
+        string value;
+        int found = 0;
+        while (nameStream >> name && valueStream >> value)
+        {
+            if (name == "ListenOverflows")
+            {
+                *overflows = atoll(value.c_str());
+                ++found;
+            }
+            else if (name == "ListenDrops")
+            {
+                *drops = atoll(value.c_str());
+                ++found;
+            }
+        }
+        return found == 2;
+    }
+    return false;
+}
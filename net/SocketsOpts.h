@@ -22,6 +22,10 @@ namespace muduo{
             ssize_t read(int sockfd, void *buf, size_t count);
             ssize_t readv(int sockfd, const struct iovec *iov, int iovcnt);
             ssize_t write(int sockfd, const void *buf, size_t count);
+            ssize_t writev(int sockfd, const struct iovec *iov, int iovcnt);
+            ssize_t sendfile(int sockfd, int infd, off_t *offset, size_t count);
+            ssize_t send(int sockfd, const void *buf, size_t count, int flags);
+            ssize_t recvmsg(int sockfd, struct msghdr *msg, int flags);
             void close(int sockfd);
             void shutdownWrite(int sockfd);
 
@@ -46,6 +50,10 @@ namespace muduo{
             struct sockaddr_in6 getLocalAddr(int sockfd);
             struct sockaddr_in6 getPeerAddr(int sockfd);
             bool isSelfConnect(int sockfd);
+
+            // 从/proc/net/netstat读取TcpExt中的ListenOverflows（accept队列满）和ListenDrops（因此丢弃的SYN），
+            // 是整个网络命名空间的累计值，读取失败返回false
+            bool getListenOverflows(int64_t* overflows, int64_t* drops);
         }
     }
 }
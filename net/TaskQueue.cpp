@@ -0,0 +1,156 @@
+//
+// Created by fight on 2023/7/11.
+//
+
+#include "TaskQueue.h"
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t Task::kInlineSize;
+const size_t TaskQueue::kDefaultCapacity;
+
+namespace
+{
+    size_t roundUpPowerOfTwo(size_t n)
+    {
+        size_t size = 2;
+        while (size < n)
+        {
+            size <<= 1;
+        }
+        return size;
+    }
+}
+
+TaskQueue::TaskQueue(size_t capacity)
+        : mask_(roundUpPowerOfTwo(capacity) - 1),
+          cells_(new Cell[mask_ + 1]),
+          enqueuePos_(0),
+          dequeuePos_(0),
+          overflowing_(false),
+          overflows_(0)
+{
+    // 第i个槽在序号等于i时可以写入，写入第pos个任务后序号变为pos+1，表示可以读取
+    for (size_t i = 0; i <= mask_; ++i)
+    {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+TaskQueue::~TaskQueue() = default;
+
+bool TaskQueue::tryPush(Task& task)
+{
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;)
+    {
+        cell = &cells_[pos & mask_];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0)
+        {
+            // 槽是空的，抢占这个位置
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // 这个槽的上一轮任务还没有被取走，队列已满
+            return false;
+        }
+        else
+        {
+            // 被别的生产者抢先了
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+    cell->task = std::move(task);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+void TaskQueue::push(Task&& task)
+{
+    if (!overflowing_.load(std::memory_order_acquire) && tryPush(task))
+    {
+        return;
+    }
+    MutexLockGuard lock(mutex_);
+    overflow_.push_back(std::move(task));
+    overflowing_.store(true, std::memory_order_release);
+    ++overflows_;
+}
+
+size_t TaskQueue::popAll(std::vector<Task>* out)
+{
+    const size_t start = out->size();
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    // 最多取一圈，生产者不停提交时也能按时返回
+    for (size_t n = 0; n <= mask_; ++n)
+    {
+        Cell* cell = &cells_[pos & mask_];
+        if (cell->sequence.load(std::memory_order_acquire) != pos + 1)
+        {
+            break;
+        }
+        out->push_back(std::move(cell->task));
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        ++pos;
+    }
+    dequeuePos_.store(pos, std::memory_order_relaxed);
+
+    // overflow_中的任务都晚于环形数组中同一生产者的任务，只有环形数组真正取空
+    // （没有已抢占但还没发布的槽）时才能取走；否则等那个生产者发布并唤醒loop后再来
+    if (overflowing_.load(std::memory_order_acquire) &&
+        enqueuePos_.load(std::memory_order_acquire) == pos)
+    {
+        std::vector<Task> overflow;
+        {
+            MutexLockGuard lock(mutex_);
+            if (out->empty())
+            {
+                out->swap(overflow_);
+            }
+            else
+            {
+                overflow.swap(overflow_);
+            }
+            overflowing_.store(false, std::memory_order_release);
+        }
+        for (Task& task : overflow)
+        {
+            out->push_back(std::move(task));
+        }
+    }
+    return out->size() - start;
+}
+
+int64_t TaskQueue::overflows() const
+{
+    MutexLockGuard lock(mutex_);
+    return overflows_;
+}
+
+bool TaskQueue::empty() const
+{
+    return !overflowing_.load(std::memory_order_acquire) &&
+           enqueuePos_.load(std::memory_order_acquire) == dequeuePos_.load(std::memory_order_relaxed);
+}
+
+size_t TaskQueue::sizeApprox() const
+{
+    size_t overflow = 0;
+    if (overflowing_.load(std::memory_order_acquire))
+    {
+        MutexLockGuard lock(mutex_);
+        overflow = overflow_.size();
+    }
+    // 先读dequeuePos_，保证不会比enqueuePos_新
+    const size_t head = dequeuePos_.load(std::memory_order_relaxed);
+    const size_t tail = enqueuePos_.load(std::memory_order_acquire);
+    return (tail > head ? tail - head : 0) + overflow;
+}
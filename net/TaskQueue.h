@@ -0,0 +1,209 @@
+//
+// Created by fight on 2023/7/11.
+//
+
+#ifndef MUDUO_NET_TASKQUEUE_H
+#define MUDUO_NET_TASKQUEUE_H
+
+#include "../base/Mutex.h"
+#include "../base/noncopyable.h"
+
+#include <assert.h>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace muduo{
+    namespace net{
+
+        /*
+         * Task是只能移动的无参可调用对象，代替std::function<void()>保存EventLoop::queueInLoop()的回调。
+         *
+         * 不超过kInlineSize字节、移动构造不抛异常的闭包（std::bind(&TcpConnection::xxx, shared_from_this())、
+         * 捕获几个指针的lambda等）直接构造在Task内部，不需要分配内存；更大的闭包才放到堆上。
+         * std::function本身也可以放进来（32字节），所以已有的Functor调用方式不受影响。
+         */
+        class Task : noncopyable{
+        public:
+            static const size_t kInlineSize = 64;
+
+            Task() : ops_(NULL) { }
+
+            template<typename F,
+                     typename = typename std::enable_if<
+                             !std::is_same<typename std::decay<F>::type, Task>::value>::type>
+            Task(F&& f)
+                    : ops_(NULL)
+            {
+                typedef typename std::decay<F>::type Fn;
+                construct<Fn>(std::forward<F>(f), std::integral_constant<bool, fitsInline<Fn>()>());
+            }
+
+            Task(Task&& rhs) noexcept
+                    : ops_(rhs.ops_)
+            {
+                if (ops_)
+                {
+                    ops_->move(&storage_, &rhs.storage_);
+                    rhs.ops_ = NULL;
+                }
+            }
+
+            Task& operator=(Task&& rhs) noexcept
+            {
+                if (this != &rhs)
+                {
+                    reset();
+                    ops_ = rhs.ops_;
+                    if (ops_)
+                    {
+                        ops_->move(&storage_, &rhs.storage_);
+                        rhs.ops_ = NULL;
+                    }
+                }
+                return *this;
+            }
+
+            ~Task() { reset(); }
+
+            void operator()() { assert(ops_); ops_->invoke(&storage_); }
+
+            explicit operator bool() const { return ops_ != NULL; }
+            // 闭包是否保存在Task内部（没有分配内存）
+            bool isInline() const { return ops_ != NULL && ops_->inlined; }
+
+            void reset()
+            {
+                if (ops_)
+                {
+                    ops_->destroy(&storage_);
+                    ops_ = NULL;
+                }
+            }
+
+            template<typename Fn>
+            static constexpr bool fitsInline()
+            {
+                return sizeof(Fn) <= kInlineSize &&
+                       alignof(Fn) <= alignof(Storage) &&
+                       std::is_nothrow_move_constructible<Fn>::value;
+            }
+
+        private:
+            typedef typename std::aligned_storage<kInlineSize>::type Storage;
+
+            template<typename Fn, typename F>
+            void construct(F&& f, std::true_type)
+            {
+                new (&storage_) Fn(std::forward<F>(f));
+                ops_ = &InlineOps<Fn>::ops;
+            }
+
+            template<typename Fn, typename F>
+            void construct(F&& f, std::false_type)
+            {
+                *reinterpret_cast<Fn**>(&storage_) = new Fn(std::forward<F>(f));
+                ops_ = &HeapOps<Fn>::ops;
+            }
+
+            struct Ops
+            {
+                void (*invoke)(void* storage);
+                void (*move)(void* dst, void* src);   // 移动到dst，并析构src中的对象
+                void (*destroy)(void* storage);
+                bool inlined;
+            };
+
+            template<typename Fn>
+            struct InlineOps
+            {
+                static void invoke(void* s) { (*static_cast<Fn*>(s))(); }
+                static void move(void* dst, void* src)
+                {
+                    new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+                    static_cast<Fn*>(src)->~Fn();
+                }
+                static void destroy(void* s) { static_cast<Fn*>(s)->~Fn(); }
+                static const Ops ops;
+            };
+
+            template<typename Fn>
+            struct HeapOps
+            {
+                static Fn*& ptr(void* s) { return *static_cast<Fn**>(s); }
+                static void invoke(void* s) { (*ptr(s))(); }
+                static void move(void* dst, void* src) { ptr(dst) = ptr(src); }
+                static void destroy(void* s) { delete ptr(s); }
+                static const Ops ops;
+            };
+
+            const Ops* ops_;
+            Storage storage_;
+        };
+
+        template<typename Fn>
+        const Task::Ops Task::InlineOps<Fn>::ops = { &invoke, &move, &destroy, true };
+
+        template<typename Fn>
+        const Task::Ops Task::HeapOps<Fn>::ops = { &invoke, &move, &destroy, false };
+
+
+        /*
+         * 多生产者单消费者的无锁任务队列，EventLoop用它保存其他线程queueInLoop()的回调。
+         *
+         * 主体是定长的环形数组（Dmitry Vyukov的bounded queue）：每个槽带一个序号，
+         * 生产者用CAS抢占enqueuePos_，写入Task后发布序号；消费者只有loop线程一个，不需要CAS。
+         * 环形数组满时退到加锁的overflow_，这之后所有生产者都走overflow_，
+         * 直到消费者把环形数组取空后一次性取走overflow_，保证同一个生产者的任务按提交顺序执行。
+         */
+        class TaskQueue : noncopyable{
+        public:
+            static const size_t kDefaultCapacity = 1024;
+
+            // capacity会向上取整到2的幂
+            explicit TaskQueue(size_t capacity = kDefaultCapacity);
+            ~TaskQueue();
+
+            // 任意线程调用
+            void push(Task&& task);
+
+            // 只能由消费者线程调用：把当前已经发布的任务按顺序移动到out的末尾，返回取出的个数
+            size_t popAll(std::vector<Task>* out);
+
+            // 近似值，任意线程调用，只用于统计
+            size_t sizeApprox() const;
+            // 是否没有已提交（包括已抢占槽位还没发布）的任务，任意线程调用
+            bool empty() const;
+            size_t capacity() const { return mask_ + 1; }
+            // 环形数组满、放进overflow_的任务个数
+            int64_t overflows() const;
+
+        private:
+            struct Cell
+            {
+                std::atomic<size_t> sequence;
+                Task task;
+            };
+
+            bool tryPush(Task& task);
+
+            const size_t mask_;
+            std::unique_ptr<Cell[]> cells_;
+            // 生产者和消费者各自频繁修改的位置放在不同的cache line上
+            char pad0_[64];
+            std::atomic<size_t> enqueuePos_;
+            char pad1_[64 - sizeof(std::atomic<size_t>)];
+            std::atomic<size_t> dequeuePos_;   // 只有消费者修改，原子变量只是为了sizeApprox()
+            std::atomic<bool> overflowing_;
+            mutable MutexLock mutex_;
+            std::vector<Task> overflow_ GUARDED_BY(mutex_);
+            int64_t overflows_ GUARDED_BY(mutex_);
+        };
+
+    }
+}
+
+#endif //MUDUO_NET_TASKQUEUE_H
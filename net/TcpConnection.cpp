@@ -6,17 +6,40 @@
 
 #include "../base/Logging.h"
 #include "../base/WeakCallback.h"
+#include "BufferPool.h"
 #include "Channel.h"
 #include "EventLoop.h"
 #include "SocketsOpts.h"
 #include "Socket.h"
 
 
+#include <algorithm>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <sys/uio.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+    // send(pieces)没写完的数据中，不小于该长度的片段单独占用outputChain_的一个节点
+    const size_t kLargePieceSize = 8 * 1024;
+    // send(data, owner)没写完的部分短于这个长度时直接拷贝进slab，不值得单独挂一个外部节点
+    const size_t kMinExternalSize = 256;
+    // adaptiveGrowth时inputBuffer_最多预留的空间
+    const size_t kMaxReadReserve = 4 * 1024 * 1024;
+    // 前这么多次零拷贝发送的完成通知都显示内核做了拷贝，就不再使用MSG_ZEROCOPY
+    const int64_t kZeroCopyProbes = 16;
+}
+
+const size_t TcpConnection::kDefaultZeroCopyThreshold;
+
 void muduo::net::defaultConnectionCallback(const TcpConnectionPtr& conn)
 {
     LOG_TRACE << conn->localAddress().toIpPort() << " -> "
@@ -33,48 +56,73 @@ void muduo::net::defaultMessageCallback(const TcpConnectionPtr&,
 }
 
 TcpConnection::TcpConnection(EventLoop* loop,
-                             const string& nameArg,
+                             string nameArg,
                              int sockfd,
                              const InetAddress& localAddr,
-                             const InetAddress& peerAddr)
+                             const InetAddress& peerAddr,
+                             int64_t id)
         : loop_(CHECK_NOTNULL(loop)),
-          name_(nameArg),
+          name_(std::move(nameArg)),
+          id_(id),
           state_(kConnecting),
           reading_(true),
-          socket_(new Socket(sockfd)), 			// 已连接socketfd封装的Socket对象
-          channel_(new Channel(loop, sockfd)),    // 构造的channel
+          chainedOutput_(false),
+          socket_(sockfd), 			// 已连接socketfd封装的Socket对象
+          channel_(loop, sockfd),    // 构造的channel
           localAddr_(localAddr),
           peerAddr_(peerAddr),
-          highWaterMark_(64*1024*1024)   // 缓冲区数据最大64M
+          backpressureReadLimit_(0),
+          throttles_(0),
+          throttledCount_(0),
+          throttledMicroseconds_(0),
+          highWaterMark_(64*1024*1024),   // 缓冲区数据最大64M
+          flushQueued_(false),
+          edgeTriggered_(false),
+          writeWaiting_(false),
+          bufferPooling_(false),
+          readSizeEstimate_(0),
+          readCalls_(0),
+          bytesRead_(0),
+          bytesCopied_(0),
+          zeroCopy_(false),
+          zeroCopyThreshold_(kDefaultZeroCopyThreshold),
+          zeroCopyNextSeq_(0),
+          zeroCopySends_(0),
+          zeroCopyCompleted_(0),
+          zeroCopyCopied_(0)
 {
-    // 向Channel对象注册可读事件
-    channel_->setReadCallback(std::bind(&TcpConnection::handleRead, this, _1));
-    channel_->setWriteCallback(std::bind(&TcpConnection::handleWrite, this));
-    channel_->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
-    channel_->setErrorCallback(std::bind(&TcpConnection::handleError, this));
+    // 向Channel对象注册可读事件，只捕获this的lambda放得进std::function内部，不额外分配
+    channel_.setReadCallback([this](Timestamp receiveTime) { handleRead(receiveTime); });
+    channel_.setWriteCallback([this] { handleWrite(); });
+    channel_.setCloseCallback([this] { handleClose(); });
+    channel_.setErrorCallback([this] { handleError(); });
     LOG_DEBUG << "TcpConnection::ctor[" <<  name_ << "] at " << this << " fd=" << sockfd;
+    // 创建时就计入所属loop的连接数，连接建立之前分配新连接时也能看到
+    loop_->countConnection(1);
     // 设置保活机制
-    socket_->setKeepAlive(true);
+    socket_.setKeepAlive(true);
 }
 
 TcpConnection::~TcpConnection()
 {
     LOG_DEBUG << "TcpConnection::dtor[" <<  name_ << "] at " << this
-              << " fd=" << channel_->fd()
+              << " fd=" << channel_.fd()
               << " state=" << stateToString();
     assert(state_ == kDisconnected);
+    // 与构造函数中的加一对应，没有经过connectDestroyed()的连接也不会一直占着计数
+    loop_->countConnection(-1);
 }
 
 bool TcpConnection::getTcpInfo(struct tcp_info* tcpi) const
 {
-    return socket_->getTcpInfo(tcpi);
+    return socket_.getTcpInfo(tcpi);
 }
 
 string TcpConnection::getTcpInfoString() const
 {
     char buf[1024];
     buf[0] = '\0';
-    socket_->getTcpInfoString(buf, sizeof buf);
+    socket_.getTcpInfoString(buf, sizeof buf);
     return buf;
 }
 
@@ -85,20 +133,109 @@ string TcpConnection::getTcpInfoString() const
  * 若读取长度大于0，将接收的数据通过messageCallback_传递到上层应用（这里是TcpServer）。
  * 如果长度等于0，说明对端客户端关闭了连接，调用handleClose()进行关闭处理；
  * 如果小于0，调用handleError()进行错误处理。
+ *
+ * 按readPolicy_可以在一次可读事件中连续读多次，直到socket读空或用完次数/字节预算，
+ * 读到的数据一起交给messageCallback_，减少大批量接收时epoll_wait的往返。
+ *
+ * 边沿触发时不受maxReadsPerEvent限制，一直读到socket读空；用完maxBytesPerEvent时
+ * 不会再有新的通知，所以把剩下的读取放到本轮的pendingFunctors中继续。
  */
 void TcpConnection::handleRead(Timestamp receiveTime) {
     loop_->assertInLoopThread();
+    if (edgeTriggered_ && (!reading_ || throttles_ > 0 || state_ == kDisconnected))
+    {
+        // stopRead()或者背压暂停之后数据留在内核里，由startRead()/解除背压时重新读取
+        return;
+    }
+    lastActive_ = receiveTime;
+    char stackbuf[65536];
+    char* extrabuf = stackbuf;
+    size_t extraLen = sizeof stackbuf;
+    if (readPolicy_.useLoopArena)
+    {
+        extrabuf = loop_->readArena(&extraLen);
+    }
+    if (bufferPooling_)
+    {
+        loop_->bufferPool()->borrow(&inputBuffer_);
+    }
+    if (readPolicy_.adaptiveGrowth)
+    {
+        reserveInputBuffer();
+    }
+
+    size_t budget = readPolicy_.maxBytesPerEvent;
+    if (backpressureReadLimit_ > 0 && (budget == 0 || backpressureReadLimit_ < budget))
+    {
+        budget = backpressureReadLimit_;
+    }
     int saveErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(),&saveErrno);
-    if(n > 0){
+    ssize_t n = 0;
+    size_t total = 0;
+    bool budgetUsed = false;
+    for (int i = 0; edgeTriggered_ || i < readPolicy_.maxReadsPerEvent; ++i)
+    {
+        const size_t writable = inputBuffer_.writableBytes();
+        const size_t room = writable < extraLen ? writable + extraLen : writable;
+        n = inputBuffer_.readFd(channel_.fd(), &saveErrno, extrabuf, extraLen);
+        ++readCalls_;
+        if (n <= 0)
+        {
+            break;
+        }
+        total += n;
+        if (implicit_cast<size_t>(n) > writable)
+        {
+            bytesCopied_ += n - writable;
+        }
+        // 没有读满说明接收缓冲区已经读空，不必再读一次得到EAGAIN；
+        // 边沿触发时之后到达的数据会产生新的通知，同样可以在这里停下
+        if (implicit_cast<size_t>(n) < room)
+        {
+            break;
+        }
+        if (budget > 0 && total >= budget)
+        {
+            budgetUsed = true;
+            break;
+        }
+    }
+
+    if (total > 0)
+    {
+        bytesRead_ += total;
+        readSizeEstimate_ = (readSizeEstimate_ * 3 + total) / 4;
         // 用户提供的处理信息的回调函数（由用户自己提供的函数，比如OnMessage）
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
-    }else if(n == 0){
+    }
+    if (bufferPooling_)
+    {
+        loop_->bufferPool()->giveBack(&inputBuffer_);
+    }
+    if(n == 0){
         handleClose();  // 读到0则表示客户端已经关闭
-    }else{
+    }else if(n < 0 && (saveErrno != EAGAIN || (total == 0 && !edgeTriggered_))){
         errno = saveErrno;
         LOG_SYSERR << "TcpConnection::handleRead";
         handleError();
+    }else if(budgetUsed && edgeTriggered_ && state_ != kDisconnected){
+        loop_->queueInLoop(std::bind(&TcpConnection::handleRead, shared_from_this(), receiveTime));
+    }
+}
+
+// 按最近读到的数据量给inputBuffer_预留可写空间；数据已经处理完、
+// 而缓冲区远大于需要时收缩回去，避免偶尔的大消息让连接一直占着大块内存（使用BufferPool时由池负责）
+void TcpConnection::reserveInputBuffer()
+{
+    const size_t expect = std::min(readSizeEstimate_, kMaxReadReserve);
+    if (inputBuffer_.writableBytes() < expect)
+    {
+        inputBuffer_.ensureWritableBytes(expect);
+    }
+    else if (!bufferPooling_ && inputBuffer_.readableBytes() == 0 &&
+             inputBuffer_.internalCapacity() > 4 * expect + Buffer::kInitialSize)
+    {
+        inputBuffer_.shrink(expect);
     }
 }
 
@@ -116,27 +253,255 @@ void TcpConnection::handleRead(Timestamp receiveTime) {
  */
 void TcpConnection::handleWrite() {
     loop_->assertInLoopThread();
-    if(channel_->isWriting()){
-        ssize_t n = sockets::write(channel_->fd(),
-                                   outputBuffer_.peek(),
-                                   outputBuffer_.readableBytes());
-        if( n > 0){
-            outputBuffer_.retrieve(n);
-            if(outputBuffer_.readableBytes() == 0){ // 发送完毕
-                channel_->disableWriting(); // 不在关注fd的可写事件
+    if(waitingWritable()){
+        lastActive_ = loop_->pollReturnTime();
+        ssize_t n = writeOutput();
+        // 边沿触发下socket一直可写时不会再有通知，要一直写到发完或者EAGAIN
+        while (edgeTriggered_ && n > 0 && outputBytes() > 0){
+            n = writeOutput();
+        }
+        int savedErrno = errno;
+        if (bufferPooling_){
+            loop_->bufferPool()->giveBack(&outputBuffer_);
+        }
+        updateBackpressure();
+        if( n >= 0 || (edgeTriggered_ && savedErrno == EWOULDBLOCK)){
+            if(outputBytes() == 0){ // 发送完毕
+                unwatchWritable(); // 不在关注fd的可写事件
                 if(writeCompleteCallback_){
                     loop_->queueInLoop(std::bind(writeCompleteCallback_,shared_from_this()));
                 }
+                // 调用过shutdown()但当时还有数据没发完，现在可以关闭写端了
+                if (state_ == kDisconnecting){
+                    shutdownInLoop();
+                }
             }
         }else{
+            errno = savedErrno;
             LOG_SYSERR << "TcpConnection::handleWrite";
         }
     }else{ // 已经不可写，不再发送
-        LOG_TRACE << "Connection fd = " << channel_->fd()
+        LOG_TRACE << "Connection fd = " << channel_.fd()
                   << " is down, no more writing";
     }
 }
 
+/*
+ * 是否有数据在等待socket可写。水平触发时就是channel是否关注了可写事件；
+ * 边沿触发时channel一直注册着可写事件，改为在用户空间记录：
+ * 写到EAGAIN（或只写出一部分）后置位，等下一次EPOLLOUT通知，发完后清除，不需要epoll_ctl。
+ */
+bool TcpConnection::waitingWritable() const
+{
+    return edgeTriggered_ ? writeWaiting_ : channel_.isWriting();
+}
+
+void TcpConnection::watchWritable()
+{
+    if (edgeTriggered_)
+    {
+        writeWaiting_ = true;
+    }
+    else
+    {
+        channel_.enableWriting();
+    }
+}
+
+void TcpConnection::unwatchWritable()
+{
+    if (edgeTriggered_)
+    {
+        writeWaiting_ = false;
+    }
+    else
+    {
+        channel_.disableWriting();
+    }
+}
+
+
+/*
+ * cork模式（EventLoop::setCorking()）下，loop线程中的send()不直接写socket，
+ * 数据先追加到输出缓冲区，连接登记到本轮迭代结束时统一flush，返回true表示已暂存。
+ * 已经在关注可写事件（有积压）时按原来的方式排队。
+ */
+bool TcpConnection::corkSend()
+{
+    if (!loop_->corking() || waitingWritable())
+    {
+        return false;
+    }
+    loop_->countCorkedSend();
+    if (!flushQueued_)
+    {
+        flushQueued_ = true;
+        loop_->runAtIterationEnd(std::bind(&TcpConnection::flushCorked, shared_from_this()));
+    }
+    return true;
+}
+
+// 有数据等待发送：已登记cork flush时由flushCorked()处理，否则关注可写事件
+void TcpConnection::scheduleWrite()
+{
+    if (!flushQueued_ && !waitingWritable())
+    {
+        watchWritable();
+    }
+    updateBackpressure();
+}
+
+// 本轮迭代结束时把暂存的数据用一次write/writev发出，没写完的部分交给handleWrite()
+void TcpConnection::flushCorked()
+{
+    loop_->assertInLoopThread();
+    flushQueued_ = false;
+    if (state_ == kDisconnected)
+    {
+        return;
+    }
+    if (outputBytes() == 0)
+    {
+        // 只有零长度的send()：与直接write(2)时一样通知写完，补上被推迟的shutdown
+        if (writeCompleteCallback_)
+        {
+            loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+        }
+        if (state_ == kDisconnecting)
+        {
+            shutdownInLoop();
+        }
+        return;
+    }
+    loop_->countCorkFlush();
+    ssize_t n = writeOutput();
+    int savedErrno = errno;
+    if (bufferPooling_)
+    {
+        loop_->bufferPool()->giveBack(&outputBuffer_);
+    }
+    updateBackpressure();
+    if (n < 0 && savedErrno != EWOULDBLOCK)
+    {
+        errno = savedErrno;
+        LOG_SYSERR << "TcpConnection::flushCorked";
+    }
+    if (outputBytes() == 0)
+    {
+        if (writeCompleteCallback_)
+        {
+            loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+        }
+        if (state_ == kDisconnecting)
+        {
+            shutdownInLoop();
+        }
+    }
+    else if (!waitingWritable())
+    {
+        watchWritable();
+    }
+}
+
+/*
+ * outputChain_为空时与原来一样对outputBuffer_调用一次write(2)；
+ * 否则outputBuffer_（排在前面）和outputChain_中文件节点之前的各个slab组成iovec，一次writev(2)发送，
+ * 写出的字节先从outputBuffer_中扣除，剩下的从outputChain_中扣除。
+ * 轮到文件节点时用sendfile(2)发送，开启零拷贝时由owner持有的大块数据用MSG_ZEROCOPY发送，
+ * 某次没有写完（socket发送缓冲区已满）就返回。
+ */
+ssize_t TcpConnection::writeOutput()
+{
+    if (outputChain_.readableBytes() == 0)
+    {
+        ssize_t n = sockets::write(channel_.fd(),
+                                   outputBuffer_.peek(),
+                                   outputBuffer_.readableBytes());
+        if (n > 0)
+        {
+            outputBuffer_.retrieve(n);
+        }
+        return n;
+    }
+
+    ssize_t total = 0;
+    while (outputBytes() > 0)
+    {
+        ssize_t n = 0;
+        size_t expected = 0;
+        off_t offset = 0;
+        size_t len = 0;
+        const size_t buffered = outputBuffer_.readableBytes();
+        std::shared_ptr<const void> owner;
+        if (zeroCopy_ && buffered == 0 && outputChain_.peekableBytes() >= zeroCopyThreshold_)
+        {
+            owner = outputChain_.peekOwner();
+        }
+        int filefd = buffered == 0 ? outputChain_.peekFile(&offset, &len) : -1;
+        if (owner)
+        {
+            // 链表头是由owner持有的大块数据，用MSG_ZEROCOPY发送
+            expected = outputChain_.peekableBytes();
+            n = sendZeroCopy(outputChain_.peek(), expected, owner);
+            if (n > 0)
+            {
+                outputChain_.retrieve(n);
+            }
+        }
+        else if (filefd >= 0)
+        {
+            expected = len;
+            n = sockets::sendfile(channel_.fd(), filefd, &offset, len);
+            if (n == 0)
+            {
+                // 文件比sendFile()时给定的长度短，剩下的部分无法发送
+                LOG_ERROR << "TcpConnection::writeOutput [" << name_
+                          << "] - file is shorter than expected, drop " << len << " bytes";
+                outputChain_.retrieve(len);
+                continue;
+            }
+            if (n > 0)
+            {
+                outputChain_.retrieve(n);
+            }
+        }
+        else
+        {
+            struct iovec vec[IOV_MAX];
+            int iovcnt = 0;
+            if (buffered > 0)
+            {
+                vec[0].iov_base = const_cast<char*>(outputBuffer_.peek());
+                vec[0].iov_len = buffered;
+                iovcnt = 1;
+            }
+            iovcnt += outputChain_.fillIovec(vec + iovcnt, IOV_MAX - iovcnt);
+            for (int i = 0; i < iovcnt; ++i)
+            {
+                expected += vec[i].iov_len;
+            }
+            n = sockets::writev(channel_.fd(), vec, iovcnt);
+            if (n > 0)
+            {
+                size_t fromBuffer = std::min(buffered, implicit_cast<size_t>(n));
+                outputBuffer_.retrieve(fromBuffer);
+                outputChain_.retrieve(n - fromBuffer);
+            }
+        }
+
+        if (n < 0)
+        {
+            return total > 0 ? total : n;
+        }
+        total += n;
+        if (implicit_cast<size_t>(n) < expected)
+        {
+            break;
+        }
+    }
+    return total;
+}
+
 
 /*
  * 关闭事件流程复杂一些。首先channel不再关注任何IO事件，
@@ -148,14 +513,14 @@ void TcpConnection::handleWrite() {
  */
 // 当对端调用shutdown()关闭连接时，本端会收到一个FIN，
 // channel的读事件被触发，但inputBuffer_.readFd() 会返回0，然后调用
-// handleClose()，处理关闭事件，最后调用TcpServer::removeConnection()。
+// handleClose()，处理关闭事件，最后调用closeCallback_（TcpServer中从本loop的连接表删除）。
 void TcpConnection::handleClose() {
     loop_->assertInLoopThread();
-    LOG_TRACE << "fd = " << channel_->fd() << "state = " << stateToString();
-    assert(state_ == kConnected || state_ == kDisconnected);
+    LOG_TRACE << "fd = " << channel_.fd() << "state = " << stateToString();
+    assert(state_ == kConnected || state_ == kDisconnecting);
     //我们不关闭fd，而是将其留给dtor，这样我们就可以很容易地发现泄漏
     setState(kDisconnected); // 设置为已断开状态
-    channel_->disableAll(); // channel上不再关注任何事情
+    channel_.disableAll(); // channel上不再关注任何事情
 
     TcpConnectionPtr guardThis(shared_from_this()); // 必须使用智能指针
     connectionCallback_(guardThis);  // 回调用户的连接处理回调函数
@@ -174,10 +539,60 @@ void TcpConnection::connectDestroyed() {
     loop_->assertInLoopThread();
     if(state_ == kConnected){
         setState(kDisconnected);
-        channel_->disableAll();
+        channel_.disableAll();
         connectionCallback_(shared_from_this());
     }
-    channel_->remove();
+    channel_.remove();
+    giveBackBuffers();
+    if (bufferPooling_)
+    {
+        // 还有数据的缓冲区不会再还给池，存储随连接一起释放
+        BufferPool* pool = loop_->bufferPool();
+        pool->forget(inputBuffer_);
+        pool->forget(outputBuffer_);
+    }
+    // 剩下的数据不会再发出去，被本连接暂停的reader恢复读取，并删除本连接要求的读取上限
+    const TcpConnection* source = this;
+    for (const BackpressureReader& r : backpressureReaders_)
+    {
+        TcpConnectionPtr reader(r.reader.lock());
+        if (!reader)
+        {
+            continue;
+        }
+        const bool throttling = r.throttling;
+        if (reader.get() == this)
+        {
+            if (throttling)
+            {
+                unthrottleReadInLoop();
+            }
+            setBackpressureReadLimit(this, 0);
+        }
+        else
+        {
+            reader->getLoop()->runInLoop([reader, source, throttling]
+            {
+                if (throttling)
+                {
+                    reader->unthrottleReadInLoop();
+                }
+                reader->setBackpressureReadLimit(source, 0);
+            });
+        }
+    }
+    backpressureReaders_.clear();
+}
+
+// 使用BufferPool时，把两个缓冲区中已经空了的存储还给池
+void TcpConnection::giveBackBuffers()
+{
+    if (bufferPooling_)
+    {
+        BufferPool* pool = loop_->bufferPool();
+        pool->giveBack(&inputBuffer_);
+        pool->giveBack(&outputBuffer_);
+    }
 }
 
 /*
@@ -229,6 +644,31 @@ void TcpConnection::send(Buffer* buf)
     }
 }
 
+void TcpConnection::send(const StringPiece* pieces, int count)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(pieces, count);
+        }
+        else
+        {
+            // 跨线程时调用者的内存随时可能失效，每个片段各拷贝一份，但仍不拼接
+            std::shared_ptr<std::vector<string>> copies(new std::vector<string>);
+            copies->reserve(count);
+            for (int i = 0; i < count; ++i)
+            {
+                copies->push_back(pieces[i].as_string());
+            }
+            loop_->runInLoop(
+                    std::bind(&TcpConnection::sendPiecesInLoop,
+                              this,     // FIXME
+                              copies));
+        }
+    }
+}
+
 /*
  *sendInLoop()会先尝试直接发送数据，如果一次发送完毕就不会启用WriteCallback；
  * 如果只发送了部分数据，则把剩余的数据放入outputBuffer_，
@@ -252,8 +692,8 @@ void TcpConnection::sendInLoop(const void* data, size_t len){
         return;
     }
     // 如果当前channel没有写事件发生，并且发送buffer无待发送数据，那么直接发送
-    if(!channel_->isWriting() && outputBuffer_.readableBytes()==0){
-        nwrote = sockets::write(channel_->fd(),data,len);
+    if(!corkSend() && !waitingWritable() && outputBytes()==0){
+        nwrote = sockets::write(channel_.fd(),data,len);
         if(nwrote >= 0){
             remaining = len - nwrote;
             if(remaining == 0 && writeCompleteCallback_){
@@ -274,7 +714,7 @@ void TcpConnection::sendInLoop(const void* data, size_t len){
     assert(remaining <= len);
 
     if(!faultError && remaining > 0){
-        size_t  oldLen = outputBuffer_.readableBytes();
+        size_t  oldLen = outputBytes();
 
         // 如果输出缓冲区的数据已经缓冲区最大长度，那么调用highWaterMarkCallback_---告知越界
         if (oldLen + remaining >= highWaterMark_  && oldLen < highWaterMark_ && highWaterMarkCallback_)
@@ -283,16 +723,426 @@ void TcpConnection::sendInLoop(const void* data, size_t len){
             loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
         }
 
-        // 把数据添加到输出缓冲区中
-        outputBuffer_.append(static_cast<const char*>(data)+nwrote, remaining);
+        // 把数据添加到输出缓冲区中，outputChain_中已有数据时必须追加在它后面以保证顺序
+        if (chainedOutput_ || outputChain_.readableBytes() > 0)
+        {
+            outputChain_.append(static_cast<const char*>(data)+nwrote, remaining);
+        }
+        else
+        {
+            if (bufferPooling_)
+            {
+                loop_->bufferPool()->borrow(&outputBuffer_);
+            }
+            outputBuffer_.append(static_cast<const char*>(data)+nwrote, remaining);
+        }
         // 监听channel的可写事件（因为还有数据未发完），
         // 当可写事件被触发，就可以继续发送了，调用的是TcpConnection::handleWrite()
-        if(!channel_->isWriting()){
-            channel_->enableWriting();
+        scheduleWrite();
+    }
+}
+
+
+namespace
+{
+    // 持有sendFile()中dup出来的fd，发送完成（或连接销毁）后关闭
+    class FileCloser : noncopyable
+    {
+    public:
+        explicit FileCloser(int fd) : fd_(fd) { }
+        ~FileCloser() { ::close(fd_); }
+        int fd() const { return fd_; }
+
+    private:
+        const int fd_;
+    };
+}
+
+/*
+ * 文件fd先dup一份，由输出队列持有，调用者发送后即可关闭自己的fd。
+ * 文件区间与普通数据一起按顺序排在outputChain_中，轮到它时用sendfile(2)发送，数据不拷贝到用户空间。
+ */
+void TcpConnection::sendFile(int fd, off_t offset, size_t len)
+{
+    if (state_ == kConnected)
+    {
+        int dupfd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (dupfd < 0)
+        {
+            LOG_SYSERR << "TcpConnection::sendFile";
+            return;
+        }
+        std::shared_ptr<FileCloser> file(new FileCloser(dupfd));
+        if (loop_->isInLoopThread())
+        {
+            sendFileInLoop(file, offset, len);
+        }
+        else
+        {
+            loop_->runInLoop(
+                    std::bind(&TcpConnection::sendFileInLoop,
+                              this,     // FIXME
+                              file, offset, len));
+        }
+    }
+}
+
+void TcpConnection::sendFileInLoop(const std::shared_ptr<void>& file, off_t offset, size_t len)
+{
+    loop_->assertInLoopThread();
+    const int filefd = static_cast<FileCloser*>(file.get())->fd();
+    size_t nwrote = 0;
+    bool faultError = false;
+    if (state_ == kDisconnected)
+    {
+        LOG_WARN << "disconnected, give up writing";
+        return;
+    }
+
+    if (!corkSend() && !waitingWritable() && outputBytes() == 0)
+    {
+        off_t off = offset;
+        ssize_t n = sockets::sendfile(channel_.fd(), filefd, &off, len);
+        if (n >= 0)
+        {
+            nwrote = n;
+            if (nwrote == len && writeCompleteCallback_)
+            {
+                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+            }
+        }
+        else if (errno != EWOULDBLOCK)
+        {
+            LOG_SYSERR << "TcpConnection::sendFileInLoop";
+            if (errno == EPIPE || errno == ECONNRESET) // FIXME: any others?
+            {
+                faultError = true;
+            }
+        }
+    }
+
+    size_t remaining = len - nwrote;
+    if (!faultError && remaining > 0)
+    {
+        size_t oldLen = outputBytes();
+        if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
+        {
+            loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+        }
+        outputChain_.appendFile(filefd, offset + static_cast<off_t>(nwrote), remaining, file);
+        scheduleWrite();
+    }
+}
+
+void TcpConnection::send(const StringPiece& data, const std::shared_ptr<const void>& owner)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendSharedInLoop(data, owner);
+        }
+        else
+        {
+            // data指向owner持有的内存，跨线程也不需要拷贝；
+            // 广播时常从别的线程发送，持有shared_ptr保证执行时连接还在
+            loop_->runInLoop(
+                    std::bind(&TcpConnection::sendSharedInLoop,
+                              shared_from_this(),
+                              data, owner));
+        }
+    }
+}
+
+void TcpConnection::send(const SharedMessage& message)
+{
+    if (!message.empty())
+    {
+        send(message.toStringPiece(), message.payload());
+    }
+}
+
+void TcpConnection::sendSharedInLoop(const StringPiece& data, const std::shared_ptr<const void>& owner)
+{
+    loop_->assertInLoopThread();
+    const size_t len = data.size();
+    size_t nwrote = 0;
+    bool faultError = false;
+    if (state_ == kDisconnected)
+    {
+        LOG_WARN << "disconnected, give up writing";
+        return;
+    }
+
+    if (!corkSend() && !waitingWritable() && outputBytes() == 0)
+    {
+        ssize_t n = zeroCopy_ && len >= zeroCopyThreshold_
+                    ? sendZeroCopy(data.data(), len, owner)
+                    : sockets::write(channel_.fd(), data.data(), len);
+        if (n >= 0)
+        {
+            nwrote = n;
+            if (nwrote == len && writeCompleteCallback_)
+            {
+                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+            }
+        }
+        else if (errno != EWOULDBLOCK)
+        {
+            LOG_SYSERR << "TcpConnection::sendSharedInLoop";
+            if (errno == EPIPE || errno == ECONNRESET) // FIXME: any others?
+            {
+                faultError = true;
+            }
         }
     }
+
+    size_t remaining = len - nwrote;
+    if (!faultError && remaining > 0)
+    {
+        size_t oldLen = outputBytes();
+        if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
+        {
+            loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+        }
+        if (remaining < kMinExternalSize)
+        {
+            outputChain_.append(data.data() + nwrote, remaining);
+        }
+        else
+        {
+            outputChain_.appendExternal(data.data() + nwrote, remaining, owner);
+        }
+        scheduleWrite();
+    }
+}
+
+/*
+ * 用MSG_ZEROCOPY发送时内核直接引用用户内存，send()返回后数据仍可能在被读取，
+ * 所以要把owner按内核的编号（每次成功的send加1）保存起来，直到错误队列中出现对应的完成通知。
+ * optmem不足（ENOBUFS）时本次退回普通的write(2)。
+ */
+ssize_t TcpConnection::sendZeroCopy(const char* data, size_t len, const std::shared_ptr<const void>& owner)
+{
+#ifdef MSG_ZEROCOPY
+    ssize_t n = sockets::send(channel_.fd(), data, len, MSG_ZEROCOPY);
+    if (n >= 0)
+    {
+        zeroCopyPending_.push_back(ZeroCopyEntry(zeroCopyNextSeq_++, owner));
+        ++zeroCopySends_;
+        return n;
+    }
+    if (errno != ENOBUFS)
+    {
+        return n;
+    }
+#endif
+    return sockets::write(channel_.fd(), data, len);
+}
+
+bool TcpConnection::setZeroCopy(bool on, size_t threshold)
+{
+    loop_->assertInLoopThread();
+    zeroCopyThreshold_ = threshold;
+    if (on == zeroCopy_)
+    {
+        return true;
+    }
+    if (on)
+    {
+#if defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+        if (socket_.setZeroCopy(true))
+        {
+            channel_.setErrQueueCallback([this] { handleErrQueue(); });
+            zeroCopy_ = true;
+        }
+#else
+        LOG_ERROR << "TcpConnection::setZeroCopy - MSG_ZEROCOPY is not supported";
+#endif
+        return zeroCopy_;
+    }
+    // 已经发出的零拷贝数据仍然等待完成通知，SO_ZEROCOPY保持打开
+    zeroCopy_ = false;
+    return true;
 }
 
+/*
+ * POLLERR时读取socket错误队列，MSG_ZEROCOPY的完成通知以sock_extended_err的形式给出，
+ * ee_info..ee_data是完成的send编号区间。错误队列中没有完成通知时按普通错误处理。
+ */
+void TcpConnection::handleErrQueue()
+{
+    loop_->assertInLoopThread();
+    bool notified = false;
+#ifdef SO_EE_ORIGIN_ZEROCOPY
+    while (true)
+    {
+        char control[128];
+        struct msghdr msg;
+        memZero(&msg, sizeof msg);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+        if (sockets::recvmsg(channel_.fd(), &msg, MSG_ERRQUEUE) < 0)
+        {
+            break;  // EAGAIN，错误队列已读空
+        }
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                  (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+            {
+                continue;
+            }
+            struct sock_extended_err serr;
+            ::memcpy(&serr, CMSG_DATA(cm), sizeof serr);
+            if (serr.ee_origin == SO_EE_ORIGIN_ZEROCOPY && serr.ee_errno == 0)
+            {
+                notified = true;
+                handleZeroCopyCompletion(serr.ee_info, serr.ee_data,
+                                         (serr.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0);
+            }
+        }
+    }
+#endif
+    if (!notified)
+    {
+        handleError();
+    }
+}
+
+void TcpConnection::handleZeroCopyCompletion(uint32_t lo, uint32_t hi, bool copied)
+{
+    const int64_t count = static_cast<int64_t>(hi - lo) + 1;
+    zeroCopyCompleted_ += count;
+    if (copied)
+    {
+        zeroCopyCopied_ += count;
+    }
+    // TCP的完成通知按顺序到达，释放编号不大于hi的所有数据
+    std::vector<ZeroCopyEntry>::iterator it = zeroCopyPending_.begin();
+    while (it != zeroCopyPending_.end() && static_cast<int32_t>(it->first - hi) <= 0)
+    {
+        ++it;
+    }
+    zeroCopyPending_.erase(zeroCopyPending_.begin(), it);
+
+    if (zeroCopy_ && zeroCopyCompleted_ >= kZeroCopyProbes && zeroCopyCopied_ == zeroCopyCompleted_)
+    {
+        // 内核每次都做了拷贝（loopback、网卡不支持scatter-gather等），零拷贝只剩额外开销
+        LOG_INFO << "TcpConnection::handleZeroCopyCompletion [" << name_
+                 << "] - kernel always copies, fall back to normal send";
+        zeroCopy_ = false;
+    }
+}
+
+void TcpConnection::sendPiecesInLoop(const std::shared_ptr<std::vector<string>>& pieces)
+{
+    std::vector<StringPiece> vec(pieces->begin(), pieces->end());
+    sendInLoop(vec.data(), static_cast<int>(vec.size()));
+}
+
+/*
+ * 与sendInLoop(data, len)的流程相同：没有待发送数据时直接writev(2)，
+ * 每次最多IOV_MAX个片段，某一批没有写完就停止；
+ * 剩余的数据全部追加到outputChain_，小片段拷贝进slab，大片段各自独占一个节点。
+ */
+void TcpConnection::sendInLoop(const StringPiece* pieces, int count)
+{
+    loop_->assertInLoopThread();
+    size_t len = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        len += pieces[i].size();
+    }
+    size_t nwrote = 0;
+    bool faultError = false;
+    if (state_ == kDisconnected)
+    {
+        LOG_WARN << "disconnected, give up writing";
+        return;
+    }
+
+    if (!corkSend() && !waitingWritable() && outputBytes() == 0)
+    {
+        int first = 0;
+        while (first < count)
+        {
+            struct iovec vec[IOV_MAX];
+            int iovcnt = 0;
+            size_t batch = 0;
+            for (; first < count && iovcnt < IOV_MAX; ++first)
+            {
+                if (pieces[first].size() > 0)
+                {
+                    vec[iovcnt].iov_base = const_cast<char*>(pieces[first].data());
+                    vec[iovcnt].iov_len = pieces[first].size();
+                    batch += vec[iovcnt].iov_len;
+                    ++iovcnt;
+                }
+            }
+            if (iovcnt == 0)
+            {
+                break;
+            }
+            ssize_t n = sockets::writev(channel_.fd(), vec, iovcnt);
+            if (n < 0)
+            {
+                if (errno != EWOULDBLOCK)
+                {
+                    LOG_SYSERR << "TcpConnection::sendInLoop";
+                    if (errno == EPIPE || errno == ECONNRESET) // FIXME: any others?
+                    {
+                        faultError = true;
+                    }
+                }
+                break;
+            }
+            nwrote += n;
+            if (implicit_cast<size_t>(n) < batch)
+            {
+                break;
+            }
+        }
+        if (nwrote == len && writeCompleteCallback_)
+        {
+            loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+        }
+    }
+
+    size_t remaining = len - nwrote;
+    if (!faultError && remaining > 0)
+    {
+        size_t oldLen = outputBytes();
+        if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
+        {
+            loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+        }
+
+        size_t skip = nwrote;
+        for (int i = 0; i < count; ++i)
+        {
+            const char* data = pieces[i].data();
+            size_t size = pieces[i].size();
+            if (skip >= size)
+            {
+                skip -= size;
+                continue;
+            }
+            data += skip;
+            size -= skip;
+            skip = 0;
+            if (size >= kLargePieceSize)
+            {
+                outputChain_.appendBlock(data, size);
+            }
+            else
+            {
+                outputChain_.append(data, size);
+            }
+        }
+        scheduleWrite();
+    }
+}
 
 void TcpConnection::shutdown()
 {
@@ -308,10 +1158,11 @@ void TcpConnection::shutdown()
 void TcpConnection::shutdownInLoop()
 {
     loop_->assertInLoopThread();
-    if (!channel_->isWriting())
+    // 还有暂存等待本轮结束flush的数据时，由flushCorked()发完后再关闭写端
+    if (!waitingWritable() && !flushQueued_)
     {
         // we are not writing
-        socket_->shutdownWrite();
+        socket_.shutdownWrite();
     }
 }
 
@@ -368,7 +1219,7 @@ const char* TcpConnection::stateToString() const
 
 void TcpConnection::setTcpNoDelay(bool on)
 {
-    socket_->setTcpNoDelay(on);
+    socket_.setTcpNoDelay(on);
 }
 
 void TcpConnection::startRead()
@@ -379,9 +1230,23 @@ void TcpConnection::startRead()
 void TcpConnection::startReadInLoop()
 {
     loop_->assertInLoopThread();
-    if (!reading_ || !channel_->isReading())
+    if (throttles_ > 0)
     {
-        channel_->enableReading();
+        // 背压解除时再开始
+        reading_ = true;
+    }
+    else if (edgeTriggered_)
+    {
+        // 边沿触发时stopRead()期间到达的数据不会再有通知，主动读一次
+        if (!reading_)
+        {
+            reading_ = true;
+            loop_->queueInLoop(std::bind(&TcpConnection::handleRead, shared_from_this(), Timestamp::now()));
+        }
+    }
+    else if (!reading_ || !channel_.isReading())
+    {
+        channel_.enableReading();
         reading_ = true;
     }
 }
@@ -394,28 +1259,269 @@ void TcpConnection::stopRead()
 void TcpConnection::stopReadInLoop()
 {
     loop_->assertInLoopThread();
-    if (reading_ || channel_->isReading())
+    if (edgeTriggered_)
+    {
+        // 不修改epoll注册，只是不再读取，数据留在socket接收缓冲区中由TCP流控
+        reading_ = false;
+    }
+    else if (reading_ || channel_.isReading())
     {
-        channel_->disableReading();
+        if (channel_.isReading())
+        {
+            channel_.disableReading();
+        }
         reading_ = false;
     }
 }
 
+void TcpConnection::setReadBackpressure(size_t highMark, size_t lowMark)
+{
+    setBackpressureReadLimit(this, highMark);
+    setBackpressureReader(shared_from_this(), highMark, lowMark);
+}
+
+void TcpConnection::linkReadBackpressure(const TcpConnectionPtr& a, const TcpConnectionPtr& b,
+                                         size_t highMark, size_t lowMark)
+{
+    watchBackpressure(b, a, highMark, lowMark);
+    watchBackpressure(a, b, highMark, lowMark);
+}
+
+// 在source的loop中把reader登记为source的reader，在reader的loop中限制reader的单次读取量
+void TcpConnection::watchBackpressure(const TcpConnectionPtr& source, const TcpConnectionPtr& reader,
+                                      size_t highMark, size_t lowMark)
+{
+    source->getLoop()->runInLoop([source, reader, highMark, lowMark]
+    {
+        source->setBackpressureReader(reader, highMark, lowMark);
+    });
+    reader->getLoop()->runInLoop([source, reader, highMark]
+    {
+        reader->setBackpressureReadLimit(source.get(), highMark);
+    });
+}
+
+void TcpConnection::setBackpressureReader(const TcpConnectionPtr& reader, size_t highMark, size_t lowMark)
+{
+    auto it = std::find_if(backpressureReaders_.begin(), backpressureReaders_.end(),
+                           [&reader](const BackpressureReader& r) { return r.reader.lock() == reader; });
+    if (highMark == 0)
+    {
+        // 删除：已经被暂停的reader恢复，其他reader不受影响
+        if (it != backpressureReaders_.end())
+        {
+            const bool throttling = it->throttling;
+            backpressureReaders_.erase(it);
+            if (throttling)
+            {
+                notifyBackpressureReader(reader, false);
+            }
+        }
+        return;
+    }
+    if (it == backpressureReaders_.end())
+    {
+        BackpressureReader r;
+        r.reader = reader;
+        r.throttling = false;
+        it = backpressureReaders_.insert(backpressureReaders_.end(), r);
+    }
+    it->highMark = highMark;
+    it->lowMark = std::min(lowMark, highMark);
+    updateBackpressure();
+}
+
+/*
+ * 待发送数据增加（scheduleWrite()）和减少（handleWrite()/flushCorked()）之后检查水位，
+ * 在highMark和lowMark之间不改变状态，避免在一个水位附近反复暂停、恢复。
+ */
+void TcpConnection::updateBackpressure()
+{
+    if (backpressureReaders_.empty())
+    {
+        return;
+    }
+    const size_t bytes = outputBytes();
+    size_t i = 0;
+    while (i < backpressureReaders_.size())
+    {
+        BackpressureReader& r = backpressureReaders_[i];
+        if (r.throttling ? bytes > r.lowMark : bytes <= r.highMark)
+        {
+            ++i;
+            continue;
+        }
+        TcpConnectionPtr reader(r.reader.lock());
+        if (!reader)
+        {
+            backpressureReaders_[i] = backpressureReaders_.back();
+            backpressureReaders_.pop_back();
+            continue;
+        }
+        r.throttling = !r.throttling;
+        notifyBackpressureReader(reader, r.throttling);
+        ++i;
+    }
+}
+
+void TcpConnection::notifyBackpressureReader(const TcpConnectionPtr& reader, bool throttle)
+{
+    if (reader.get() == this)
+    {
+        throttle ? throttleReadInLoop() : unthrottleReadInLoop();
+    }
+    else if (throttle)
+    {
+        // reader可能属于其他loop，同一个来源的暂停和恢复按顺序在reader的loop中执行
+        reader->getLoop()->runInLoop([reader] { reader->throttleReadInLoop(); });
+    }
+    else
+    {
+        reader->getLoop()->runInLoop([reader] { reader->unthrottleReadInLoop(); });
+    }
+}
+
+void TcpConnection::setBackpressureReadLimit(const TcpConnection* source, size_t limit)
+{
+    auto it = std::find_if(backpressureReadLimits_.begin(), backpressureReadLimits_.end(),
+                           [source](const std::pair<const TcpConnection*, size_t>& p) { return p.first == source; });
+    if (limit == 0)
+    {
+        if (it != backpressureReadLimits_.end())
+        {
+            backpressureReadLimits_.erase(it);
+        }
+    }
+    else if (it != backpressureReadLimits_.end())
+    {
+        it->second = limit;
+    }
+    else
+    {
+        backpressureReadLimits_.push_back(std::make_pair(source, limit));
+    }
+    backpressureReadLimit_ = 0;
+    for (const auto& p : backpressureReadLimits_)
+    {
+        if (backpressureReadLimit_ == 0 || p.second < backpressureReadLimit_)
+        {
+            backpressureReadLimit_ = p.second;
+        }
+    }
+}
+
+void TcpConnection::throttleReadInLoop()
+{
+    loop_->assertInLoopThread();
+    if (++throttles_ > 1)
+    {
+        return;
+    }
+    ++throttledCount_;
+    throttledSince_ = Timestamp::now();
+    // 边沿触发时handleRead()检查throttles_，不修改epoll注册
+    if (!edgeTriggered_ && state_ != kDisconnected && channel_.isReading())
+    {
+        channel_.disableReading();
+    }
+}
+
+void TcpConnection::unthrottleReadInLoop()
+{
+    loop_->assertInLoopThread();
+    assert(throttles_ > 0);
+    if (--throttles_ > 0)
+    {
+        return;
+    }
+    throttledMicroseconds_ += Timestamp::now().microSecondsSinceEpoch() - throttledSince_.microSecondsSinceEpoch();
+    if (!reading_ || state_ == kDisconnected)
+    {
+        return;
+    }
+    if (edgeTriggered_)
+    {
+        // 暂停期间到达的数据不会再有通知，主动读一次
+        loop_->queueInLoop(std::bind(&TcpConnection::handleRead, shared_from_this(), Timestamp::now()));
+    }
+    else if (!channel_.isReading())
+    {
+        channel_.enableReading();
+    }
+}
+
+double TcpConnection::throttledSeconds() const
+{
+    int64_t us = throttledMicroseconds_;
+    if (throttles_ > 0)
+    {
+        us += Timestamp::now().microSecondsSinceEpoch() - throttledSince_.microSecondsSinceEpoch();
+    }
+    return static_cast<double>(us) / Timestamp::kMicroSecondsPerSecond;
+}
+
 void TcpConnection::connectEstablished()
 {
     loop_->assertInLoopThread();
     assert(state_ == kConnecting);
     setState(kConnected);
-    channel_->tie(shared_from_this());
-    channel_->enableReading();
+    lastActive_ = Timestamp::now();
+    channel_.tie(shared_from_this());
+    if (edgeTriggered_)
+    {
+        channel_.enableEdgeTriggered();
+    }
+    else
+    {
+        channel_.enableReading();
+    }
+    giveBackBuffers();
 
     connectionCallback_(shared_from_this());
 }
 
 
+bool TcpConnection::setEdgeTriggered(bool on)
+{
+    if (on == edgeTriggered_)
+    {
+        return true;
+    }
+    if (on && !loop_->supportsEdgeTriggered())
+    {
+        LOG_WARN << "TcpConnection::setEdgeTriggered [" << name_ << "] - poller does not support EPOLLET";
+        return false;
+    }
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        // 已经注册过，切换注册方式并把是否在等待可写转移过去
+        loop_->assertInLoopThread();
+        if (on)
+        {
+            writeWaiting_ = channel_.isWriting();
+            channel_.enableEdgeTriggered();
+        }
+        else
+        {
+            channel_.disableEdgeTriggered();
+            if (!reading_ || throttles_ > 0)
+            {
+                channel_.disableReading();
+            }
+            if (writeWaiting_)
+            {
+                channel_.enableWriting();
+            }
+            writeWaiting_ = false;
+        }
+    }
+    edgeTriggered_ = on;
+    return true;
+}
+
 void TcpConnection::handleError()
 {
-    int err = sockets::getSocketError(channel_->fd());
+    int err = sockets::getSocketError(channel_.fd());
     LOG_ERROR << "TcpConnection::handleError [" << name_
               << "] - SO_ERROR = " << err << " " << strerror_tl(err);
 }
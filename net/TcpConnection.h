@@ -10,30 +10,52 @@
 #include "../base/Types.h"
 #include "Callbacks.h"
 #include "Buffer.h"
+#include "ChainBuffer.h"
+#include "Channel.h"
 #include "InetAddress.h"
+#include "SharedMessage.h"
+#include "Socket.h"
 
 #include <memory>
+#include <vector>
 #include <boost/any.hpp>
 
 struct tcp_info;
 
 namespace muduo{
     namespace net{
-        class Channel;
         class EventLoop;
-        class Socket;
+
+        // 每次可读事件中TcpConnection::handleRead()的读取策略，默认与原来一样只readv一次
+        struct ReadPolicy
+        {
+            ReadPolicy()
+                    : maxReadsPerEvent(1),
+                      maxBytesPerEvent(0),
+                      useLoopArena(false),
+                      adaptiveGrowth(false)
+            { }
+
+            int maxReadsPerEvent;     // 最多读几次，上一次没有读满（socket已读空）就提前结束
+            size_t maxBytesPerEvent;  // 最多读多少字节，0表示不限，避免一个连接占住整个loop
+            bool useLoopArena;        // inputBuffer_放不下的数据读到EventLoop::readArena()，而不是栈上的64KB
+            bool adaptiveGrowth;      // 按最近读到的数据量预先扩大inputBuffer_，大消息直接读进去，不再经过extrabuf拷贝
+        };
 
         class TcpConnection : noncopyable,
                               public std::enable_shared_from_this<TcpConnection>{
 
         public:
-            TcpConnection(EventLoop* loop,const string& name,
-                          int sockfd,const InetAddress& localAddr,const InetAddress& peerAddr);
+            // id由创建者分配（TcpServer中每个连接唯一），0表示未分配
+            TcpConnection(EventLoop* loop,string name,
+                          int sockfd,const InetAddress& localAddr,const InetAddress& peerAddr,
+                          int64_t id = 0);
             ~TcpConnection();
 
             // 获取当前TcpConnetction的一些属性、状态
             EventLoop* getLoop() const { return loop_; }
             const string& name() const { return name_; }
+            int64_t id() const { return id_; }
             const InetAddress& localAddress() const { return localAddr_; }
             const InetAddress& peerAddress() const { return peerAddr_; }
             bool connected() const { return state_ == kConnected; }
@@ -48,6 +70,17 @@ namespace muduo{
             void send(const StringPiece& message);
             // void send(Buffer&& message); // C++11
             void send(Buffer* message);  // this one will swap data
+            // 分散/聚集发送：pieces按顺序用writev(2)直接写出，不先拼接到outputBuffer_中；
+            // 没写完的部分追加到outputChain_，大块数据单独占用一个节点
+            void send(const StringPiece* pieces, int count);
+            // 发送一段由owner持有的内存，不拷贝：没写完的部分以引用方式进入输出队列，
+            // owner在数据发出（开启零拷贝时为内核确认完成）之前一直保持有效
+            void send(const StringPiece& data, const std::shared_ptr<const void>& owner);
+            // 发送引用计数的消息，跨线程和没写完时都不拷贝，适合同一条消息发给大量连接
+            void send(const SharedMessage& message);
+            // 发送文件fd中[offset, offset+len)这一段，与其他数据按调用顺序排队，用sendfile(2)发送。
+            // fd会被dup，调用返回后即可关闭；全部发出后回调WriteCompleteCallback
+            void sendFile(int fd, off_t offset, size_t len);
 
             // 关闭连接，设置TCP选项
             void shutdown(); // NOT thread safe, no simultaneous calling
@@ -61,6 +94,11 @@ namespace muduo{
             void stopRead();
             bool isReading() const { return reading_; }; // NOT thread safe, may race with start/stopReadInLoop
 
+            // 最近一次读写活动的时刻（可读事件、handleWrite()发送积压的数据），用于空闲超时，在loop线程中读取
+            Timestamp lastActiveTime() const { return lastActive_; }
+            // 记录一次活动，空闲超时从when重新计时
+            void touch(Timestamp when) { lastActive_ = when; }
+
             void setContext(const boost::any& context)
             { context_ = context; }
 
@@ -83,11 +121,71 @@ namespace muduo{
             void setHighWaterMarkCallback(const HighWaterMarkCallback& cb, size_t highWaterMark)
             { highWaterMarkCallback_ = cb; highWaterMark_ = highWaterMark; }
 
+            // 读背压：本连接待发送的数据（outputBytes()）超过highMark时暂停本连接的读取，
+            // 降到lowMark及以下时恢复，对端不读时数据留在内核缓冲区里由TCP流控，不会在用户空间无限堆积。
+            // highMark为0表示关闭。在loop线程中（或connectEstablished()之前）调用，TcpServer::setReadBackpressure()对所有新连接生效
+            void setReadBackpressure(size_t highMark, size_t lowMark);
+            // 代理中的一对连接互相背压：b的待发送数据超过highMark时暂停a的读取，反之亦然，降到lowMark及以下时恢复；
+            // highMark为0表示解除。与setReadBackpressure()各自使用自己的水位，互不影响。
+            // a、b可以属于不同的loop，可以在任意线程调用
+            static void linkReadBackpressure(const TcpConnectionPtr& a, const TcpConnectionPtr& b,
+                                             size_t highMark, size_t lowMark);
+            // 读取因为背压暂停的次数和累计时长（包括正在暂停的这一段），在loop线程中读取
+            bool readThrottled() const { return throttles_ > 0; }
+            int64_t throttledCount() const { return throttledCount_; }
+            double throttledSeconds() const;
+
             /// Advanced interface 输入输出缓冲区，应用层不用关系底层处理流程
             Buffer* inputBuffer()
             { return &inputBuffer_; }
             Buffer* outputBuffer()
             { return &outputBuffer_; }
+            // 链式输出缓冲，启用setChainedOutput()后待发送数据都保存在这里
+            ChainBuffer* outputChain()
+            { return &outputChain_; }
+            // outputBuffer_和outputChain_中等待发送的总字节数
+            size_t outputBytes() const
+            { return outputBuffer_.readableBytes() + outputChain_.readableBytes(); }
+
+            // 待发送数据改为追加到ChainBuffer中，由handleWrite()用writev(2)发送，
+            // 输出堆积很多时避免Buffer的memmove/realloc。在loop线程中调用，一般在ConnectionCallback里设置
+            void setChainedOutput(bool on)
+            { chainedOutput_ = on; }
+            bool chainedOutput() const
+            { return chainedOutput_; }
+
+            // 零拷贝发送：send(data, owner)排队的数据中不小于threshold的连续块用MSG_ZEROCOPY发送，
+            // owner一直保留到从socket错误队列读到内核的完成通知。在loop线程中调用，
+            // 内核不支持SO_ZEROCOPY时返回false；内核总是拷贝时（如loopback）自动退回普通发送
+            static const size_t kDefaultZeroCopyThreshold = 32*1024;
+            bool setZeroCopy(bool on, size_t threshold = kDefaultZeroCopyThreshold);
+            bool zeroCopy() const { return zeroCopy_; }
+            int64_t zeroCopySends() const { return zeroCopySends_; }       // MSG_ZEROCOPY发送的次数
+            int64_t zeroCopyCompleted() const { return zeroCopyCompleted_; } // 收到完成通知的次数
+            int64_t zeroCopyCopied() const { return zeroCopyCopied_; }     // 其中内核实际做了拷贝的次数
+
+            // 设置读取策略，在loop线程中调用，TcpServer::setReadPolicy()对所有新连接生效
+            void setReadPolicy(const ReadPolicy& policy)
+            { readPolicy_ = policy; }
+            const ReadPolicy& readPolicy() const
+            { return readPolicy_; }
+            int64_t readCalls() const { return readCalls_; }       // readv的次数
+            int64_t bytesRead() const { return bytesRead_; }       // 读到的总字节数
+            int64_t bytesCopied() const { return bytesCopied_; }   // 其中先读到extrabuf再拷贝进inputBuffer_的字节数
+
+            // inputBuffer_/outputBuffer_的存储从EventLoop::bufferPool()借用，读空/发完后归还，
+            // 空闲连接只保留空壳。在loop线程中（或connectEstablished()之前）调用
+            void setBufferPooling(bool on)
+            { bufferPooling_ = on; }
+            bool bufferPooling() const
+            { return bufferPooling_; }
+
+            // 边沿触发：channel只注册一次IN|OUT|RDHUP|EPOLLET，之后读写都进行到EAGAIN，
+            // 是否在等待可写记录在用户空间，发送有积压时不再反复epoll_ctl开关可写事件。
+            // 在loop线程中（或connectEstablished()之前）调用，Poller不支持时返回false
+            bool setEdgeTriggered(bool on);
+            bool edgeTriggered() const
+            { return edgeTriggered_; }
 
             /// Internal use only.
             void setCloseCallback(const CloseCallback& cb)
@@ -102,12 +200,29 @@ namespace muduo{
             enum StateE { kDisconnected, kConnecting, kConnected, kDisconnecting };
 
             void handleRead(Timestamp receiveTime);
+            void reserveInputBuffer();
+            void giveBackBuffers();
             void handleWrite();
             void handleClose();
             void handleError();
             // void sendInLoop(string&& message);
             void sendInLoop(const StringPiece& message);
             void sendInLoop(const void* message, size_t len);
+            void sendInLoop(const StringPiece* pieces, int count);
+            void sendPiecesInLoop(const std::shared_ptr<std::vector<string>>& pieces);
+            void sendFileInLoop(const std::shared_ptr<void>& file, off_t offset, size_t len);
+            void sendSharedInLoop(const StringPiece& data, const std::shared_ptr<const void>& owner);
+            ssize_t sendZeroCopy(const char* data, size_t len, const std::shared_ptr<const void>& owner);
+            void handleErrQueue();
+            void handleZeroCopyCompletion(uint32_t lo, uint32_t hi, bool copied);
+            // 把outputBuffer_和outputChain_中的数据尽量写入socket
+            ssize_t writeOutput();
+            bool waitingWritable() const;
+            void watchWritable();
+            void unwatchWritable();
+            bool corkSend();
+            void scheduleWrite();
+            void flushCorked();
             void shutdownInLoop();
             // void shutdownAndForceCloseInLoop(double seconds);
             void forceCloseInLoop();
@@ -115,17 +230,32 @@ namespace muduo{
             const char* stateToString() const;
             void startReadInLoop();    // 开始接收可读事件
             void stopReadInLoop();
+            // 背压：reader的读取由source的待发送数据控制，在两个连接各自的loop中登记
+            static void watchBackpressure(const TcpConnectionPtr& source, const TcpConnectionPtr& reader,
+                                          size_t highMark, size_t lowMark);
+            // 在本连接（被观察的一方）的loop中登记、更新reader的水位，highMark为0表示删除
+            void setBackpressureReader(const TcpConnectionPtr& reader, size_t highMark, size_t lowMark);
+            // 待发送数据变化后按各个reader的水位暂停/恢复它们的读取
+            void updateBackpressure();
+            void notifyBackpressureReader(const TcpConnectionPtr& reader, bool throttle);
+            // 在本连接（reader）的loop中设置source要求的单次读取上限，0表示删除
+            void setBackpressureReadLimit(const TcpConnection* source, size_t limit);
+            // 被背压暂停/恢复读取，可以有多个来源，全部解除后才恢复，与startRead()/stopRead()互不影响
+            void throttleReadInLoop();
+            void unthrottleReadInLoop();
 
 
 
 
             EventLoop* loop_;
             const string name_;
+            const int64_t id_;
             StateE state_;  // FIXME: use atomic variable
             bool reading_;
-            // 已连接的socketfd的封装Socket、Channel对象
-            std::unique_ptr<Socket> socket_;
-            std::unique_ptr<Channel> channel_;
+            bool chainedOutput_;
+            // 已连接的socketfd的封装Socket、Channel对象，直接嵌在连接对象中，不单独分配
+            Socket socket_;
+            Channel channel_;
 
             const InetAddress localAddr_;
             const InetAddress peerAddr_;
@@ -137,12 +267,54 @@ namespace muduo{
             HighWaterMarkCallback highWaterMarkCallback_;
             CloseCallback closeCallback_;
 
+            // 读背压：本连接的待发送数据控制各个reader的读取，每个reader有自己的水位，只在本连接的loop中访问
+            struct BackpressureReader
+            {
+                std::weak_ptr<TcpConnection> reader;
+                size_t highMark;
+                size_t lowMark;
+                bool throttling;            // 超过了highMark，还没有降到lowMark
+            };
+            std::vector<BackpressureReader> backpressureReaders_;
+            // 作为reader时各个来源（被观察的连接）要求的单次读取上限，只在本连接的loop中访问。
+            // 一次handleRead()最多读其中最小的backpressureReadLimit_，边沿触发时其他loop发来的暂停才能及时生效，0表示不限制
+            std::vector<std::pair<const TcpConnection*, size_t>> backpressureReadLimits_;
+            size_t backpressureReadLimit_;
+            // 本连接的读取被多少个背压来源暂停
+            int throttles_;
+            int64_t throttledCount_;
+            Timestamp throttledSince_;
+            int64_t throttledMicroseconds_;
+
             // 底层的输入、输出缓冲区的处理
             size_t highWaterMark_;
             Buffer inputBuffer_;
-            Buffer outputBuffer_; // FIXME: use list<Buffer> as output buffer.
+            Buffer outputBuffer_;
+            // outputChain_非空时，新的数据都追加到这里，发送时排在outputBuffer_之后
+            ChainBuffer outputChain_;
+
+            bool flushQueued_;          // cork模式下已登记本轮迭代结束时的flush
+            bool edgeTriggered_;
+            bool writeWaiting_;         // 边沿触发时有数据在等待EPOLLOUT
+            bool bufferPooling_;
+            ReadPolicy readPolicy_;
+            size_t readSizeEstimate_;   // 每次可读事件读到的字节数的滑动平均
+            int64_t readCalls_;
+            int64_t bytesRead_;
+            int64_t bytesCopied_;
+
+            // MSG_ZEROCOPY相关，内核对每次零拷贝send按顺序编号
+            typedef std::pair<uint32_t, std::shared_ptr<const void>> ZeroCopyEntry;
+            bool zeroCopy_;
+            size_t zeroCopyThreshold_;
+            uint32_t zeroCopyNextSeq_;
+            std::vector<ZeroCopyEntry> zeroCopyPending_;  // 等待完成通知的数据的owner，按编号递增（空的vector不分配内存，不用零拷贝的连接没有额外开销）
+            int64_t zeroCopySends_;
+            int64_t zeroCopyCompleted_;
+            int64_t zeroCopyCopied_;
             boost::any context_;
-            // FIXME: creationTime_, lastReceiveTime_
+            Timestamp lastActive_;
+            // FIXME: creationTime_
             //        bytesReceived_, bytesSent_
         };
 
@@ -3,53 +3,236 @@
 //
 
 #include "TcpServer.h"
+#include "../base/CountDownlatch.h"
 #include "../base/Logging.h"
 #include "Acceptor.h"
+#include "ConnectionPool.h"
 #include "EventLoop.h"
 #include "EventLoopThreadPool.h"
 #include "SocketsOpts.h"
+#include "TimerId.h"
 
+#include <atomic>
+#include <inttypes.h>
 #include <stdio.h>
+#include <unordered_map>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+    // 监听的是具体的IP和端口（不是通配地址或者端口0）
+    bool isSpecificAddress(const InetAddress& addr)
+    {
+        if (addr.toPort() == 0)
+        {
+            return false;
+        }
+        if (addr.family() == AF_INET6)
+        {
+            const struct sockaddr_in6* addr6 = sockets::sockaddr_in6_cast(addr.getSockAddr());
+            return !IN6_IS_ADDR_UNSPECIFIED(&addr6->sin6_addr);
+        }
+        return addr.ipNetEndian() != htonl(INADDR_ANY);
+    }
+}
+
+const int TcpServer::kIdleSweepsPerTimeout;
+const size_t TcpServer::kIdleReapBatch;
+
+/*
+ * 一个IO loop上的连接表和空闲连接检查，只在这个loop线程中使用（计数除外）。
+ * 连接在所属的loop中登记和删除，关闭时不再回到baseLoop，每个loop的连接表互不相干。
+ * 空闲检查：连接只在读写时记录时刻（TcpConnection::lastActive_），这里定时扫描一遍本loop的连接，
+ * 把超时的放进reapQueue分批关闭，不需要每个连接一个定时器，也不需要在每次读写时重设定时器。
+ * 由TcpServer、连接的关闭回调、定时器回调和排队的回调共同持有，TcpServer析构之后也能安全地停下来。
+ */
+struct TcpServer::LoopShard : public std::enable_shared_from_this<LoopShard>
+{
+    LoopShard(EventLoop* ioLoop, double timeout, const IdleCallback& cb)
+            : loop(ioLoop),
+              timeoutUs(static_cast<int64_t>(timeout * Timestamp::kMicroSecondsPerSecond)),
+              callback(cb),
+              stopped(false),
+              count(0),
+              reaped(0),
+              spared(0)
+    { }
+
+    void add(const TcpConnectionPtr& conn)
+    {
+        connections[conn->id()] = conn;
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void remove(const TcpConnectionPtr& conn);
+    void stop();
+
+    bool idle(const TcpConnectionPtr& conn, Timestamp now) const
+    {
+        return now.microSecondsSinceEpoch() - conn->lastActiveTime().microSecondsSinceEpoch() >= timeoutUs;
+    }
+
+    void sweep();
+    void reapBatch();
+
+    EventLoop* loop;
+    const int64_t timeoutUs;            // 不大于0表示不检查空闲
+    const IdleCallback callback;
+    bool stopped;
+    TimerId timer;
+    std::unordered_map<int64_t, TcpConnectionPtr> connections;   // 本loop上的连接，按id索引
+    std::vector<std::weak_ptr<TcpConnection>> reapQueue;         // 扫描出的超时连接，等待分批关闭
+    std::atomic<size_t> count;          // connections.size()，供其他线程读取
+    std::atomic<int64_t> reaped;
+    std::atomic<int64_t> spared;
+};
+
+void TcpServer::LoopShard::remove(const TcpConnectionPtr& conn)
+{
+    loop->assertInLoopThread();
+    LOG_INFO << "TcpServer::removeConnection - connection " << conn->name();
+    size_t n = connections.erase(conn->id());
+    if (n == 0)
+    {
+        // TcpServer析构时已经整表销毁
+        assert(stopped);
+        return;
+    }
+    count.fetch_sub(1, std::memory_order_relaxed);
+    // 正在Channel::handleEvent()中，connectDestroyed放到之后执行
+    loop->queueInLoop([conn] { conn->connectDestroyed(); });
+}
+
+void TcpServer::LoopShard::stop()
+{
+    loop->assertInLoopThread();
+    stopped = true;
+    if (timeoutUs > 0)
+    {
+        loop->cancel(timer);
+    }
+    reapQueue.clear();
+    std::unordered_map<int64_t, TcpConnectionPtr> conns;
+    conns.swap(connections);
+    count.store(0, std::memory_order_relaxed);
+    for (auto& item : conns)
+    {
+        item.second->connectDestroyed();
+    }
+}
+
+void TcpServer::LoopShard::sweep()
+{
+    if (stopped)
+    {
+        return;
+    }
+    // 上一次扫描出的连接还没有关完时不重复加入
+    if (!reapQueue.empty())
+    {
+        return;
+    }
+    const Timestamp now(Timestamp::now());
+    for (const auto& item : connections)
+    {
+        const TcpConnectionPtr& conn = item.second;
+        if (!conn->disconnected() && idle(conn, now))
+        {
+            reapQueue.push_back(conn);
+        }
+    }
+    if (!reapQueue.empty())
+    {
+        LOG_DEBUG << "TcpServer::LoopShard::sweep - " << reapQueue.size() << " of "
+                  << connections.size() << " connections idle";
+        reapBatch();
+    }
+}
+
+void TcpServer::LoopShard::reapBatch()
+{
+    if (stopped)
+    {
+        reapQueue.clear();
+        return;
+    }
+    const Timestamp now(Timestamp::now());
+    size_t n = 0;
+    while (!reapQueue.empty() && n < kIdleReapBatch)
+    {
+        TcpConnectionPtr conn(reapQueue.back().lock());
+        reapQueue.pop_back();
+        // 排队期间可能已经断开或者又有了读写
+        if (!conn || conn->disconnected() || !idle(conn, now))
+        {
+            continue;
+        }
+        ++n;
+        if (callback && !callback(conn))
+        {
+            conn->touch(now);
+            ++spared;
+            continue;
+        }
+        LOG_DEBUG << "TcpServer - idle connection " << conn->name() << " closed";
+        conn->forceClose();
+        ++reaped;
+    }
+    if (!reapQueue.empty())
+    {
+        // 剩下的在之后的pendingFunctors中继续，中间loop可以处理其他连接的事件
+        loop->queueInLoop(std::bind(&LoopShard::reapBatch, shared_from_this()));
+    }
+}
+
 TcpServer::TcpServer(EventLoop* loop,
                      const InetAddress& listenAddr,
                      const string& nameArg,
                      Option option)
         : loop_(CHECK_NOTNULL(loop)),
+          listenAddr_(listenAddr),
           ipPort_(listenAddr.toIpPort()),		// 服务端监听的地址
           name_(nameArg),
+          connNamePrefix_(name_ + "-" + ipPort_ + "#"),
           acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),  // 处理新连接的Acceptor
+          reusePort_(option == kReusePort),
+          acceptorPerLoop_(false),
+          steering_(kHashSteering),
+          listenAddrSpecific_(isSpecificAddress(listenAddr)),
+          maxAcceptsPerEvent_(1),
+          handoffs_(0),
           threadPool_(new EventLoopThreadPool(loop, name_)), // 线程池
           connectionCallback_(defaultConnectionCallback),    // 提供给用户的 连接、断开 的回调
           messageCallback_(defaultMessageCallback),          // 提供给用户的 新消息到来 的回调
-          nextConnId_(1)									   // 下一个连接到来的序号
+          bufferPooling_(false),
+          edgeTriggered_(false),
+          connectionPooling_(false),
+          backpressureHigh_(0),
+          backpressureLow_(0),
+          idleTimeout_(0.0)
 {
+    nextConnId_.getAndSet(1);									   // 下一个连接到来的序号
     // 设置Acceptor处理新连接的回调函数
-    acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this, _1, _2));
+    acceptor_->setNewConnectionsCallback(std::bind(&TcpServer::newConnections, this, _1));
 }
 
 TcpServer::~TcpServer()
 {
     loop_->assertInLoopThread();
     LOG_TRACE << "TcpServer::~TcpServer [" << name_ << "] destructing";
-
-    for (auto& item : connections_)
-    {
-        TcpConnectionPtr conn(item.second);
-        item.second.reset();   // 引用计数减1，不代表已经释放
-        // 调用TcpConnection::connectDestroyed
-        conn->getLoop()->runInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
-    }
+    // 先停止接受，之后不会再有新连接
+    stopLoopAcceptors();
+    // 在各个loop中销毁它的连接（调用TcpConnection::connectDestroyed），排在已经交给它的新连接之后
+    stopShards();
 }
 
 /*
  * 函数setThreadNum()必须在调用start()前使用，
  * 若不设置线程数量，则默认单线程模式处理。
  * start()函数启动Acceptor::listen()开始监听新连接到来的事件，
- * 一旦有新连接的事件就触发回调TcpServer::newConnection。
+ * 一旦有新连接的事件就触发回调TcpServer::newConnections。
  */
 
 void TcpServer::setThreadNum(int numThreads)
@@ -58,71 +241,383 @@ void TcpServer::setThreadNum(int numThreads)
     threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setLoopPlacement(const LoopPlacement& placement)
+{
+    threadPool_->setPlacement(placement);
+}
+
+bool TcpServer::setAcceptorPerLoop(bool on, AcceptSteering steering)
+{
+    assert(started_.get() == 0);
+    if (on && !reusePort_)
+    {
+        LOG_ERROR << "TcpServer::setAcceptorPerLoop [" << name_ << "] - needs TcpServer::kReusePort";
+        return false;
+    }
+    acceptorPerLoop_ = on;
+    steering_ = steering;
+    return true;
+}
+
+void TcpServer::setMaxAcceptsPerEvent(int n)
+{
+    assert(started_.get() == 0);
+    maxAcceptsPerEvent_ = n > 0 ? n : 1;
+    acceptor_->setMaxAcceptsPerEvent(maxAcceptsPerEvent_);
+}
+
+TcpServer::AcceptStats TcpServer::acceptStats() const
+{
+    AcceptStats stats;
+    stats.accepted = 0;
+    stats.readEvents = 0;
+    stats.handoffs = handoffs_.load(std::memory_order_relaxed);
+    stats.queueLength = 0;
+    stats.queueLimit = 0;
+    std::vector<const Acceptor*> acceptors;
+    if (loopAcceptors_.empty())
+    {
+        acceptors.push_back(get_pointer(acceptor_));
+    }
+    for (const auto& acceptor : loopAcceptors_)
+    {
+        acceptors.push_back(get_pointer(acceptor));
+    }
+    for (const Acceptor* acceptor : acceptors)
+    {
+        stats.accepted += acceptor->accepted();
+        stats.readEvents += acceptor->readEvents();
+        int length = 0;
+        int limit = 0;
+        if (acceptor->listenning() && acceptor->acceptQueue(&length, &limit))
+        {
+            stats.queueLength += length;
+            stats.queueLimit += limit;
+        }
+    }
+    if (!sockets::getListenOverflows(&stats.listenOverflows, &stats.listenDrops))
+    {
+        stats.listenOverflows = -1;
+        stats.listenDrops = -1;
+    }
+    return stats;
+}
+
 void TcpServer::start()
 {
     if (started_.getAndSet(1) == 0)
     {
         threadPool_->start(threadInitCallback_);
+        startShards();
 
         assert(!acceptor_->listenning());
-        loop_->runInLoop(std::bind(&Acceptor::listen, get_pointer(acceptor_)));
+        if (acceptorPerLoop_)
+        {
+            // acceptor_只占着端口，不listen，不会分到连接
+            startLoopAcceptors();
+        }
+        else
+        {
+            loop_->runInLoop(std::bind(&Acceptor::listen, get_pointer(acceptor_)));
+        }
     }
 }
 
-void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr) {
+/*
+ * 在每个loop中依次创建Acceptor并listen，等前一个完成再开始下一个：
+ * reuseport组内socket的下标就是listen()的顺序，kCpuBpf依赖它与loop的下标一致。
+ * 只在start()中执行一次，短暂阻塞baseLoop。
+ */
+void TcpServer::startLoopAcceptors()
+{
+    loop_->assertInLoopThread();
+    const std::vector<EventLoop*> loops(threadPool_->getAllLoops());
+    const std::vector<CpuSlot>& slots = threadPool_->placements();
+    const bool steered = steering_ != kHashSteering && slots.size() == loops.size();
+    if (steering_ != kHashSteering && !steered)
+    {
+        LOG_WARN << "TcpServer::startLoopAcceptors [" << name_
+                 << "] - loops are not bound to cpus, falling back to hash steering";
+    }
+
+    loopAcceptors_.resize(loops.size());
+    for (size_t i = 0; i < loops.size(); ++i)
+    {
+        EventLoop* ioLoop = loops[i];
+        CountDownLatch latch(1);
+        ioLoop->runInLoop([this, i, ioLoop, steered, &slots, &latch]
+                          {
+                              std::unique_ptr<Acceptor> acceptor(new Acceptor(ioLoop, listenAddr_, true));
+                              acceptor->setNewConnectionsCallback(
+                                      std::bind(&TcpServer::newConnectionsInLoop, this, ioLoop, _1));
+                              acceptor->setMaxAcceptsPerEvent(maxAcceptsPerEvent_);
+                              if (steered && steering_ == kIncomingCpu)
+                              {
+                                  acceptor->setIncomingCpu(slots[i].cpus.front());
+                              }
+                              acceptor->listen();
+                              loopAcceptors_[i] = std::move(acceptor);
+                              latch.countDown();
+                          });
+        latch.wait();
+    }
+
+    if (steered && steering_ == kCpuBpf)
+    {
+        std::vector<std::vector<int>> cpusOfIndex;
+        for (const CpuSlot& slot : slots)
+        {
+            cpusOfIndex.push_back(slot.cpus);
+        }
+        // 程序属于整个reuseport组，挂在任意一个socket上即可
+        if (!loopAcceptors_.front()->attachReusePortCpuMap(cpusOfIndex))
+        {
+            LOG_WARN << "TcpServer::startLoopAcceptors [" << name_ << "] - falling back to hash steering";
+        }
+    }
+    LOG_INFO << "TcpServer::startLoopAcceptors [" << name_ << "] - " << loops.size()
+             << " reuseport acceptors on " << ipPort_
+             << (!steered ? ", hash steering" : steering_ == kIncomingCpu ? ", SO_INCOMING_CPU steering" : ", cpu bpf steering");
+}
+
+void TcpServer::stopLoopAcceptors()
+{
+    if (loopAcceptors_.empty())
+    {
+        return;
+    }
+    const std::vector<EventLoop*> loops(threadPool_->getAllLoops());
+    for (size_t i = 0; i < loops.size(); ++i)
+    {
+        CountDownLatch latch(1);
+        loops[i]->runInLoop([this, i, &latch]
+                            {
+                                loopAcceptors_[i].reset();
+                                latch.countDown();
+                            });
+        latch.wait();
+    }
+    loopAcceptors_.clear();
+}
+
+/*
+ * 一批新连接：逐个按分配策略选择IO loop、创建TcpConnection，
+ * 然后每个IO loop只排一个回调建立分给它的所有连接，一批连接每个loop最多一次唤醒。
+ */
+void TcpServer::newConnections(const AcceptedList& accepted) {
     loop_->assertInLoopThread();
-    // 使用round-robin策略从线程池中获取一个loop
-    EventLoop* ioLoop = threadPool_->getNextLoop();
+    std::vector<Batch>& batches = batches_;
+    for (const auto& item : accepted)
+    {
+        // 按分配策略从线程池中获取一个loop
+        EventLoop* ioLoop = threadPool_->getNextLoop();
+        size_t i = 0;
+        while (i < batches.size() && batches[i].first->loop != ioLoop)
+        {
+            ++i;
+        }
+        if (i == batches.size())
+        {
+            batches.push_back(Batch(shardOf(ioLoop), std::vector<TcpConnectionPtr>()));
+        }
+        batches[i].second.push_back(createConnection(batches[i].first, item.first, item.second));
+    }
+    for (auto& batch : batches)
+    {
+        // 在连接所属的loop中登记，并执行TcpConnection::connectEstablished()，确认当前已连接状态，
+        // 在Poller中注册当前已连接socket上的IO事件。连接列表移进回调，不拷贝
+        batch.first->loop->runInLoop(std::bind(&TcpServer::establishConnections, batch.first, std::move(batch.second)));
+    }
+    handoffs_.fetch_add(static_cast<int64_t>(batches.size()), std::memory_order_relaxed);
+    batches.clear();
+}
 
-    char buf[64];
-    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-    ++nextConnId_;
-    string connName = name_ + buf;
+void TcpServer::newConnectionsInLoop(EventLoop* ioLoop, const AcceptedList& accepted)
+{
+    ioLoop->assertInLoopThread();
+    // 登记在本loop的连接表中，整个过程不经过baseLoop
+    const LoopShardPtr shard(shardOf(ioLoop));
+    std::vector<TcpConnectionPtr> conns;
+    conns.reserve(accepted.size());
+    for (const auto& item : accepted)
+    {
+        conns.push_back(createConnection(shard, item.first, item.second));
+    }
+    establishConnections(shard, conns);
+}
+
+void TcpServer::establishConnections(const LoopShardPtr& shard, const std::vector<TcpConnectionPtr>& conns)
+{
+    shard->loop->assertInLoopThread();
+    for (const TcpConnectionPtr& conn : conns)
+    {
+        if (shard->stopped)
+        {
+            // TcpServer已经析构，建立后立即销毁
+            conn->connectEstablished();
+            conn->connectDestroyed();
+            continue;
+        }
+        shard->add(conn);
+        conn->connectEstablished();
+    }
+}
+
+TcpConnectionPtr TcpServer::createConnection(const LoopShardPtr& shard, int sockfd, const InetAddress& peerAddr)
+{
+    const int64_t connId = nextConnId_.getAndAdd(1);
+    char buf[32];
+    const int len = snprintf(buf, sizeof buf, "%" PRId64, connId);
+    string connName;
+    connName.reserve(connNamePrefix_.size() + len);
+    connName.append(connNamePrefix_).append(buf, len);
 
     LOG_INFO << "TcpServer::newConnection [" << name_
              << "] - new connection [" << connName
              << "] from " << peerAddr.toIpPort();
-    InetAddress localAddr(sockets::getLocalAddr(sockfd));
+    // 监听的是具体的地址时本端地址就是它，省掉一次getsockname
+    InetAddress localAddr(listenAddrSpecific_ ? listenAddr_ : InetAddress(sockets::getLocalAddr(sockfd)));
 
     // FIXME poll with zero timeout to double confirm the new connection
     // FIXME use make_shared if necessary
     // 创建一个TcpConnection对象，表示每一个已连接
-    TcpConnectionPtr conn(new TcpConnection(ioLoop,    // 当前连接所属的loop
-                                            connName,  // 连接名称
-                                            sockfd,    // 已连接的socket
-                                            localAddr, // 本端地址
-                                            peerAddr));// 对端地址
-    // 当前连接加入到connection map中
-    connections_[connName] = conn;
+    TcpConnectionPtr conn;
+    if (connectionPooling_)
+    {
+        // 连接对象和控制块一次分配，来自所属loop的池
+        conn = std::allocate_shared<TcpConnection>(ConnectionPool::Allocator<TcpConnection>(shard->loop->connectionPool()),
+                                                   shard->loop, std::move(connName), sockfd, localAddr, peerAddr, connId);
+    }
+    else
+    {
+        conn.reset(new TcpConnection(shard->loop,          // 当前连接所属的loop
+                                     std::move(connName),  // 连接名称
+                                     sockfd,               // 已连接的socket
+                                     localAddr,            // 本端地址
+                                     peerAddr,             // 对端地址
+                                     connId));
+    }
     // 设置TcpConnection上的事件回调
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
-    conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, _1)); // FIXME: unsafe
-    // 回调执行TcpConnection::connectEstablished()，确认当前已连接状态，
-    // 在Poller中注册当前已连接socket上的IO事件
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    conn->setReadPolicy(readPolicy_);
+    conn->setBufferPooling(bufferPooling_);
+    conn->setEdgeTriggered(edgeTriggered_);
+    if (backpressureHigh_ > 0)
+    {
+        conn->setReadBackpressure(backpressureHigh_, backpressureLow_);
+    }
+    // 关闭时在连接自己的loop中从shard的连接表删除，不再回到baseLoop。
+    // 只捕获裸指针的lambda放得进std::function内部，不额外分配；shard在stop()中销毁所有连接之后才可能析构，
+    // 之后不会再有关闭回调
+    LoopShard* rawShard = get_pointer(shard);
+    conn->setCloseCallback([rawShard](const TcpConnectionPtr& c) { rawShard->remove(c); });
+    return conn;
+}
 
+
+void TcpServer::startShards()
+{
+    loop_->assertInLoopThread();
+    const double timeout = idleTimeout_ > 0 ? idleTimeout_ : 0.0;
+    const double interval = timeout / kIdleSweepsPerTimeout;
+    for (EventLoop* ioLoop : threadPool_->getAllLoops())
+    {
+        LoopShardPtr shard(std::make_shared<LoopShard>(ioLoop, timeout, idleCallback_));
+        shards_.push_back(shard);
+        if (timeout > 0)
+        {
+            ioLoop->runInLoop([shard, interval]
+                              {
+                                  shard->timer = shard->loop->runEvery(interval, std::bind(&LoopShard::sweep, shard));
+                              });
+        }
+    }
+    if (timeout > 0)
+    {
+        LOG_INFO << "TcpServer::startShards [" << name_ << "] - idle timeout " << idleTimeout_
+                 << "s, sweeping every " << interval << "s on " << shards_.size() << " loops";
+    }
 }
 
+void TcpServer::stopShards()
+{
+    for (const LoopShardPtr& shard : shards_)
+    {
+        // 和启动定时器、建立连接的回调一样在shard的loop中执行，排在它们之后
+        shard->loop->runInLoop(std::bind(&LoopShard::stop, shard));
+    }
+}
 
-void TcpServer::removeConnection(const TcpConnectionPtr& conn)
+TcpServer::LoopShardPtr TcpServer::shardOf(EventLoop* ioLoop) const
 {
-    // FIXME: unsafe
-    loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+    for (const LoopShardPtr& shard : shards_)
+    {
+        if (shard->loop == ioLoop)
+        {
+            return shard;
+        }
+    }
+    assert(false);
+    return LoopShardPtr();
 }
 
-void TcpServer::removeConnectionInLoop(const TcpConnectionPtr& conn)
+void TcpServer::forEachConnection(const ConnectionVisitor& visitor, const std::function<void()>& done)
 {
-    loop_->assertInLoopThread();
-    LOG_INFO << "TcpServer::removeConnectionInLoop [" << name_
-             << "] - connection " << conn->name();
-    size_t n = connections_.erase(conn->name());  // 通过name移除coon
-    (void)n;
-    assert(n == 1);
-    // 在conn所在的loop中执行TcpConnection::connectDestroyed
-    EventLoop* ioLoop = conn->getLoop();
-    ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+    assert(started_.get() != 0);
+    std::shared_ptr<AtomicInt32> remaining(std::make_shared<AtomicInt32>());
+    remaining->getAndSet(static_cast<int32_t>(shards_.size()));
+    EventLoop* baseLoop = loop_;
+    for (const LoopShardPtr& shard : shards_)
+    {
+        shard->loop->runInLoop([shard, visitor, done, remaining, baseLoop]
+                               {
+                                   // visitor可能关闭连接，先取快照
+                                   std::vector<TcpConnectionPtr> conns;
+                                   conns.reserve(shard->connections.size());
+                                   for (const auto& item : shard->connections)
+                                   {
+                                       conns.push_back(item.second);
+                                   }
+                                   for (const TcpConnectionPtr& conn : conns)
+                                   {
+                                       visitor(conn);
+                                   }
+                                   if (remaining->decrementAndGet() == 0 && done)
+                                   {
+                                       baseLoop->runInLoop(done);
+                                   }
+                               });
+    }
+}
+
+size_t TcpServer::numConnections() const
+{
+    size_t n = 0;
+    for (const LoopShardPtr& shard : shards_)
+    {
+        n += shard->count.load(std::memory_order_relaxed);
+    }
+    return n;
 }
 
+int64_t TcpServer::idleReaped() const
+{
+    int64_t n = 0;
+    for (const LoopShardPtr& shard : shards_)
+    {
+        n += shard->reaped.load(std::memory_order_relaxed);
+    }
+    return n;
+}
 
+int64_t TcpServer::idleSpared() const
+{
+    int64_t n = 0;
+    for (const LoopShardPtr& shard : shards_)
+    {
+        n += shard->spared.load(std::memory_order_relaxed);
+    }
+    return n;
+}
@@ -7,9 +7,11 @@
 
 #include "../base/Atomic.h"
 #include "../base/Types.h"
+#include "LoopPlacement.h"
 #include "TcpConnection.h"
 
-#include <map>
+#include <atomic>
+#include <vector>
 
 namespace muduo{
     namespace net{
@@ -20,6 +22,9 @@ namespace muduo{
     class TcpServer: noncopyable{
     public:
         typedef std::function<void(EventLoop*)> ThreadInitCallback;
+        // 空闲连接被关闭之前的回调，返回false表示这次保留连接
+        typedef std::function<bool(const TcpConnectionPtr&)> IdleCallback;
+        typedef std::function<void(const TcpConnectionPtr&)> ConnectionVisitor;
 
         enum Option
         {
@@ -27,6 +32,14 @@ namespace muduo{
             kReusePort,
         };
 
+        // 每个loop一个Acceptor时，内核怎样在reuseport组内选择接受连接的socket
+        enum AcceptSteering
+        {
+            kHashSteering,      // 内核默认的四元组hash
+            kIncomingCpu,       // 每个socket设置SO_INCOMING_CPU为它的loop绑定的第一个CPU（Linux 6.2+）
+            kCpuBpf,            // 挂BPF程序，按收到连接的CPU选择绑定在这个CPU上的loop
+        };
+
         //传入TcpServer所属的loop，本地ip，服务器名
         //TcpServer(EventLoop* loop, const InetAddress& listenAddr);
         TcpServer(EventLoop* loop,
@@ -44,6 +57,33 @@ namespace muduo{
         // 1： acceptor在一个线程，所有IO在另一个线程
         // N： acceptor在一个线程，所有IO通过round-robin分配到N个线程中
         void setThreadNum(int numThreads);
+        // 每个IO loop各有一个SO_REUSEPORT的Acceptor，连接在接受它的loop中直接建立和处理，不经过baseLoop。
+        // 需要构造时使用kReusePort，在start()前调用，否则返回false。
+        // kIncomingCpu/kCpuBpf按EventLoopThreadPool::placements()中各loop绑定的CPU引导连接（见setLoopPlacement()），
+        // 没有绑定时退回hash
+        bool setAcceptorPerLoop(bool on, AcceptSteering steering = kHashSteering);
+        bool acceptorPerLoop() const
+        { return acceptorPerLoop_; }
+
+        // 每次监听socket可读时最多accept几个连接（直到EAGAIN），默认1个。需在start()前调用。
+        // 一批连接按分配策略分给IO loop后，每个loop只排一个回调建立分给它的连接
+        void setMaxAcceptsPerEvent(int n);
+
+        // accept的统计，可以在任意线程调用
+        struct AcceptStats
+        {
+            int64_t accepted;         // 接受的连接总数，两次取样之差除以间隔就是accept速率
+            int64_t readEvents;       // 监听socket的可读事件次数，accepted/readEvents是平均每批的连接数
+            int64_t handoffs;         // 交给IO loop的批数（每批一个回调，最多一次唤醒）
+            int queueLength;          // accept队列当前的长度（tcp_info，多个Acceptor时求和）
+            int queueLimit;           // accept队列的上限（listen的backlog）
+            int64_t listenOverflows;  // /proc/net/netstat中TcpExt的ListenOverflows，整个网络命名空间的累计值，读不到时为-1
+            int64_t listenDrops;      // 同上，ListenDrops
+        };
+        AcceptStats acceptStats() const;
+
+        // IO线程的CPU/NUMA放置策略，需在start()前调用，见EventLoopThreadPool::setPlacement()
+        void setLoopPlacement(const LoopPlacement& placement);
         // 线程池初始化后的回调函数
         void setThreadInitCallback(const ThreadInitCallback& cb)
         { threadInitCallback_ = cb; }
@@ -62,39 +102,113 @@ namespace muduo{
         { messageCallback_ = cb; }
         void setWriteCompleteCallback(const WriteCompleteCallback& cb)
         { writeCompleteCallback_ = cb; }
+        // 新连接使用的读取策略，需在start()前调用
+        void setReadPolicy(const ReadPolicy& policy)
+        { readPolicy_ = policy; }
+        // 新连接的缓冲区存储从所属EventLoop的BufferPool借用，需在start()前调用
+        void setBufferPooling(bool on)
+        { bufferPooling_ = on; }
+        // 新连接以边沿触发方式注册到epoll，需在start()前调用；Poller不支持时仍使用水平触发
+        void setEdgeTriggered(bool on)
+        { edgeTriggered_ = on; }
+        // 新连接对象（连同shared_ptr的控制块）从所属loop的ConnectionPool分配，连接销毁后内存留在池中复用，
+        // 需在start()前调用。连接频繁建立和断开时省去大部分内存分配
+        void setConnectionPooling(bool on)
+        { connectionPooling_ = on; }
+        // 新连接开启读背压（见TcpConnection::setReadBackpressure()），待发送数据超过highMark暂停读取，
+        // 降到lowMark及以下恢复。highMark为0表示关闭（默认），需在start()前调用
+        void setReadBackpressure(size_t highMark, size_t lowMark)
+        { backpressureHigh_ = highMark; backpressureLow_ = lowMark; }
+
+        // 空闲超时：连接超过seconds秒没有读写活动（见TcpConnection::lastActiveTime()）就被forceClose()，
+        // 不大于0表示不检查（默认）。需在start()前调用。
+        // 读写时只记录时刻，不重设定时器；每个loop一个定时器每隔seconds/kIdleSweepsPerTimeout秒扫描一遍
+        // 本loop的连接，所以实际关闭时刻最多晚这么久。超时的连接分批关闭，每批kIdleReapBatch个，
+        // 批与批之间让出loop处理其他事件
+        void setIdleTimeout(double seconds)
+        { idleTimeout_ = seconds; }
+        double idleTimeout() const
+        { return idleTimeout_; }
+        // 在连接所属的loop线程中、关闭之前回调，返回false时保留连接并重新开始计时（例如改为发送心跳）
+        void setIdleCallback(const IdleCallback& cb)
+        { idleCallback_ = cb; }
+        // 因为空闲被关闭的连接数、被IdleCallback保留的次数，可以在任意线程调用
+        int64_t idleReaped() const;
+        int64_t idleSpared() const;
+
+        static const int kIdleSweepsPerTimeout = 4;
+        static const size_t kIdleReapBatch = 256;
+
+        // 连接按所属的IO loop分片登记，登记和删除都在连接自己的loop中进行，不经过baseLoop。
+        // 在每个loop线程中对该loop上的连接依次调用visitor（例如广播），所有loop都访问完后在baseLoop中调用done。
+        // 访问的是调用时的快照，visitor中可以关闭连接。start()之后可以在任意线程调用
+        void forEachConnection(const ConnectionVisitor& visitor,
+                               const std::function<void()>& done = std::function<void()>());
+        // 当前登记的连接数，可以在任意线程调用
+        size_t numConnections() const;
 
 
     private:
 
-        /// Not thread safe, but in loop
-        ///传给Acceptor，Acceptor会在有新的连接到来时调用->handleRead()
-        void newConnection(int sockfd, const InetAddress& peerAddr);
-        /// Thread safe.
-        void removeConnection(const TcpConnectionPtr& conn);   //移除连接。
-        /// Not thread safe, but in loop
-        void removeConnectionInLoop(const TcpConnectionPtr& conn);  //将连接从loop中移除
+        // 与Acceptor::AcceptedList相同，这里不暴露Acceptor
+        typedef std::vector<std::pair<int, InetAddress>> AcceptedList;
 
-
-        //string为TcpConnection名，用于找到某个连接。
-        typedef std::map<string, TcpConnectionPtr> ConnectionMap;
+        /// Not thread safe, but in loop
+        ///传给Acceptor，Acceptor在一次可读事件中接受了新的连接后调用
+        void newConnections(const AcceptedList& accepted);
+        /// 每个loop一个Acceptor时，在ioLoop中接受的新连接
+        void newConnectionsInLoop(EventLoop* ioLoop, const AcceptedList& accepted);
+        void startLoopAcceptors();
+        void stopLoopAcceptors();
+
+        // 每个IO loop一份的连接表和空闲连接检查状态，定义在TcpServer.cpp中
+        struct LoopShard;
+        typedef std::shared_ptr<LoopShard> LoopShardPtr;
+        /// Thread safe. 创建属于shard所在loop的连接并设置回调
+        TcpConnectionPtr createConnection(const LoopShardPtr& shard, int sockfd, const InetAddress& peerAddr);
+        void startShards();
+        void stopShards();
+        LoopShardPtr shardOf(EventLoop* ioLoop) const;
+        // 在连接所属的loop中登记并建立一批连接
+        static void establishConnections(const LoopShardPtr& shard, const std::vector<TcpConnectionPtr>& conns);
 
         EventLoop* loop_; // Acceptor 所属的loop
+        const InetAddress listenAddr_;
         const string  ipPort_;
         const string name_;
+        const string connNamePrefix_;                   // name_-ipPort_#，连接名为它加上连接id
 
         // 仅由TcpServer持有
         std::unique_ptr<Acceptor> acceptor_; // avoid revealing Acceptor
+        // 每个loop一个Acceptor时，与threadPool_->getAllLoops()一一对应，各自在所属的loop中创建和析构
+        std::vector<std::unique_ptr<Acceptor>> loopAcceptors_;
+        const bool reusePort_;
+        bool acceptorPerLoop_;
+        AcceptSteering steering_;
+        const bool listenAddrSpecific_;                 // 监听的是具体地址，新连接的本端地址不必getsockname
+        int maxAcceptsPerEvent_;
+        std::atomic<int64_t> handoffs_;
         std::shared_ptr<EventLoopThreadPool> threadPool_;
         // 用户的回调函数
         ConnectionCallback connectionCallback_;         // 连接状态（连接、断开）的回调
         MessageCallback messageCallback_;				  // 新消息到来的回调
         WriteCompleteCallback writeCompleteCallback_;   // 发送数据完毕(全部发给内核)的回调
         ThreadInitCallback threadInitCallback_;         // 线程池创建成功回调
+        ReadPolicy readPolicy_;                         // 新连接的读取策略
+        bool bufferPooling_;                            // 新连接是否使用BufferPool
+        bool edgeTriggered_;                            // 新连接是否使用边沿触发
+        bool connectionPooling_;                        // 新连接是否从ConnectionPool分配
+        size_t backpressureHigh_;                       // 新连接的读背压水位，0表示关闭
+        size_t backpressureLow_;
+        double idleTimeout_;                            // 空闲超时（秒），不大于0表示不检查
+        IdleCallback idleCallback_;
+        std::vector<LoopShardPtr> shards_;              // 与threadPool_->getAllLoops()一一对应，start()之后不再变化
+        // newConnections()中分给各个loop的连接，只在baseLoop中使用，复用它的空间
+        typedef std::pair<LoopShardPtr, std::vector<TcpConnectionPtr>> Batch;
+        std::vector<Batch> batches_;
 
         AtomicInt32 started_;
-        // always in loop thread;
-        int nextConnId_;  // 下一个连接ID， 用于生成TcpConnection的name;
-        ConnectionMap  connections_;  // 当前连接的TCP的map<name,TcpConnectionPtr>
+        AtomicInt64 nextConnId_;  // 下一个连接ID，每个loop一个Acceptor时在多个线程中递增
 
     };
     }
@@ -21,3 +21,12 @@ void Timer::restart(Timestamp now)
         expiration_ = Timestamp::invalid();
     }
 }
+
+void Timer::reset(TimerCallback cb, Timestamp when, double interval)
+{
+    callback_ = std::move(cb);
+    expiration_ = when;
+    interval_ = interval;
+    repeat_ = interval > 0.0;
+    sequence_ = s_numCreated_.incrementAndGet();
+}
@@ -24,7 +24,11 @@ namespace muduo{
                       expiration_(when),           // 超时事件
                       interval_(interval),         // 超时重复执行的时间间隔
                       repeat_(interval > 0.0),     // 重复执行的标志位
-                      sequence_(s_numCreated_.incrementAndGet()) // 当前定时器的的全局唯一序号
+                      sequence_(s_numCreated_.incrementAndGet()), // 当前定时器的的全局唯一序号
+                      prev_(NULL),
+                      next_(NULL),
+                      tick_(0),
+                      location_(-1)
             { }
 
             void run() const { callback_(); } // 执行超时回调函数
@@ -38,11 +42,22 @@ namespace muduo{
             static int64_t numCreated() { return s_numCreated_.get(); } // 返回最新的定时器序号
 
         private:
-            const TimerCallback callback_;    // 定时器回调函数
+            friend class TimingWheel;
+
+            // TimingWheel复用Timer对象：换上新的回调和时间，并分配新的序号，旧的TimerId因此失效
+            void reset(TimerCallback cb, Timestamp when, double interval);
+
+            TimerCallback callback_;          // 定时器回调函数
             Timestamp expiration_;            // 定时器超时的时间
-            const double interval_;           // 定时器重复执行时间间隔，如不重复，设为非正值
-            const bool repeat_;               // 定时器是都重复执行
-            const int64_t sequence_;          // 定时器的全局序号
+            double interval_;                 // 定时器重复执行时间间隔，如不重复，设为非正值
+            bool repeat_;                     // 定时器是都重复执行
+            int64_t sequence_;                // 定时器的全局序号
+
+            // 以下只由TimingWheel使用：所在槽的双向链表、到期的tick、所在的层和槽（-1表示不在轮中）
+            Timer* prev_;
+            Timer* next_;
+            int64_t tick_;
+            int location_;
 
             static AtomicInt64 s_numCreated_; // 定时器计数值
         };
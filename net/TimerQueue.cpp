@@ -7,6 +7,7 @@
 
 #include "Timer.h"
 #include "TimerId.h"
+#include "TimingWheel.h"
 #include "EventLoop.h"
 
 #include <sys/timerfd.h>
@@ -111,11 +112,18 @@ TimerQueue::~TimerQueue()
     for (const Entry& timer : timers_){
         delete timer.second;
     }
+    // 时间轮中的Timer由wheel_析构时释放
 }
 
 // 线程安全的，可以跨线程调用。创建一个Timer并添加到定时器队列中
 TimerId TimerQueue::addTimer(TimerCallback cb, Timestamp when, double interval)
 {
+    if (wheel_ && loop_->isInLoopThread()){
+        // 时间轮模式下loop线程中的定时器从池中取，直接放入时间轮
+        Timer* timer = wheel_->allocate(std::move(cb), when, interval);
+        insertIntoWheel(timer);
+        return TimerId(timer, timer->sequence());
+    }
     Timer* timer = new Timer(std::move(cb), when, interval); // 创建一个Timer
     loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer)); // 添加到定时器队列
     return TimerId(timer, timer->sequence()); // 返回一个TimerId对象
@@ -130,6 +138,12 @@ void TimerQueue::cancel(TimerId timerId)
 void TimerQueue::addTimerInLoop(Timer* timer)
 {
     loop_->assertInLoopThread();
+    if (wheel_){
+        // 其他线程中new出来的Timer交给时间轮管理
+        wheel_->adopt(timer);
+        insertIntoWheel(timer);
+        return;
+    }
     // 插入一个新的定时器，判断是否需要更新timerfd的超时时间
     bool earliestChanged = insert(timer);
 
@@ -141,6 +155,10 @@ void TimerQueue::addTimerInLoop(Timer* timer)
 void TimerQueue::cancelInLoop(TimerId timerId)
 {
     loop_->assertInLoopThread();
+    if (wheel_){
+        cancelInWheel(timerId);
+        return;
+    }
     assert(timers_.size() == activeTimers_.size());
 
     // 通过TimerId从未超时的队列中activeTimers_找Timer
@@ -192,6 +210,10 @@ void TimerQueue::handleRead()
     loop_->assertInLoopThread();
     Timestamp now(Timestamp::now());
     readTimerfd(timerfd_, now);     // 从timerfd描述符进行读操作，避免重复触发超时事件
+    if (wheel_){
+        handleWheelExpired(now);
+        return;
+    }
 
     // 获取当前时刻超时的定时器列表
     std::vector<Entry> expired = getExpired(now);
@@ -200,6 +222,8 @@ void TimerQueue::handleRead()
     cancelingTimers_.clear();       // 清理要取消的的定时器（不再会执行的定时器）
     // safe to callback outside critical section
     for (const Entry& it : expired){
+        // 实际执行时刻比到期时刻晚多少，反映loop是否被其他事件占住
+        loop_->recordTimerLag(now.microSecondsSinceEpoch() - it.first.microSecondsSinceEpoch());
         it.second->run();    // 执行定时器超时的回调函数
     }
     callingExpiredTimers_ = false;
@@ -267,3 +291,85 @@ void TimerQueue::reset(const std::vector<Entry>& expired, Timestamp now)
     if (nextExpire.valid()) { resetTimerfd(timerfd_, nextExpire); }
 }
 
+bool TimerQueue::useTimingWheel(double tickSeconds)
+{
+    loop_->assertInLoopThread();
+    if (wheel_ || !timers_.empty()){
+        LOG_WARN << "TimerQueue::useTimingWheel() must be called once before adding any timer";
+        return false;
+    }
+    int64_t tickUs = static_cast<int64_t>(tickSeconds * Timestamp::kMicroSecondsPerSecond);
+    if (tickUs <= 0){
+        LOG_WARN << "TimerQueue::useTimingWheel() tick " << tickSeconds << "s is too small, using 1us";
+        tickUs = 1;
+    }
+    wheel_.reset(new TimingWheel(tickUs, Timestamp::now()));
+    return true;
+}
+
+size_t TimerQueue::size() const
+{
+    return wheel_ ? wheel_->size() : timers_.size();
+}
+
+void TimerQueue::insertIntoWheel(Timer* timer)
+{
+    wheel_->insert(timer);
+    // 只有比timerfd当前设定的时刻更早时才需要重新设定
+    Timestamp next = wheel_->nextExpiration();
+    if (!wheelArmed_.valid() || next < wheelArmed_){
+        resetTimerfd(timerfd_, next);
+        wheelArmed_ = next;
+    }
+}
+
+// TimerId中的Timer来自时间轮的池，总是可以解引用；序号不同说明已经到期释放，又被别的定时器复用了
+void TimerQueue::cancelInWheel(TimerId timerId)
+{
+    Timer* timer = timerId.timer_;
+    if (timer == NULL){
+        return;
+    }
+    if (timer->sequence() == timerId.sequence_ && wheel_->remove(timer)){
+        // 不重新设定timerfd，多醒来一次没有关系
+        wheel_->release(timer);
+    }
+    else if (callingExpiredTimers_){
+        cancelingTimers_.insert(ActiveTimer(timer, timerId.sequence_));
+    }
+}
+
+void TimerQueue::handleWheelExpired(Timestamp now)
+{
+    wheelExpired_.clear();
+    wheel_->advance(now, &wheelExpired_);
+
+    callingExpiredTimers_ = true;
+    cancelingTimers_.clear();
+    for (Timer* timer : wheelExpired_){
+        loop_->recordTimerLag(now.microSecondsSinceEpoch() - timer->expiration().microSecondsSinceEpoch());
+        timer->run();
+    }
+    callingExpiredTimers_ = false;
+
+    for (Timer* timer : wheelExpired_){
+        ActiveTimer active(timer, timer->sequence());
+        if (timer->repeat() && cancelingTimers_.find(active) == cancelingTimers_.end()){
+            timer->restart(now);
+            wheel_->insert(timer);
+        }
+        else{
+            wheel_->release(timer);
+        }
+    }
+    wheelExpired_.clear();
+    resetWheelTimerfd();
+}
+
+void TimerQueue::resetWheelTimerfd()
+{
+    wheelArmed_ = wheel_->nextExpiration();
+    if (wheelArmed_.valid()){
+        resetTimerfd(timerfd_, wheelArmed_);
+    }
+}
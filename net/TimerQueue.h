@@ -5,6 +5,7 @@
 #ifndef MUDUO_NET_TIMERQUEUE_H
 #define MUDUO_NET_TIMERQUEUE_H
 
+#include <memory>
 #include <set>
 #include <vector>
 
@@ -27,6 +28,7 @@ namespace muduo {
         class EventLoop;
         class Timer;
         class TimerId;
+        class TimingWheel;
 
         class TimerQueue : noncopyable{
         public:
@@ -41,7 +43,14 @@ namespace muduo {
 
             void cancel(TimerId timerId);
 
-
+            // 改用分层时间轮（TimingWheel）保存定时器，tickSeconds是精度：
+            // 插入和取消都是O(1)，loop线程中添加的定时器复用池中的Timer，不分配内存；
+            // 定时器按tick触发，不会提前，最多晚一个tick。
+            // 只能在loop线程中、还没有添加任何定时器时调用一次，否则返回false
+            bool useTimingWheel(double tickSeconds);
+            bool usingTimingWheel() const { return wheel_ != nullptr; }
+            // 未到期的定时器个数
+            size_t size() const;
 
         private:
             /*
@@ -71,6 +80,12 @@ namespace muduo {
 
             bool insert(Timer* timer);
 
+            // 时间轮模式
+            void insertIntoWheel(Timer* timer);
+            void cancelInWheel(TimerId timerId);
+            void handleWheelExpired(Timestamp now);
+            void resetWheelTimerfd();
+
 
             EventLoop* loop_;            			// 所属的EventLoop
             const int timerfd_;				    // 当前定时器队列管理的timerfd
@@ -83,6 +98,10 @@ namespace muduo {
             bool callingExpiredTimers_; /* atomic */        // 是否正在处理超时的定时器
             ActiveTimerSet cancelingTimers_;                // 保存的是被取消的定时器
 
+            std::unique_ptr<TimingWheel> wheel_;            // 不为空时所有定时器都在时间轮中，timers_不再使用
+            std::vector<Timer*> wheelExpired_;              // 时间轮中到期的定时器，复用空间
+            Timestamp wheelArmed_;                          // timerfd当前设定的时刻，用来减少timerfd_settime
+
 
         };
 
@@ -0,0 +1,270 @@
+//
+// Created by fight on 2023/7/14.
+//
+
+#include "TimingWheel.h"
+#include "Timer.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int TimingWheel::kBits;
+const int TimingWheel::kSlots;
+const int TimingWheel::kLevels;
+
+namespace
+{
+    const int64_t kSlotMask = TimingWheel::kSlots - 1;
+    // 所有层一共能表示的tick数
+    const int64_t kMaxDelta = (static_cast<int64_t>(1) << (TimingWheel::kBits * TimingWheel::kLevels)) - 1;
+
+    int slotIndex(int64_t tick, int level)
+    {
+        return static_cast<int>((tick >> (level * TimingWheel::kBits)) & kSlotMask);
+    }
+
+    int lowestBit(uint64_t bits)
+    {
+        return __builtin_ctzll(bits);
+    }
+}
+
+TimingWheel::TimingWheel(int64_t tickMicroseconds, Timestamp start)
+    : tickUs_(tickMicroseconds > 0 ? tickMicroseconds : 1),
+      startUs_(start.microSecondsSinceEpoch()),
+      current_(0),
+      size_(0)
+{
+    memset(slots_, 0, sizeof slots_);
+    memset(occupied_, 0, sizeof occupied_);
+}
+
+TimingWheel::~TimingWheel() = default;
+
+Timer* TimingWheel::allocate(TimerCallback cb, Timestamp when, double interval)
+{
+    if (free_.empty())
+    {
+        Timer* timer = new Timer(std::move(cb), when, interval);
+        owned_.emplace_back(timer);
+        return timer;
+    }
+    Timer* timer = free_.back();
+    free_.pop_back();
+    timer->reset(std::move(cb), when, interval);
+    return timer;
+}
+
+void TimingWheel::adopt(Timer* timer)
+{
+    owned_.emplace_back(timer);
+}
+
+void TimingWheel::release(Timer* timer)
+{
+    assert(!contains(timer));
+    timer->callback_ = TimerCallback();
+    free_.push_back(timer);
+}
+
+int64_t TimingWheel::tickOf(Timestamp when) const
+{
+    const int64_t us = when.microSecondsSinceEpoch() - startUs_;
+    return us <= 0 ? 0 : (us + tickUs_ - 1) / tickUs_;
+}
+
+Timestamp TimingWheel::timeOfTick(int64_t tick) const
+{
+    return Timestamp(startUs_ + tick * tickUs_);
+}
+
+bool TimingWheel::contains(const Timer* timer) const
+{
+    return timer->location_ >= 0;
+}
+
+void TimingWheel::insert(Timer* timer)
+{
+    assert(!contains(timer));
+    timer->tick_ = tickOf(timer->expiration());
+    // 已经过去的tick在下一次advance()时触发
+    if (timer->tick_ < current_)
+    {
+        timer->tick_ = current_;
+    }
+    place(timer);
+    ++size_;
+}
+
+bool TimingWheel::remove(Timer* timer)
+{
+    if (!contains(timer))
+    {
+        return false;
+    }
+    unlink(timer);
+    --size_;
+    return true;
+}
+
+void TimingWheel::place(Timer* timer)
+{
+    // 超出最高层的范围时先放在最高层最远的槽，转到时再重新放置
+    const int64_t delta = timer->tick_ - current_;
+    const int64_t tick = delta > kMaxDelta ? current_ + kMaxDelta : timer->tick_;
+    int level = 0;
+    while (level < kLevels - 1 && (tick - current_) >> ((level + 1) * kBits) != 0)
+    {
+        ++level;
+    }
+    const int slot = slotIndex(tick, level);
+    Timer*& head = slots_[level][slot];
+    timer->prev_ = NULL;
+    timer->next_ = head;
+    if (head)
+    {
+        head->prev_ = timer;
+    }
+    head = timer;
+    timer->location_ = level * kSlots + slot;
+    occupied_[level] |= static_cast<uint64_t>(1) << slot;
+}
+
+void TimingWheel::unlink(Timer* timer)
+{
+    const int level = timer->location_ / kSlots;
+    const int slot = timer->location_ % kSlots;
+    if (timer->prev_)
+    {
+        timer->prev_->next_ = timer->next_;
+    }
+    else
+    {
+        slots_[level][slot] = timer->next_;
+    }
+    if (timer->next_)
+    {
+        timer->next_->prev_ = timer->prev_;
+    }
+    if (slots_[level][slot] == NULL)
+    {
+        occupied_[level] &= ~(static_cast<uint64_t>(1) << slot);
+    }
+    timer->prev_ = timer->next_ = NULL;
+    timer->location_ = -1;
+}
+
+void TimingWheel::cascade(int level, int slot)
+{
+    Timer* timer = slots_[level][slot];
+    slots_[level][slot] = NULL;
+    occupied_[level] &= ~(static_cast<uint64_t>(1) << slot);
+    while (timer)
+    {
+        Timer* next = timer->next_;
+        place(timer);
+        timer = next;
+    }
+}
+
+void TimingWheel::advance(Timestamp now, std::vector<Timer*>* expired)
+{
+    const int64_t nowTick = (now.microSecondsSinceEpoch() - startUs_) / tickUs_;
+    while (current_ <= nowTick)
+    {
+        if (size_ == 0)
+        {
+            current_ = nowTick + 1;
+            break;
+        }
+        if ((current_ & kSlotMask) == 0)
+        {
+            // 第0层转完一圈，上一层当前槽中的定时器放到下面的层；上一层也转完一圈时继续往上
+            for (int level = 1; level < kLevels; ++level)
+            {
+                const int slot = slotIndex(current_, level);
+                if (occupied_[level] & (static_cast<uint64_t>(1) << slot))
+                {
+                    cascade(level, slot);
+                }
+                if (slot != 0)
+                {
+                    break;
+                }
+            }
+        }
+
+        const int index = static_cast<int>(current_ & kSlotMask);
+        if (!(occupied_[0] & (static_cast<uint64_t>(1) << index)))
+        {
+            // 当前tick上没有定时器，直接跳到下一个有定时器到期或者需要cascade的tick，
+            // 中间的圈数没有要处理的槽，跳过它们和逐个tick前进的结果相同
+            const int64_t next = nextTick();
+            assert(next > current_);
+            current_ = next > nowTick ? nowTick + 1 : next;
+            continue;
+        }
+
+        Timer* timer = slots_[0][index];
+        slots_[0][index] = NULL;
+        occupied_[0] &= ~(static_cast<uint64_t>(1) << index);
+        while (timer)
+        {
+            Timer* next = timer->next_;
+            assert(timer->tick_ <= current_);
+            timer->prev_ = timer->next_ = NULL;
+            timer->location_ = -1;
+            --size_;
+            expired->push_back(timer);
+            timer = next;
+        }
+        ++current_;
+    }
+}
+
+int64_t TimingWheel::nextTick() const
+{
+    int64_t earliest = INT64_MAX;
+    for (int level = 0; level < kLevels; ++level)
+    {
+        const uint64_t bits = occupied_[level];
+        if (bits == 0)
+        {
+            continue;
+        }
+        // 第level层的第s个槽在tick的第level层下标等于s、更低的位都为0时转到（第0层就是到期）；
+        // 当前tick的低位为0时当前槽还没有处理，否则当前槽属于下一圈
+        const int shift = level * kBits;
+        const int64_t span = static_cast<int64_t>(1) << (shift + kBits);
+        const int64_t base = current_ & ~(span - 1);
+        int first = slotIndex(current_, level);
+        if (level > 0 && (current_ & ((static_cast<int64_t>(1) << shift) - 1)) != 0)
+        {
+            ++first;
+        }
+        int64_t tick;
+        const uint64_t ahead = first < kSlots ? bits >> first : 0;
+        if (ahead)
+        {
+            tick = base + (static_cast<int64_t>(first + lowestBit(ahead)) << shift);
+        }
+        else
+        {
+            tick = base + span + (static_cast<int64_t>(lowestBit(bits)) << shift);
+        }
+        if (tick < earliest)
+        {
+            earliest = tick;
+        }
+    }
+    return earliest;
+}
+
+Timestamp TimingWheel::nextExpiration() const
+{
+    return size_ == 0 ? Timestamp::invalid() : timeOfTick(nextTick());
+}
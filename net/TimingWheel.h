@@ -0,0 +1,91 @@
+//
+// Created by fight on 2023/7/14.
+//
+
+#ifndef MUDUO_NET_TIMINGWHEEL_H
+#define MUDUO_NET_TIMINGWHEEL_H
+
+#include "../base/Timestamp.h"
+#include "../base/noncopyable.h"
+#include "Callbacks.h"
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace muduo{
+    namespace net{
+        class Timer;
+
+        /*
+         * 分层时间轮，TimerQueue::useTimingWheel()之后代替两个std::set保存定时器。
+         *
+         * 时间按tick（可配置的精度）离散化，定时器在到期时刻向上取整的那个tick触发，不会提前，最多晚一个tick。
+         * kLevels层，每层kSlots个槽：第0层每个槽是1个tick，第L层每个槽是64^L个tick，
+         * 6层可以表示2^36个tick（1ms精度时约795天），更远的定时器先放在最高层，转到时再重新放置。
+         * 定时器按到期tick与当前tick的距离放进对应层的槽中（槽是侵入式双向链表），插入和删除都是O(1)；
+         * 第0层转完一圈时把上一层当前槽中的定时器重新放置到下面的层（cascade），和Linux 4.8之前的定时器相同。
+         * 每层用一个64位的位图记录哪些槽非空，用来跳过空闲的tick和计算下一次需要醒来的时刻。
+         *
+         * Timer对象由时间轮分配和回收：释放的Timer放进空闲链表复用，直到时间轮析构才真正delete，
+         * 所以已经失效的TimerId中的指针总是可以安全地解引用，再用序号判断是不是同一个定时器。
+         *
+         * 只在loop线程中使用，不加锁。
+         */
+        class TimingWheel : noncopyable{
+        public:
+            static const int kBits = 6;
+            static const int kSlots = 1 << kBits;
+            static const int kLevels = 6;
+
+            // 以start为第0个tick，每个tick为tickMicroseconds微秒
+            TimingWheel(int64_t tickMicroseconds, Timestamp start);
+            ~TimingWheel();
+
+            // 从空闲链表中取一个Timer，没有时才new
+            Timer* allocate(TimerCallback cb, Timestamp when, double interval);
+            // 接管在其他线程中new出来的Timer，之后和池中的Timer一样释放
+            void adopt(Timer* timer);
+            // 回收Timer，释放回调持有的资源，Timer必须不在轮中
+            void release(Timer* timer);
+
+            // 按timer->expiration()放入轮中
+            void insert(Timer* timer);
+            // 从轮中删除，timer不在轮中时返回false
+            bool remove(Timer* timer);
+            bool contains(const Timer* timer) const;
+
+            // 把到期时刻不晚于now的定时器按tick的先后从轮中取出，追加到expired末尾
+            void advance(Timestamp now, std::vector<Timer*>* expired);
+            // 下一次需要advance()的时刻（不晚于最早的定时器到期的tick），轮为空时返回Timestamp::invalid()
+            Timestamp nextExpiration() const;
+
+            size_t size() const { return size_; }
+            size_t pooled() const { return free_.size(); }    // 空闲链表中的Timer个数
+            int64_t tickMicroseconds() const { return tickUs_; }
+
+        private:
+            int64_t tickOf(Timestamp when) const;       // 向上取整
+            Timestamp timeOfTick(int64_t tick) const;
+            // 下一个有定时器到期或者需要cascade的tick
+            int64_t nextTick() const;
+            // 按timer->tick_和current_放到对应层的槽中
+            void place(Timer* timer);
+            void unlink(Timer* timer);
+            // 把第level层slot槽中的定时器重新放置
+            void cascade(int level, int slot);
+
+            const int64_t tickUs_;
+            const int64_t startUs_;
+            int64_t current_;       // 下一个要处理的tick，更早的tick上的定时器都已经取出
+            size_t size_;
+            Timer* slots_[kLevels][kSlots];
+            uint64_t occupied_[kLevels];      // 每层非空槽的位图
+
+            std::vector<Timer*> free_;
+            std::vector<std::unique_ptr<Timer>> owned_;  // 池中所有的Timer，包括正在使用的
+        };
+    }
+}
+
+#endif //MUDUO_NET_TIMINGWHEEL_H
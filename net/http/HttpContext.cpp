@@ -4,6 +4,7 @@
 
 #include "HttpContext.h"
 #include "../Buffer.h"
+#include "../Scan.h"
 
 using namespace muduo;
 using namespace muduo::net;
@@ -34,8 +35,8 @@ bool HttpContext::parseRequest(Buffer* buf, Timestamp receiveTime)
             const char* crlf = buf->findCRLF(); // 找到“\r\n”位置
             if (crlf)
             {
-                const char* colon = std::find(buf->peek(), crlf, ':'); // 定位分隔符
-                if (colon != crlf){
+                const char* colon = scan::findByte(buf->peek(), crlf, ':'); // 定位分隔符
+                if (colon){
                     request_.addHeader(buf->peek(), colon, crlf); // 键值对解析
                 }
                 else{
@@ -61,16 +62,16 @@ bool HttpContext::processRequestLine(const char* begin, const char* end)
 {
     bool succeed = false;
     const char* start = begin;
-    const char* space = std::find(start, end, ' ');
+    const char* space = scan::findByte(start, end, ' ');
     // 第一个空格前的字符串，请求方法
-    if (space != end && request_.setMethod(start, space))
+    if (space && request_.setMethod(start, space))
     {
         start = space+1;
-        space = std::find(start, end, ' ');
-        if (space != end)
+        space = scan::findByte(start, end, ' ');
+        if (space)
         {  // 第二个空格前的字符串，URL
-            const char* question = std::find(start, space, '?');
-            if (question != space){  // 如果有"?"，分割成path和请求参数
+            const char* question = scan::findByte(start, space, '?');
+            if (question){  // 如果有"?"，分割成path和请求参数
                 request_.setPath(start, question);
                 request_.setQuery(question, space);
             }
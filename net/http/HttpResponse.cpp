@@ -12,6 +12,12 @@ using namespace muduo;
 using namespace muduo::net;
 
 void HttpResponse::appendToBuffer(Buffer* output) const
+{
+    appendHeaderToBuffer(output);
+    output->append(body_);   // 响应体
+}
+
+void HttpResponse::appendHeaderToBuffer(Buffer* output) const
 {
     char buf[32];
     // 响应行
@@ -37,5 +43,4 @@ void HttpResponse::appendToBuffer(Buffer* output) const
     }
 
     output->append("\r\n");  // 空行
-    output->append(body_);   // 响应体
 }
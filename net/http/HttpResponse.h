@@ -36,10 +36,12 @@ namespace muduo{
             void addHeader(const string& key, const string& value) { headers_[key] = value; }
 
             void setBody(const string& body) { body_ = body; }
+            const string& body() const { return body_; }
 
             bool closeConnection() const { return closeConnection_; }
 
             void appendToBuffer(Buffer* output) const;  // 将整个HttpRespose对象按照协议输出到Buffer中
+            void appendHeaderToBuffer(Buffer* output) const;  // 只输出响应行和头部（含空行），不含响应体
 
 
         private:
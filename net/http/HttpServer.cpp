@@ -78,8 +78,10 @@ void HttpServer::onRequest(const TcpConnectionPtr& conn, const HttpRequest& req)
     HttpResponse response(close);
     httpCallback_(req, &response);  // 调用客户端的http处理函数，填充response
     Buffer buf;
-    response.appendToBuffer(&buf); // 将响应格式化填充到buf中
-    conn->send(&buf);				 // 将响应回复发送给客户端
+    response.appendHeaderToBuffer(&buf); // 将响应行和头部格式化填充到buf中
+    // 头部和响应体作为两个片段一次writev发送，响应体不再拷贝到buf中
+    StringPiece pieces[2] = { buf.toStringPiece(), response.body() };
+    conn->send(pieces, 2);
     if (response.closeConnection()){
         conn->shutdown();  // 如果是短连接，直接关闭。
     }
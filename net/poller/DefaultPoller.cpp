@@ -4,19 +4,33 @@
 #include "../Poller.h"
 #include "PollPoller.h"
 #include "EPollPoller.h"
+#include "IoUringPoller.h"
+#include "../../base/Logging.h"
 
 #include <stdlib.h>
 
 using namespace muduo::net;
 
+// 运行时用环境变量选择后端：MUDUO_USE_POLL优先，其次MUDUO_USE_IO_URING，默认epoll
 Poller* Poller::newDefaultPoller(EventLoop* loop)
 {
     if (::getenv("MUDUO_USE_POLL"))
     {
         return new PollPoller(loop);
     }
+    else if (::getenv("MUDUO_USE_IO_URING"))
+    {
+        IoUringPoller* poller = new IoUringPoller(loop);
+        if (poller->valid())
+        {
+            return poller;
+        }
+        delete poller;
+        LOG_WARN << "io_uring is not available, falling back to epoll";
+        return new EPollPoller(loop);
+    }
     else
     {
         return new EPollPoller(loop);
     }
-}
\ No newline at end of file
+}
@@ -6,6 +6,7 @@
 #include "../Channel.h"
 #include "../../base/Logging.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <errno.h>
 #include <poll.h>
@@ -34,7 +35,8 @@ namespace
 EPollPoller::EPollPoller(EventLoop *loop)
     : Poller(loop),
     epollfd_(::epoll_create1(EPOLL_CLOEXEC)),
-    events_(kInitEventListSize){
+    events_(kInitEventListSize),
+    batched_(false){
 
     if(epollfd_ < 0){
         LOG_SYSFATAL << " EPollPoller::EPollPoller";
@@ -53,6 +55,9 @@ EPollPoller::~EPollPoller(){
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels)
 {
     LOG_TRACE << "fd total count " << channels_.size();
+    if (!dirtyFds_.empty()){
+        applyPendingUpdates();
+    }
     int numEvents = ::epoll_wait(epollfd_,          // 当前epoll占用的fd
                                  &*events_.begin(),    // events_数组第一个元素地址
                                  static_cast<int>(events_.size()), // events_数组元素个数
@@ -80,43 +85,44 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels)
 
 
 // 将Channel对应的fd上关注的事件注册、更新到epoll中，
-// 用于维护和更新std::map<int, Channel*> channels_。
+// 用于维护和更新channels_。channel的index()是期望的状态，interests_是内核中实际的注册，
+// 批量模式下只记下有变化的fd，在下一次epoll_wait之前由applyPendingUpdates()统一提交
 void EPollPoller::updateChannel(Channel* channel)
 {
     Poller::assertInLoopThread();
     const int index = channel->index();
     LOG_TRACE << "fd = " << channel->fd() << " events = " << channel->events() << " index = " << index;
 
+    int fd = channel->fd();
     if (index == kNew || index == kDeleted){ //没在或者曾经在epoll队列中，添加到epoll队列中
-        // a new one, add with EPOLL_CTL_ADD
-        int fd = channel->fd();
         if (index == kNew){  //没在epoll队列中
-            assert(channels_.find(fd) == channels_.end());
-            channels_[fd] = channel;    // channels_中添加 fd->channel键值对
+            assert(channels_.find(fd) == NULL);
+            channels_.insert(fd, channel);    // channels_中添加 fd->channel键值对
         }
         else { // index == kDeleted  // 曾经在epoll队列中
-            assert(channels_.find(fd) != channels_.end());
-            assert(channels_[fd] == channel);
+            assert(channels_.find(fd) == channel);
         }
 
         channel->set_index(kAdded);     //修改index为已在队列中kAdded（1）
-        update(EPOLL_CTL_ADD, channel);     // 注册事件
     }
     else{ //如果就在epoll队列中的，若没有关注事件了就暂时删除，如果有关注事件，就修改
-        // update existing one with EPOLL_CTL_MOD/DEL
-        int fd = channel->fd();
-        (void)fd;
-        assert(channels_.find(fd) != channels_.end());
-        assert(channels_[fd] == channel);
+        assert(channels_.find(fd) == channel);
         assert(index == kAdded);
         if (channel->isNoneEvent()){
-            update(EPOLL_CTL_DEL, channel);   // 删除事件
             channel->set_index(kDeleted);     // channel标记kDeleted（2）暂时删除
         }
-        else{
-            update(EPOLL_CTL_MOD, channel);  // 更新事件
+    }
+
+    if (batched_){
+        Interest& in = interest(fd);
+        if (!in.dirty){
+            in.dirty = true;
+            dirtyFds_.push_back(fd);
         }
     }
+    else{
+        applyUpdate(fd, channel);
+    }
 }
 
 void EPollPoller::removeChannel(Channel* channel)
@@ -124,8 +130,7 @@ void EPollPoller::removeChannel(Channel* channel)
     Poller::assertInLoopThread();
     int fd = channel->fd();
     LOG_TRACE << "fd = " << fd;
-    assert(channels_.find(fd) != channels_.end());
-    assert(channels_[fd] == channel);
+    assert(channels_.find(fd) == channel);
     assert(channel->isNoneEvent());
 
     int index = channel->index();
@@ -134,12 +139,65 @@ void EPollPoller::removeChannel(Channel* channel)
     (void)n;
     assert(n == 1);
 
-    if (index == kAdded){
+    // 调用方随后会close(fd)，fd可能马上被复用，所以删除不能推迟；
+    // 还没提交的修改留在dirtyFds_中，提交时channels_中已经没有这个channel，什么也不做
+    Interest& in = interest(fd);
+    if (in.added){
         update(EPOLL_CTL_DEL, channel); //从epoll队列中删除这个channel
+        in.added = false;
     }
     channel->set_index(kNew);  //设置标志位是kNew(-1) ，相当于完全删除
 }
 
+bool EPollPoller::setBatchedUpdates(bool on)
+{
+    Poller::assertInLoopThread();
+    if (!on){
+        applyPendingUpdates();
+    }
+    batched_ = on;
+    return true;
+}
+
+EPollPoller::Interest& EPollPoller::interest(int fd)
+{
+    if (static_cast<size_t>(fd) >= interests_.size()){
+        interests_.resize(std::max(static_cast<size_t>(fd) + 1, interests_.size() * 2));
+    }
+    return interests_[fd];
+}
+
+// 比较期望的状态和内核中的注册，只提交净变化：
+// 同一轮中开了又关的可写事件、改了又改回去的事件都不需要epoll_ctl
+void EPollPoller::applyUpdate(int fd, Channel* channel)
+{
+    Interest& in = interest(fd);
+    const bool wanted = channel != NULL && channel->index() == kAdded;
+    if (wanted && !in.added){
+        update(EPOLL_CTL_ADD, channel);     // 注册事件
+        in.added = true;
+        in.events = channel->events();
+    }
+    else if (wanted && in.events != channel->events()){
+        update(EPOLL_CTL_MOD, channel);  // 更新事件
+        in.events = channel->events();
+    }
+    else if (!wanted && in.added){
+        assert(channel != NULL);
+        update(EPOLL_CTL_DEL, channel);   // 删除事件
+        in.added = false;
+    }
+}
+
+void EPollPoller::applyPendingUpdates()
+{
+    for (int fd : dirtyFds_){
+        interests_[fd].dirty = false;
+        applyUpdate(fd, channels_.find(fd));
+    }
+    dirtyFds_.clear();
+}
+
 const char* EPollPoller::operationToString(int op)
 {
     switch (op)
@@ -172,6 +230,7 @@ void EPollPoller::update(int operation, Channel* channel)
     event.data.ptr = channel;         // 注意，event.data.ptr被赋值指向当前指针channel
     int fd = channel->fd();
     LOG_TRACE << "epoll_ctl op = " << operationToString(operation) << " fd = " << fd << " event = { " << channel->eventsToString() << " }";
+    ++ctlCalls_;
 
     if (::epoll_ctl(epollfd_, operation, fd, &event) < 0) {
         if (operation == EPOLL_CTL_DEL){
@@ -199,12 +258,7 @@ void EPollPoller::fillActiveChannels(int numEvents, ChannelList* activeChannels)
     for (int i = 0; i < numEvents; ++i)
     {
         Channel* channel = static_cast<Channel*>(events_[i].data.ptr); // 获取当前就绪IO事件对应的channel
-        #ifndef NDEBUG
-                int fd = channel->fd();
-                ChannelMap::const_iterator it = channels_.find(fd);
-                assert(it != channels_.end());
-                assert(it->second == channel);
-        #endif
+        assert(channels_.find(channel->fd()) == channel);
         channel->set_revents(events_[i].events);  // 设置channel当前就绪的IO事件
         activeChannels->push_back(channel);       // 就绪IO事件channe放入activeChannels
     }
@@ -26,6 +26,11 @@ namespace muduo{
             void updateChannel(Channel* channel) override;
             // 当通道被销毁时移除它
             void removeChannel(Channel* channel) override;
+            bool supportsEdgeTriggered() const override { return true; }
+            const char* name() const override { return "epoll"; }
+            // 批量模式：updateChannel()只记录变化，下一次epoll_wait之前每个fd只按净变化调用一次epoll_ctl。
+            // removeChannel()总是立即生效
+            bool setBatchedUpdates(bool on) override;
 
         private:
             typedef std::vector<struct epoll_event> EventList;
@@ -37,8 +42,24 @@ namespace muduo{
 
             void update(int operation,Channel* channel);
 
+            // 某个fd在内核中的注册状态
+            struct Interest
+            {
+                Interest() : events(0), added(false), dirty(false) { }
+                int events;     // 注册的事件
+                bool added;     // 已经EPOLL_CTL_ADD
+                bool dirty;     // 在dirtyFds_中
+            };
+            Interest& interest(int fd);
+            // 按channel期望的状态和内核中的注册之差调用epoll_ctl，channel为NULL表示已经removeChannel()
+            void applyUpdate(int fd, Channel* channel);
+            void applyPendingUpdates();
+
             int epollfd_;
             EventList events_;
+            bool batched_;
+            std::vector<Interest> interests_;   // 下标是fd
+            std::vector<int> dirtyFds_;         // 批量模式下本轮有变化的fd
 
         };
     }
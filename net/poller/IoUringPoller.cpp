@@ -0,0 +1,478 @@
+//
+// Created by fight on 2023/7/12.
+//
+
+#include "IoUringPoller.h"
+#include "../Channel.h"
+#include "../../base/Logging.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+    const int kNew = -1; // 没在registrations_中
+    const int kAdded = 1; // 已经注册
+    const int kDeleted = 2; // 以前在但是被删了
+
+    // POLL_REMOVE自己的完成事件用这个user_data，直接丢弃；有效的序号从1开始
+    const uint64_t kIgnoreUserData = 0;
+
+    int sysIoUringSetup(unsigned entries, struct io_uring_params* p)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+    }
+
+    int sysIoUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags,
+                        const void* arg, size_t argSize)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+    }
+
+    uint64_t encodeUserData(int fd, uint32_t generation)
+    {
+        return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+    }
+
+    template<typename T>
+    T* ringAt(void* ring, uint32_t offset)
+    {
+        return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+    }
+}
+
+const unsigned IoUringPoller::kRingEntries;
+
+IoUringPoller::IoUringPoller(EventLoop* loop)
+    : Poller(loop),
+      ringFd_(-1),
+      sqRing_(MAP_FAILED),
+      sqRingSize_(0),
+      sqes_(NULL),
+      sqesSize_(0),
+      sqHead_(NULL),
+      sqTail_(NULL),
+      sqArray_(NULL),
+      sqMask_(0),
+      sqEntries_(0),
+      sqPending_(0),
+      cqRing_(MAP_FAILED),
+      cqRingSize_(0),
+      cqes_(NULL),
+      cqHead_(NULL),
+      cqTail_(NULL),
+      cqMask_(0)
+{
+    if (!setupRing())
+    {
+        unmapRing();
+    }
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    unmapRing();
+}
+
+bool IoUringPoller::setupRing()
+{
+    struct io_uring_params params;
+    memZero(&params, sizeof params);
+    // 完成队列开大一些，一轮中大量连接同时就绪时不至于溢出到内核的overflow链表
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    params.cq_entries = kRingEntries * 4;
+    ringFd_ = sysIoUringSetup(kRingEntries, &params);
+    if (ringFd_ < 0 && errno == EINVAL)
+    {
+        // 6.1之前的内核没有DEFER_TASKRUN
+        memZero(&params, sizeof params);
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = kRingEntries * 4;
+        ringFd_ = sysIoUringSetup(kRingEntries, &params);
+    }
+    if (ringFd_ < 0)
+    {
+        LOG_SYSERR << "io_uring_setup";
+        return false;
+    }
+    // 等待时需要超时参数(EXT_ARG, 5.11)，完成队列满时不能丢事件(NODROP)
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP))
+    {
+        LOG_ERROR << "io_uring lacks IORING_FEAT_EXT_ARG/IORING_FEAT_NODROP, features = " << params.features;
+        return false;
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    const bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMmap)
+    {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+    sqRing_ = ::mmap(NULL, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED)
+    {
+        LOG_SYSERR << "mmap IORING_OFF_SQ_RING";
+        return false;
+    }
+    if (singleMmap)
+    {
+        cqRing_ = sqRing_;
+    }
+    else
+    {
+        cqRing_ = ::mmap(NULL, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED)
+        {
+            LOG_SYSERR << "mmap IORING_OFF_CQ_RING";
+            return false;
+        }
+    }
+    sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = ::mmap(NULL, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ringFd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        LOG_SYSERR << "mmap IORING_OFF_SQES";
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    sqHead_ = ringAt<unsigned>(sqRing_, params.sq_off.head);
+    sqTail_ = ringAt<unsigned>(sqRing_, params.sq_off.tail);
+    sqArray_ = ringAt<unsigned>(sqRing_, params.sq_off.array);
+    sqMask_ = *ringAt<unsigned>(sqRing_, params.sq_off.ring_mask);
+    sqEntries_ = *ringAt<unsigned>(sqRing_, params.sq_off.ring_entries);
+    cqHead_ = ringAt<unsigned>(cqRing_, params.cq_off.head);
+    cqTail_ = ringAt<unsigned>(cqRing_, params.cq_off.tail);
+    cqMask_ = *ringAt<unsigned>(cqRing_, params.cq_off.ring_mask);
+    cqes_ = ringAt<io_uring_cqe>(cqRing_, params.cq_off.cqes);
+    LOG_DEBUG << "io_uring fd = " << ringFd_ << " sq = " << sqEntries_ << " cq = " << params.cq_entries
+              << " features = " << params.features;
+    return true;
+}
+
+void IoUringPoller::unmapRing()
+{
+    if (sqes_)
+    {
+        ::munmap(sqes_, sqesSize_);
+        sqes_ = NULL;
+    }
+    if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_)
+    {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    cqRing_ = MAP_FAILED;
+    if (sqRing_ != MAP_FAILED)
+    {
+        ::munmap(sqRing_, sqRingSize_);
+        sqRing_ = MAP_FAILED;
+    }
+    if (ringFd_ >= 0)
+    {
+        ::close(ringFd_);
+        ringFd_ = -1;
+    }
+}
+
+/*
+ * 先给上一轮完成的单次poll重新注册，然后把积攒的SQE和等待合并成一次io_uring_enter()，
+ * 最后取出完成队列中的事件填入activeChannels。
+ */
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList* activeChannels)
+{
+    LOG_TRACE << "fd total count " << channels_.size();
+    for (int fd : rearm_)
+    {
+        Registration& reg = registrations_[fd];
+        if (reg.channel && !reg.armed && reg.channel->index() == kAdded)
+        {
+            arm(fd, &reg);
+        }
+    }
+    rearm_.clear();
+
+    int ret = enter(timeoutMs != 0 ? 1 : 0, timeoutMs);
+    int savedErrno = errno;
+    Timestamp now(Timestamp::now());
+
+    fillActiveChannels(activeChannels);
+    if (!activeChannels->empty())
+    {
+        LOG_TRACE << activeChannels->size() << " events happened";
+    }
+    else if (ret >= 0 || savedErrno == ETIME)
+    {
+        LOG_TRACE << "nothing happened";
+    }
+    // 超时返回ETIME；完成队列溢出到内核时可能返回EBUSY，取走完成事件后下一轮再提交
+    if (ret < 0 && savedErrno != EINTR && savedErrno != ETIME &&
+        savedErrno != EBUSY && savedErrno != EAGAIN)
+    {
+        errno = savedErrno;
+        LOG_SYSERR << "IoUringPoller::poll()";
+    }
+    return now;
+}
+
+int IoUringPoller::enter(unsigned minComplete, int timeoutMs)
+{
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memZero(&arg, sizeof arg);
+    arg.sigmask_sz = _NSIG / 8;
+    if (timeoutMs >= 0)
+    {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    // 带GETEVENTS才会执行DEFER_TASKRUN推迟的完成处理，minComplete为0时不会阻塞
+    int ret = sysIoUringEnter(ringFd_, sqPending_, minComplete,
+                              IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof arg);
+    // 没有SQPOLL时提交在系统调用中同步完成，内核没取走的（比如返回EAGAIN）留到下一次
+    sqPending_ = *sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    return ret;
+}
+
+void IoUringPoller::submit()
+{
+    ++ctlCalls_;
+    // 带GETEVENTS让DEFER_TASKRUN推迟的取消立即完成，释放对文件的引用
+    if (sysIoUringEnter(ringFd_, sqPending_, 0, IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+    {
+        LOG_SYSERR << "io_uring_enter submit";
+    }
+    sqPending_ = *sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+}
+
+io_uring_sqe* IoUringPoller::getSqe()
+{
+    if (sqPending_ == sqEntries_)
+    {
+        // 提交队列满了，先单独提交一次
+        submit();
+        if (sqPending_ == sqEntries_)
+        {
+            LOG_FATAL << "io_uring submission queue stuck, pending = " << sqPending_;
+        }
+    }
+    const unsigned tail = *sqTail_;
+    const unsigned index = tail & sqMask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    memZero(sqe, sizeof *sqe);
+    sqArray_[index] = index;
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+    ++sqPending_;
+    return sqe;
+}
+
+IoUringPoller::Registration& IoUringPoller::registration(int fd)
+{
+    assert(fd >= 0);
+    if (static_cast<size_t>(fd) >= registrations_.size())
+    {
+        registrations_.resize(std::max(static_cast<size_t>(fd) + 1, registrations_.size() * 2));
+    }
+    return registrations_[fd];
+}
+
+void IoUringPoller::arm(int fd, Registration* reg)
+{
+    Channel* channel = reg->channel;
+    if (++reg->generation == 0)
+    {
+        reg->generation = 1;
+    }
+    reg->events = channel->events();
+    reg->multishot = channel->isEdgeTriggered();
+    reg->armed = true;
+
+    io_uring_sqe* sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    // EPOLLET不是poll(2)的事件，边沿触发由multishot实现
+    sqe->poll32_events = static_cast<uint32_t>(reg->events) & ~static_cast<uint32_t>(EPOLLET);
+    sqe->len = reg->multishot ? IORING_POLL_ADD_MULTI : 0;
+    sqe->user_data = encodeUserData(fd, reg->generation);
+    LOG_TRACE << "io_uring poll add fd = " << fd << " event = { " << channel->eventsToString() << " }";
+}
+
+void IoUringPoller::disarm(int fd, Registration* reg)
+{
+    if (!reg->armed)
+    {
+        return;
+    }
+    io_uring_sqe* sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = encodeUserData(fd, reg->generation);
+    sqe->user_data = kIgnoreUserData;
+    reg->armed = false;
+    // 已经在完成队列中的旧事件不再属于当前注册
+    if (++reg->generation == 0)
+    {
+        reg->generation = 1;
+    }
+    LOG_TRACE << "io_uring poll remove fd = " << fd;
+}
+
+// 与EPollPoller相同，用channel的index()记录是否已经注册
+void IoUringPoller::updateChannel(Channel* channel)
+{
+    Poller::assertInLoopThread();
+    const int index = channel->index();
+    const int fd = channel->fd();
+    LOG_TRACE << "fd = " << fd << " events = " << channel->events() << " index = " << index;
+    Registration& reg = registration(fd);
+
+    if (index == kNew || index == kDeleted)
+    {
+        if (index == kNew)
+        {
+            assert(channels_.find(fd) == NULL);
+            channels_.insert(fd, channel);
+        }
+        else
+        {
+            assert(channels_.find(fd) == channel);
+        }
+        channel->set_index(kAdded);
+        reg.channel = channel;
+        arm(fd, &reg);
+    }
+    else
+    {
+        assert(channels_.find(fd) == channel);
+        assert(index == kAdded);
+        assert(reg.channel == channel);
+        if (channel->isNoneEvent())
+        {
+            disarm(fd, &reg);
+            channel->set_index(kDeleted);
+        }
+        else if (!reg.armed)
+        {
+            // 单次poll已经完成，还没来得及重新注册
+            arm(fd, &reg);
+        }
+        else if (reg.events != channel->events() || reg.multishot != channel->isEdgeTriggered())
+        {
+            disarm(fd, &reg);
+            arm(fd, &reg);
+        }
+    }
+}
+
+void IoUringPoller::removeChannel(Channel* channel)
+{
+    Poller::assertInLoopThread();
+    int fd = channel->fd();
+    LOG_TRACE << "fd = " << fd;
+    assert(channels_.find(fd) == channel);
+    assert(channel->isNoneEvent());
+
+    int index = channel->index();
+    assert(index == kAdded || index == kDeleted);
+    size_t n = channels_.erase(fd);
+    (void)n;
+    assert(n == 1);
+
+    Registration& reg = registration(fd);
+    disarm(fd, &reg);
+    reg.channel = NULL;
+    channel->set_index(kNew);
+    // 内核中的poll请求持有文件的引用，调用方随后close(fd)时必须已经取消，
+    // 否则socket不会真正关闭（监听端口不释放、对端收不到FIN），所以这里立即提交
+    if (sqPending_ > 0)
+    {
+        submit();
+    }
+}
+
+/*
+ * 取出完成队列中的所有事件。同一个channel在这一轮的多个完成事件合并成一次，
+ * 序号不是当前注册的完成事件（已经修改或删除的旧请求）直接丢弃。
+ */
+void IoUringPoller::fillActiveChannels(ChannelList* activeChannels)
+{
+    unsigned head = *cqHead_;
+    const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head)
+    {
+        const io_uring_cqe* cqe = &cqes_[head & cqMask_];
+        if (cqe->user_data == kIgnoreUserData)
+        {
+            continue;
+        }
+        const int fd = static_cast<int>(static_cast<uint32_t>(cqe->user_data));
+        const uint32_t generation = static_cast<uint32_t>(cqe->user_data >> 32);
+        if (static_cast<size_t>(fd) >= registrations_.size())
+        {
+            continue;
+        }
+        Registration& reg = registrations_[fd];
+        if (reg.channel == NULL || !reg.armed || reg.generation != generation)
+        {
+            continue;
+        }
+        if (!reg.multishot || !(cqe->flags & IORING_CQE_F_MORE))
+        {
+            // 单次poll完成了，或者multishot被内核终止，下一次poll()时重新注册
+            reg.armed = false;
+            rearm_.push_back(fd);
+        }
+
+        int revents = 0;
+        if (cqe->res >= 0)
+        {
+            revents = cqe->res;
+        }
+        else if (cqe->res != -ECANCELED)
+        {
+            // 比如fd已经被关闭(EBADF)，和poll(2)一样报告POLLNVAL
+            revents = POLLNVAL;
+        }
+        if (revents == 0)
+        {
+            continue;
+        }
+        if (!reg.active)
+        {
+            reg.active = true;
+            reg.revents = revents;
+            activeFds_.push_back(fd);
+        }
+        else
+        {
+            reg.revents |= revents;
+        }
+    }
+    __atomic_store_n(cqHead_, tail, __ATOMIC_RELEASE);
+
+    for (int fd : activeFds_)
+    {
+        Registration& reg = registrations_[fd];
+        reg.active = false;
+        assert(channels_.find(fd) == reg.channel);
+        reg.channel->set_revents(reg.revents);
+        activeChannels->push_back(reg.channel);
+    }
+    activeFds_.clear();
+}
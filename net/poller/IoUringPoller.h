@@ -0,0 +1,113 @@
+//
+// Created by fight on 2023/7/12.
+//
+
+#ifndef MUDUO_NET_POLLER_IOURINGPOLLER_H
+#define MUDUO_NET_POLLER_IOURINGPOLLER_H
+
+#include "../Poller.h"
+
+#include <stdint.h>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace muduo{
+    namespace net{
+        /*
+         * 基于io_uring的Poller，设置环境变量MUDUO_USE_IO_URING后由newDefaultPoller()选用，
+         * 内核不支持时退回epoll。
+         *
+         * 每个channel对应一个IORING_OP_POLL_ADD请求，user_data里是fd和这次注册的序号(generation)，
+         * 修改、删除注册时序号加一，已经提交但还没取走的旧完成事件按序号丢弃。
+         *   水平触发的channel用单次poll：完成后在下一次poll()时重新注册，重新注册时内核会先检查一次就绪状态，
+         *   所以和epoll的LT语义相同（没读完的数据下一轮还会报告）。
+         *   边沿触发的channel（Channel::enableEdgeTriggered()）用multishot poll，注册一次一直有效，
+         *   只在状态变化时产生完成事件，和EPOLLET相同。
+         * updateChannel()/removeChannel()只是把SQE写进提交队列，
+         * 和等待完成事件合并成一次io_uring_enter()提交；只有removeChannel()和提交队列满时才单独提交（计入ctlCalls()）。
+         */
+        class IoUringPoller : public Poller{
+        public:
+            IoUringPoller(EventLoop* loop);
+            ~IoUringPoller() override;
+
+            // io_uring_setup()是否成功，失败时newDefaultPoller()改用EPollPoller
+            bool valid() const { return ringFd_ >= 0; }
+
+            // 轮询 I/O 事件。
+            Timestamp poll(int timeoutMs, ChannelList* activeChannels) override;
+            // 更改监听 的 I/O 事件。
+            void updateChannel(Channel* channel) override;
+            // 当通道被销毁时移除它
+            void removeChannel(Channel* channel) override;
+            bool supportsEdgeTriggered() const override { return true; }
+            const char* name() const override { return "io_uring"; }
+            // 总是批量提交，不能关闭
+            bool setBatchedUpdates(bool on) override { return on; }
+
+        private:
+            static const unsigned kRingEntries = 1024;
+
+            // 每个fd当前注册的poll请求
+            struct Registration
+            {
+                Registration()
+                    : channel(NULL), generation(0), events(0),
+                      armed(false), multishot(false), active(false), revents(0) { }
+
+                Channel* channel;
+                uint32_t generation;   // 当前poll请求的序号，user_data的高32位
+                int events;            // 提交时关注的事件
+                bool armed;            // 内核中有这个fd的poll请求
+                bool multishot;
+                bool active;           // 已经放进activeChannels，合并同一轮的多个完成事件
+                int revents;
+            };
+
+            bool setupRing();
+            void unmapRing();
+
+            Registration& registration(int fd);
+            // 提交一个poll请求，关注channel当前的事件
+            void arm(int fd, Registration* reg);
+            // 取消当前的poll请求
+            void disarm(int fd, Registration* reg);
+            io_uring_sqe* getSqe();
+            // 只提交不等待，提交队列满或removeChannel()时调用，计入ctlCalls()
+            void submit();
+            // 提交所有SQE，minComplete > 0 时等待完成事件，最多等timeoutMs
+            int enter(unsigned minComplete, int timeoutMs);
+            void fillActiveChannels(ChannelList* activeChannels);
+
+            int ringFd_;
+
+            // 提交队列
+            void* sqRing_;
+            size_t sqRingSize_;
+            io_uring_sqe* sqes_;
+            size_t sqesSize_;
+            unsigned* sqHead_;
+            unsigned* sqTail_;
+            unsigned* sqArray_;
+            unsigned sqMask_;
+            unsigned sqEntries_;
+            unsigned sqPending_;      // 已经写入还没提交的SQE个数
+
+            // 完成队列，和提交队列共用一次mmap时cqRing_ == sqRing_
+            void* cqRing_;
+            size_t cqRingSize_;
+            io_uring_cqe* cqes_;
+            unsigned* cqHead_;
+            unsigned* cqTail_;
+            unsigned cqMask_;
+
+            std::vector<Registration> registrations_;   // 下标是fd
+            std::vector<int> rearm_;                     // 单次poll已完成，下一次poll()前要重新注册的fd
+            std::vector<int> activeFds_;
+        };
+    }
+}
+
+#endif //MUDUO_NET_POLLER_IOURINGPOLLER_H
@@ -56,9 +56,8 @@ void PollPoller::fillActiveChannels(int numEvents,
         if (pfd->revents > 0)
         {
             --numEvents;
-            ChannelMap::const_iterator ch = channels_.find(pfd->fd);
-            assert(ch != channels_.end());
-            Channel* channel = ch->second;
+            Channel* channel = channels_.find(pfd->fd);
+            assert(channel != NULL);
             assert(channel->fd() == pfd->fd);
             channel->set_revents(pfd->revents);
             // pfd->revents = 0;
@@ -74,7 +73,7 @@ void PollPoller::updateChannel(Channel* channel)
     if (channel->index() < 0)
     {
         // a new one, add to pollfds_
-        assert(channels_.find(channel->fd()) == channels_.end());
+        assert(channels_.find(channel->fd()) == NULL);
         struct pollfd pfd;
         pfd.fd = channel->fd();
         pfd.events = static_cast<short>(channel->events());
@@ -83,13 +82,12 @@ void PollPoller::updateChannel(Channel* channel)
         // 设置channel map
         int idx = static_cast<int>(pollfds_.size())-1; // idx为当前fd在pollfds_数组中的下标
         channel->set_index(idx);
-        channels_[pfd.fd] = channel;
+        channels_.insert(pfd.fd, channel);
     }
     else
     {
         // update existing one
-        assert(channels_.find(channel->fd()) != channels_.end());
-        assert(channels_[channel->fd()] == channel);
+        assert(channels_.find(channel->fd()) == channel);
         int idx = channel->index();
         assert(0 <= idx && idx < static_cast<int>(pollfds_.size()));
         struct pollfd& pfd = pollfds_[idx];
@@ -110,8 +108,7 @@ void PollPoller::removeChannel(Channel* channel)
 {
     Poller::assertInLoopThread();
     LOG_TRACE << "fd = " << channel->fd();
-    assert(channels_.find(channel->fd()) != channels_.end());
-    assert(channels_[channel->fd()] == channel);
+    assert(channels_.find(channel->fd()) == channel);
     assert(channel->isNoneEvent());
     int idx = channel->index();
     assert(0 <= idx && idx < static_cast<int>(pollfds_.size()));
@@ -129,7 +126,7 @@ void PollPoller::removeChannel(Channel* channel)
         if (channelAtEnd < 0){             // 当前pollfd是已经被poll忽略的
             channelAtEnd = -channelAtEnd-1;  // 将其fd还原出来
         }
-        channels_[channelAtEnd]->set_index(idx); // 更新被交换元素对应channel中的下标
+        channels_.find(channelAtEnd)->set_index(idx); // 更新被交换元素对应channel中的下标
         pollfds_.pop_back();
     }
 }
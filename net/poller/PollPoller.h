@@ -25,6 +25,7 @@ namespace muduo{
             void updateChannel(Channel* channel) override;
             // 当通道被销毁时移除它
             void removeChannel(Channel* channel) override;
+            const char* name() const override { return "poll"; }
 
         private:
             // 把有IO事件的channel加入到activeChannels中, EventLoop统一处理
@@ -0,0 +1,157 @@
+//
+// Created by fight on 2023/7/15.
+//
+// 连接风暴：kClients个客户端线程各自不停地connect()，服务端在连接建立的回调中立即forceClose()，
+// 客户端读到EOF后再发起下一个连接。比较每秒建立的连接数：
+//   single    : baseLoop上一个Acceptor，连接再转给IO loop（默认）
+//   reuseport : 每个IO loop一个SO_REUSEPORT的Acceptor（TcpServer::setAcceptorPerLoop()），内核按hash分配
+//   bpf       : 同上，IO loop按物理核绑定，用BPF程序按收到连接的CPU分配
+//   batch     : 同single，每次可读事件最多accept kBatch个连接，成批交给IO loop（TcpServer::setMaxAcceptsPerEvent()）
+//   reuseport+batch : 同reuseport，每次可读事件最多accept kBatch个连接
+// 同时打印平均每次可读事件接受的连接数、交给IO loop的批数、监听队列溢出的增量和各个IO loop接受的连接数。
+#include "../../base/CountDownlatch.h"
+#include "../../base/Logging.h"
+#include "../../base/Thread.h"
+#include "../EventLoop.h"
+#include "../EventLoopThread.h"
+#include "../InetAddress.h"
+#include "../TcpServer.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kClients = 4;
+const double kSeconds = 2.0;
+const int kBatch = 64;
+
+std::atomic<bool> g_running(false);
+std::atomic<int64_t> g_connects(0);
+
+void clientThread(uint16_t port)
+{
+    sockaddr_in addr;
+    memZero(&addr, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    char buf[16];
+    while (g_running)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0)
+        {
+            while (::read(fd, buf, sizeof buf) > 0)
+            {
+            }
+            ++g_connects;
+        }
+        ::close(fd);
+    }
+}
+
+void run(EventLoop* baseLoop, uint16_t port, const char* mode)
+{
+    const string name(mode);
+    const bool batch = name.find("batch") != string::npos;
+    std::unique_ptr<TcpServer> server;
+    std::shared_ptr<std::map<EventLoop*, std::atomic<int64_t>>> perLoop(
+            std::make_shared<std::map<EventLoop*, std::atomic<int64_t>>>());
+    CountDownLatch started(1);
+    baseLoop->runInLoop([&]
+    {
+        server.reset(new TcpServer(baseLoop, InetAddress(port, true), "AcceptBench", TcpServer::kReusePort));
+        server->setThreadNum(2);
+        if (name == "reuseport" || name == "reuseport+batch")
+        {
+            server->setAcceptorPerLoop(true);
+        }
+        else if (name == "bpf")
+        {
+            server->setLoopPlacement(LoopPlacement::physicalCores());
+            server->setAcceptorPerLoop(true, TcpServer::kCpuBpf);
+        }
+        if (batch)
+        {
+            server->setMaxAcceptsPerEvent(kBatch);
+        }
+        // 连接回调在IO loop中执行，先把各loop的计数器建好，之后只读map
+        server->setThreadInitCallback([perLoop](EventLoop* loop) { (*perLoop)[loop] = 0; });
+        server->setConnectionCallback([perLoop](const TcpConnectionPtr& conn)
+                                      {
+                                          if (conn->connected())
+                                          {
+                                              ++(*perLoop)[conn->getLoop()];
+                                              conn->forceClose();
+                                          }
+                                      });
+        server->start();
+        started.countDown();
+    });
+    started.wait();
+    const TcpServer::AcceptStats before = server->acceptStats();
+
+    g_connects = 0;
+    g_running = true;
+    std::vector<std::unique_ptr<Thread>> clients;
+    for (int i = 0; i < kClients; ++i)
+    {
+        clients.emplace_back(new Thread(std::bind(clientThread, port), "client"));
+        clients.back()->start();
+    }
+    usleep(static_cast<useconds_t>(kSeconds * 1000 * 1000));
+    g_running = false;
+    for (auto& thread : clients)
+    {
+        thread->join();
+    }
+
+    const TcpServer::AcceptStats after = server->acceptStats();
+
+    CountDownLatch stopped(1);
+    baseLoop->runInLoop([&server, &stopped]
+    {
+        server.reset();
+        stopped.countDown();
+    });
+    stopped.wait();
+
+    const int64_t readEvents = after.readEvents - before.readEvents;
+    printf("%16s %10.0f %10.2f %10lld %10lld   ", mode, static_cast<double>(g_connects) / kSeconds,
+           readEvents > 0 ? static_cast<double>(after.accepted - before.accepted) / static_cast<double>(readEvents) : 0.0,
+           static_cast<long long>(after.handoffs - before.handoffs),
+           static_cast<long long>(after.listenOverflows - before.listenOverflows));
+    for (const auto& item : *perLoop)
+    {
+        printf(" %8lld", static_cast<long long>(item.second.load()));
+    }
+    printf("\n");
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    uint16_t port = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : 2034;
+
+    EventLoopThread baseThread;
+    EventLoop* baseLoop = baseThread.startLoop();
+
+    printf("%d client threads, 2 IO loops, %.0fs per run\n", kClients, kSeconds);
+    printf("%16s %10s %10s %10s %10s    %s\n", "mode", "conn/s", "per event", "handoffs", "overflows",
+           "accepted per loop");
+    run(baseLoop, port, "single");
+    run(baseLoop, port, "reuseport");
+    run(baseLoop, port, "bpf");
+    run(baseLoop, port, "batch");
+    run(baseLoop, port, "reuseport+batch");
+}
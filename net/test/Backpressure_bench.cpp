@@ -0,0 +1,174 @@
+//
+// Created by fight on 2023/7/16.
+//
+// 读背压：回显服务器，客户端一个线程不停地写，另一个线程慢慢地读（每次16KB，间隔kReadIntervalUs）。
+// 服务端读得比客户端收得快，回显的数据堆积在outputBuffer中：
+//   off : 默认，待发送数据一直增长
+//   on  : TcpServer::setReadBackpressure()，超过kHighMark暂停读取，降到kLowMark恢复，
+//         客户端写满内核缓冲区后阻塞，待发送数据保持在kHighMark附近
+// 比较待发送数据的峰值、回显的字节数、读取暂停的次数和累计时长。
+#include "../../base/CountDownlatch.h"
+#include "../../base/Logging.h"
+#include "../../base/Thread.h"
+#include "../EventLoop.h"
+#include "../EventLoopThread.h"
+#include "../EventLoopThreadPool.h"
+#include "../InetAddress.h"
+#include "../TcpServer.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <memory>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const double kSeconds = 2.0;
+const int kReadIntervalUs = 1000;
+const size_t kHighMark = 1024 * 1024;
+const size_t kLowMark = 256 * 1024;
+
+std::atomic<bool> g_running(false);
+
+size_t g_peakOutput = 0;            // 以下只在IO loop中访问
+int64_t g_echoed = 0;
+TcpConnectionPtr g_conn;
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+    g_conn = conn->connected() ? conn : TcpConnectionPtr();
+}
+
+void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+    g_echoed += static_cast<int64_t>(buf->readableBytes());
+    conn->send(buf);
+    g_peakOutput = std::max(g_peakOutput, conn->outputBytes());
+}
+
+void writerThread(int fd)
+{
+    char buf[64 * 1024];
+    memZero(buf, sizeof buf);
+    while (g_running)
+    {
+        if (::write(fd, buf, sizeof buf) < 0)
+        {
+            break;
+        }
+    }
+}
+
+void readerThread(int fd)
+{
+    char buf[16 * 1024];
+    while (::read(fd, buf, sizeof buf) > 0)
+    {
+        if (g_running)
+        {
+            usleep(kReadIntervalUs);
+        }
+    }
+}
+
+void run(EventLoop* baseLoop, uint16_t port, bool backpressure)
+{
+    std::unique_ptr<TcpServer> server;
+    CountDownLatch started(1);
+    baseLoop->runInLoop([&]
+    {
+        // 上一次的IO loop已经随server一起退出
+        g_peakOutput = 0;
+        g_echoed = 0;
+        server.reset(new TcpServer(baseLoop, InetAddress(port, true), "BackpressureBench", TcpServer::kReusePort));
+        server->setThreadNum(1);
+        if (backpressure)
+        {
+            server->setReadBackpressure(kHighMark, kLowMark);
+        }
+        server->setConnectionCallback(onConnection);
+        server->setMessageCallback(onMessage);
+        server->start();
+        started.countDown();
+    });
+    started.wait();
+
+    sockaddr_in addr;
+    memZero(&addr, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+    {
+        LOG_SYSFATAL << "connect";
+    }
+
+    g_running = true;
+    Thread writer(std::bind(writerThread, fd), "writer");
+    Thread reader(std::bind(readerThread, fd), "reader");
+    writer.start();
+    reader.start();
+    usleep(static_cast<useconds_t>(kSeconds * 1000 * 1000));
+    g_running = false;
+
+    // 在IO loop中读取统计，然后断开连接，阻塞在write()上的客户端线程随之返回
+    size_t peak = 0;
+    int64_t echoed = 0;
+    int64_t throttledCount = 0;
+    double throttledSeconds = 0.0;
+    CountDownLatch stopped(1);
+    baseLoop->runInLoop([&]
+    {
+        EventLoop* ioLoop = server->threadPool()->getNextLoop();
+        ioLoop->runInLoop([&]
+        {
+            peak = g_peakOutput;
+            echoed = g_echoed;
+            if (g_conn)
+            {
+                throttledCount = g_conn->throttledCount();
+                throttledSeconds = g_conn->throttledSeconds();
+                g_conn->forceClose();
+            }
+            stopped.countDown();
+        });
+    });
+    stopped.wait();
+    writer.join();
+    reader.join();
+    ::close(fd);
+
+    CountDownLatch destroyed(1);
+    baseLoop->runInLoop([&server, &destroyed]
+    {
+        server.reset();
+        destroyed.countDown();
+    });
+    destroyed.wait();
+
+    printf("%5s %14.1f %14.1f %10lld %12.3f\n", backpressure ? "on" : "off",
+           static_cast<double>(peak) / 1024, static_cast<double>(echoed) / 1024 / 1024,
+           static_cast<long long>(throttledCount), throttledSeconds);
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    uint16_t port = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : 2036;
+
+    EventLoopThread baseThread;
+    EventLoop* baseLoop = baseThread.startLoop();
+
+    printf("1 connection, reader sleeps %dus per 16KB, %.0fs per run, high %zuKB low %zuKB\n",
+           kReadIntervalUs, kSeconds, kHighMark / 1024, kLowMark / 1024);
+    printf("%5s %14s %14s %10s %12s\n", "mode", "peak out(KB)", "echoed(MB)", "throttles", "throttled(s)");
+    run(baseLoop, port, false);
+    run(baseLoop, port, true);
+}
@@ -0,0 +1,177 @@
+//
+// Created by fight on 2023/7/8.
+//
+// pub/sub扇出：发布线程把同一条消息发给分布在多个loop上的所有连接，
+// 比较send(StringPiece)（跨线程拷贝成string，再拷贝进outputBuffer_）和send(SharedMessage)（只增加引用计数）。
+// 客户端把接收缓冲区设得很小且从不读，消息都堆积在服务端的输出队列里。
+#include "../../base/CountDownlatch.h"
+#include "../../base/Logging.h"
+#include "../../base/Mutex.h"
+#include "../EventLoop.h"
+#include "../EventLoopThreadPool.h"
+#include "../InetAddress.h"
+#include "../SharedMessage.h"
+#include "../TcpServer.h"
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <thread>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kLoops = 4;
+const size_t kMessageSize = 4096;
+
+MutexLock g_mutex;
+std::vector<TcpConnectionPtr> g_connections GUARDED_BY(g_mutex);
+CountDownLatch* g_connected = NULL;
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+    if (conn->connected())
+    {
+        {
+            MutexLockGuard lock(g_mutex);
+            g_connections.push_back(conn);
+        }
+        g_connected->countDown();
+    }
+}
+
+long residentKB()
+{
+    long pages = 0;
+    long resident = 0;
+    FILE* fp = ::fopen("/proc/self/statm", "r");
+    if (fp)
+    {
+        if (::fscanf(fp, "%ld %ld", &pages, &resident) != 2)
+        {
+            resident = 0;
+        }
+        ::fclose(fp);
+    }
+    return resident * (::sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// 建立n个客户端连接，接收缓冲区设为4K且从不读，返回服务端对应的连接
+std::vector<TcpConnectionPtr> connectAll(int n, uint16_t port, std::vector<int>* clients)
+{
+    CountDownLatch connected(n);
+    g_connected = &connected;
+    clients->clear();
+    for (int i = 0; i < n; ++i)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        int rcvbuf = 4096;
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+        struct sockaddr_in sa;
+        memZero(&sa, sizeof sa);
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(port);
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd, reinterpret_cast<struct sockaddr*>(&sa), sizeof sa) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+        clients->push_back(fd);
+    }
+    connected.wait();
+
+    std::vector<TcpConnectionPtr> connections;
+    MutexLockGuard lock(g_mutex);
+    connections.swap(g_connections);
+    return connections;
+}
+
+// 等所有loop处理完之前排队的发送
+void flush(const std::vector<EventLoop*>& loops)
+{
+    CountDownLatch latch(static_cast<int>(loops.size()));
+    for (size_t i = 0; i < loops.size(); ++i)
+    {
+        loops[i]->queueInLoop(std::bind(&CountDownLatch::countDown, &latch));
+    }
+    latch.wait();
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    const int numConnections = argc > 1 ? atoi(argv[1]) : 1000;
+    const int numMessages = argc > 2 ? atoi(argv[2]) : 100;
+    const uint16_t port = 2023;
+
+    EventLoop loop;
+    InetAddress addr(port, true);
+    TcpServer server(&loop, addr, "BroadcastServer");
+    server.setConnectionCallback(onConnection);
+    server.setThreadNum(kLoops);
+    server.start();
+    std::vector<EventLoop*> loops = server.threadPool()->getAllLoops();
+
+    std::thread publisher([&]
+    {
+        std::vector<int> clients;
+        std::vector<TcpConnectionPtr> connections = connectAll(numConnections, port, &clients);
+        printf("%d connections on %d loops, %d messages of %zu bytes\n",
+               numConnections, kLoops, numMessages, kMessageSize);
+        printf("%8s %12s %12s %14s\n", "mode", "publish(s)", "flush(s)", "RSS growth(KB)");
+
+        string payload(kMessageSize, 'm');
+        // 先测shared，避免上一轮释放的内存让RSS的变化出现负数
+        for (int shared = 1; shared >= 0; --shared)
+        {
+            long rss = residentKB();
+            Timestamp start(Timestamp::now());
+            for (int m = 0; m < numMessages; ++m)
+            {
+                SharedMessage message(payload);
+                for (size_t i = 0; i < connections.size(); ++i)
+                {
+                    if (shared)
+                    {
+                        connections[i]->send(message);
+                    }
+                    else
+                    {
+                        connections[i]->send(payload);
+                    }
+                }
+            }
+            double publish = timeDifference(Timestamp::now(), start);
+            flush(loops);
+            double total = timeDifference(Timestamp::now(), start);
+            printf("%8s %12.3f %12.3f %14ld\n", shared ? "shared" : "copy",
+                   publish, total - publish, residentKB() - rss);
+
+            // 断开后重新开始下一轮，释放上一轮堆积的数据。
+            // 等服务端的连接都销毁后再关闭客户端，否则带着未读数据关闭会给服务端发RST
+            for (size_t i = 0; i < connections.size(); ++i)
+            {
+                connections[i]->forceClose();
+            }
+            connections.clear();
+            flush(loops);
+            flush(std::vector<EventLoop*>(1, &loop));
+            flush(loops);
+            for (size_t i = 0; i < clients.size(); ++i)
+            {
+                ::close(clients[i]);
+            }
+            if (shared == 1)
+            {
+                connections = connectAll(numConnections, port, &clients);
+            }
+        }
+        loop.queueInLoop(std::bind(&EventLoop::quit, &loop));
+    });
+    loop.loop();
+    publisher.join();
+}
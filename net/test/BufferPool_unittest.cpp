@@ -0,0 +1,135 @@
+//
+// Created by fight on 2023/7/6.
+//
+
+#include "../Buffer.h"
+#include "../BufferPool.h"
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using muduo::net::Buffer;
+using muduo::net::BufferPool;
+
+BOOST_AUTO_TEST_CASE(testBufferPoolBorrowGiveBack)
+{
+    BufferPool pool;
+    Buffer buf;
+    pool.giveBack(&buf);
+    BOOST_CHECK(BufferPool::isHusk(buf));
+    BOOST_CHECK_EQUAL(buf.writableBytes(), 0);
+    BOOST_CHECK_EQUAL(pool.storagesHeld(), 1);
+    BOOST_CHECK_EQUAL(pool.bytesHeld(), Buffer::kCheapPrepend + Buffer::kInitialSize);
+
+    // 空壳也能正常使用，只是需要自己分配
+    Buffer other;
+    pool.giveBack(&other);
+    other.append("hello");
+    BOOST_CHECK_EQUAL(other.retrieveAllAsString(), string("hello"));
+
+    pool.borrow(&buf);
+    BOOST_CHECK_EQUAL(pool.hits(), 1);
+    BOOST_CHECK_EQUAL(pool.storagesHeld(), 1);
+    BOOST_CHECK_EQUAL(buf.writableBytes(), Buffer::kInitialSize);
+
+    // 有数据时不会换存储
+    buf.append(string(5000, 'x'));
+    pool.giveBack(&buf);
+    BOOST_CHECK_EQUAL(pool.storagesHeld(), 1);
+    buf.retrieveAll();
+    pool.giveBack(&buf);
+    BOOST_CHECK_EQUAL(pool.storagesHeld(), 2);
+    BOOST_CHECK(pool.bytesHeld() >= 5000);
+
+    // 先借到的是最近归还的、已经长大的存储
+    pool.borrow(&buf);
+    BOOST_CHECK(buf.writableBytes() >= 5000);
+    pool.borrow(&other);
+    BOOST_CHECK_EQUAL(pool.hits(), 2);   // other已经自己分配了存储，不需要借
+    Buffer third;
+    pool.giveBack(&third);
+    pool.borrow(&third);
+    pool.borrow(&third);
+    BOOST_CHECK_EQUAL(pool.hits(), 3);
+    BOOST_CHECK_EQUAL(pool.misses(), 0);
+}
+
+// 借出的存储还有数据时buf被销毁（连接带着没处理完的数据关闭），forget()丢掉为它留的空壳
+BOOST_AUTO_TEST_CASE(testBufferPoolForget)
+{
+    BufferPool pool;
+    for (int i = 0; i < 100; ++i)
+    {
+        Buffer buf;
+        pool.giveBack(&buf);
+        pool.borrow(&buf);
+        BOOST_CHECK_EQUAL(pool.husksHeld(), 1);
+        buf.append("partial");
+        pool.giveBack(&buf);
+        pool.forget(buf);
+        BOOST_CHECK_EQUAL(pool.husksHeld(), 0);
+    }
+
+    // 空壳或已经还回来的buf不受影响
+    Buffer a;
+    Buffer b;
+    pool.giveBack(&a);
+    pool.giveBack(&b);
+    pool.borrow(&a);
+    pool.borrow(&b);
+    BOOST_CHECK_EQUAL(pool.husksHeld(), 2);
+    pool.giveBack(&a);
+    pool.forget(a);
+    BOOST_CHECK_EQUAL(pool.husksHeld(), 1);
+    pool.giveBack(&b);
+    BOOST_CHECK_EQUAL(pool.husksHeld(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testBufferPoolLimits)
+{
+    BufferPool pool(4096, 2048);
+    Buffer big;
+    big.ensureWritableBytes(10000);
+    pool.giveBack(&big);
+    BOOST_CHECK(BufferPool::isHusk(big));
+    BOOST_CHECK_EQUAL(pool.storagesHeld(), 0);  // 超过maxStorageSize直接释放
+
+    Buffer bufs[5];
+    for (int i = 0; i < 5; ++i)
+    {
+        pool.giveBack(&bufs[i]);
+    }
+    BOOST_CHECK_EQUAL(pool.storagesHeld(), 3);  // 总量不超过maxBytesHeld
+    pool.borrow(&big);
+    BOOST_CHECK_EQUAL(pool.hits(), 1);
+    pool.borrow(&bufs[0]);
+    pool.borrow(&bufs[1]);
+    pool.borrow(&bufs[2]);
+    BOOST_CHECK_EQUAL(pool.hits(), 3);
+    BOOST_CHECK_EQUAL(pool.misses(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testBufferPoolTrim)
+{
+    BufferPool pool;
+    Buffer bufs[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        pool.giveBack(&bufs[i]);
+    }
+    pool.trim();  // 第一个周期的lowWater_为0，什么都不释放
+    BOOST_CHECK_EQUAL(pool.storagesHeld(), 4);
+
+    // 这个周期只用到了一块存储，剩下的3块一直空闲
+    pool.borrow(&bufs[0]);
+    pool.giveBack(&bufs[0]);
+    pool.trim();
+    BOOST_CHECK_EQUAL(pool.storagesHeld(), 1);
+    BOOST_CHECK_EQUAL(pool.trimmedBytes(), 3 * (Buffer::kCheapPrepend + Buffer::kInitialSize));
+
+    pool.trim();
+    BOOST_CHECK_EQUAL(pool.storagesHeld(), 0);
+    BOOST_CHECK_EQUAL(pool.bytesHeld(), 0);
+}
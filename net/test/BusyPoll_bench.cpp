@@ -0,0 +1,185 @@
+//
+// Created by fight on 2023/7/13.
+//
+// 服务端loop在单独的线程中，打开/关闭忙轮询（EventLoop::setBusyPoll()），客户端在主线程的loop中：
+//   pingpong : 一个连接收到应答立即发下一条，比较往返延迟
+//   paced    : 每隔kPaceMs毫秒才发一条，事件稀疏时自适应窗口应该缩小，空转时间占比下降
+// 打印服务端loop的空转/阻塞/处理事件的时间占比和结束时的空转窗口。
+// 注意忙轮询要有空闲的CPU核才有意义，单核机器上空转会和客户端线程抢CPU。
+#include "../../base/CountDownlatch.h"
+#include "../../base/Logging.h"
+#include "../EventLoop.h"
+#include "../EventLoopThread.h"
+#include "../InetAddress.h"
+#include "../TcpClient.h"
+#include "../TcpServer.h"
+
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t kMessageSize = 64;
+const double kSeconds = 2.0;
+const double kPaceMs = 2.0;
+
+bool g_running = false;
+bool g_paced = false;
+int64_t g_rounds = 0;
+int64_t g_rttMicroseconds = 0;
+Timestamp g_sent;
+string g_message(kMessageSize, 'b');
+
+struct LoopTimes
+{
+    int64_t spin;
+    int64_t sleep;
+    int64_t dispatch;
+    int64_t hits;
+    int64_t misses;
+    int64_t window;
+};
+
+// 服务端的统计只在它的loop线程中修改，到那个线程中去读
+LoopTimes snapshot(EventLoop* loop)
+{
+    LoopTimes times;
+    CountDownLatch latch(1);
+    loop->runInLoop([loop, &times, &latch]
+                    {
+                        times.spin = loop->spinMicroseconds();
+                        times.sleep = loop->sleepMicroseconds();
+                        times.dispatch = loop->dispatchMicroseconds();
+                        times.hits = loop->busyPollHits();
+                        times.misses = loop->busyPollMisses();
+                        times.window = loop->busyPollWindow();
+                        latch.countDown();
+                    });
+    latch.wait();
+    return times;
+}
+
+void sendRequest(const TcpConnectionPtr& conn)
+{
+    g_sent = Timestamp::now();
+    conn->send(g_message);
+}
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true);
+        sendRequest(conn);
+    }
+}
+
+void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime)
+{
+    while (buf->readableBytes() >= kMessageSize)
+    {
+        buf->retrieve(kMessageSize);
+        if (g_running)
+        {
+            ++g_rounds;
+            g_rttMicroseconds += receiveTime.microSecondsSinceEpoch() - g_sent.microSecondsSinceEpoch();
+            if (g_paced)
+            {
+                TcpConnectionPtr c(conn);
+                conn->getLoop()->runAfter(kPaceMs / 1000, [c] { sendRequest(c); });
+            }
+            else
+            {
+                sendRequest(conn);
+            }
+        }
+    }
+}
+
+void run(EventLoop* serverLoop, const InetAddress& addr, bool paced, int64_t busyPollUs)
+{
+    serverLoop->runInLoop([serverLoop, busyPollUs] { serverLoop->setBusyPoll(busyPollUs); });
+    const LoopTimes before = snapshot(serverLoop);
+
+    EventLoop loop;
+    g_paced = paced;
+    g_rounds = 0;
+    g_rttMicroseconds = 0;
+    g_running = true;
+    TcpClient client(&loop, addr, "BusyPollClient");
+    client.setConnectionCallback(onClientConnection);
+    client.setMessageCallback(onClientMessage);
+    client.connect();
+    loop.runAfter(kSeconds, [] { g_running = false; });
+    loop.runAfter(kSeconds + 0.1, [&client] { client.disconnect(); });
+    loop.runAfter(kSeconds + 0.2, std::bind(&EventLoop::quit, &loop));
+    loop.loop();
+
+    const LoopTimes after = snapshot(serverLoop);
+    const double total = static_cast<double>((after.spin - before.spin) + (after.sleep - before.sleep) +
+                                             (after.dispatch - before.dispatch));
+    printf("%9s %8lld %10.0f %10.1f %7.1f%% %7.1f%% %9.1f%% %8lld %8lld %8lld\n",
+           paced ? "paced" : "pingpong", static_cast<long long>(busyPollUs),
+           static_cast<double>(g_rounds) / kSeconds,
+           g_rounds > 0 ? static_cast<double>(g_rttMicroseconds) / static_cast<double>(g_rounds) : 0.0,
+           total > 0 ? 100.0 * static_cast<double>(after.spin - before.spin) / total : 0.0,
+           total > 0 ? 100.0 * static_cast<double>(after.sleep - before.sleep) / total : 0.0,
+           total > 0 ? 100.0 * static_cast<double>(after.dispatch - before.dispatch) / total : 0.0,
+           static_cast<long long>(after.hits - before.hits),
+           static_cast<long long>(after.misses - before.misses),
+           static_cast<long long>(after.window));
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    uint16_t port = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : 2033;
+    InetAddress addr(port, true);
+
+    EventLoopThread serverThread;
+    EventLoop* serverLoop = serverThread.startLoop();
+    // TcpServer只能在它的loop线程中析构，在那个线程中创建和销毁
+    std::unique_ptr<TcpServer> server;
+    CountDownLatch started(1);
+    serverLoop->runInLoop([serverLoop, &addr, &server, &started]
+    {
+        server.reset(new TcpServer(serverLoop, addr, "BusyPollServer"));
+        server->setConnectionCallback([](const TcpConnectionPtr& conn)
+                                      {
+                                          if (conn->connected())
+                                          {
+                                              conn->setTcpNoDelay(true);
+                                          }
+                                      });
+        server->setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+                                   {
+                                       conn->send(buf);
+                                   });
+        server->start();
+        started.countDown();
+    });
+    started.wait();
+
+    printf("1 connection, %zu-byte messages, %.0fs per run, paced = one request every %.0fms\n",
+           kMessageSize, kSeconds, kPaceMs);
+    printf("%9s %8s %10s %10s %8s %8s %10s %8s %8s %8s\n",
+           "workload", "busy(us)", "rounds/s", "rtt(us)", "spin", "sleep", "dispatch", "hits", "misses", "window");
+    const int64_t busyPolls[] = { 0, 50, 500 };
+    for (int paced = 0; paced < 2; ++paced)
+    {
+        for (size_t i = 0; i < sizeof busyPolls / sizeof busyPolls[0]; ++i)
+        {
+            run(serverLoop, addr, paced != 0, busyPolls[i]);
+        }
+    }
+    CountDownLatch stopped(1);
+    serverLoop->runInLoop([serverLoop, &server, &stopped]
+    {
+        serverLoop->setBusyPoll(0);
+        server.reset();
+        stopped.countDown();
+    });
+    stopped.wait();
+}
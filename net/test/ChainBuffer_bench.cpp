@@ -0,0 +1,64 @@
+//
+// Created by fight on 2023/7/2.
+//
+// 模拟代理的输出缓冲：不断追加小消息，socket每次只接受一部分数据，
+// 比较Buffer(vector)和ChainBuffer(slab链表)在数MB在途数据下的开销。
+#include "../Buffer.h"
+#include "../ChainBuffer.h"
+#include "../../base/Timestamp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t kMessageSize = 4096;      // 每次send的消息大小
+const size_t kWriteSize = 48 * 1024;   // 每次可写事件socket接受的字节数
+const size_t kTotal = 4096UL * 1024 * 1024;  // 总共发送的字节数
+
+template<typename BUFFER>
+double benchOutput(BUFFER& buf, size_t inflight, size_t* maxCapacity)
+{
+    string message(kMessageSize, 'x');
+    size_t sent = 0;
+    *maxCapacity = 0;
+    Timestamp start(Timestamp::now());
+    while (sent < kTotal)
+    {
+        // 上游读到的数据持续追加，直到在途数据达到inflight
+        while (buf.readableBytes() < inflight)
+        {
+            buf.append(message.data(), message.size());
+        }
+        if (buf.internalCapacity() > *maxCapacity)
+        {
+            *maxCapacity = buf.internalCapacity();
+        }
+        // 下游很慢，一次只能写出一部分
+        size_t n = std::min(kWriteSize, buf.readableBytes());
+        buf.retrieve(n);
+        sent += n;
+    }
+    return timeDifference(Timestamp::now(), start);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t slabSize = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : ChainBuffer::kDefaultSlabSize;
+    printf("message %zu bytes, write %zu bytes per event, total %zu MB, slab %zu bytes\n",
+           kMessageSize, kWriteSize, kTotal / 1024 / 1024, slabSize);
+    printf("%10s %14s %14s %14s %14s\n", "inflight", "Buffer(s)", "Chain(s)", "Buffer cap", "Chain cap");
+
+    for (size_t inflight = 64 * 1024; inflight <= 4 * 1024 * 1024; inflight *= 2)
+    {
+        size_t bufferCap = 0;
+        size_t chainCap = 0;
+        Buffer buffer;
+        double t1 = benchOutput(buffer, inflight, &bufferCap);
+        ChainBuffer chain(slabSize);
+        double t2 = benchOutput(chain, inflight, &chainCap);
+        printf("%9zuK %14.3f %14.3f %14zu %14zu\n",
+               inflight / 1024, t1, t2, bufferCap, chainCap);
+    }
+}
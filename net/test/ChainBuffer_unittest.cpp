@@ -0,0 +1,187 @@
+//
+// Created by fight on 2023/7/2.
+//
+
+#include "../ChainBuffer.h"
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+using muduo::string;
+using muduo::net::ChainBuffer;
+
+BOOST_AUTO_TEST_CASE(testChainBufferAppendRetrieve)
+{
+    ChainBuffer buf(64);
+    BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+    BOOST_CHECK(buf.peek() == NULL);
+
+    const string str(200, 'x');
+    buf.append(str);
+    BOOST_CHECK_EQUAL(buf.readableBytes(), str.size());
+    BOOST_CHECK_EQUAL(buf.numSlabs(), 4);
+    // 第一个slab预留了kCheapPrepend
+    BOOST_CHECK_EQUAL(buf.peekableBytes(), 64 - ChainBuffer::kCheapPrepend);
+
+    buf.retrieve(60);
+    BOOST_CHECK_EQUAL(buf.readableBytes(), str.size() - 60);
+    BOOST_CHECK_EQUAL(buf.numSlabs(), 3);
+
+    const string str2 = buf.retrieveAsString(100);
+    BOOST_CHECK_EQUAL(str2, string(100, 'x'));
+    BOOST_CHECK_EQUAL(buf.readableBytes(), str.size() - 160);
+
+    buf.retrieveAll();
+    BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+    BOOST_CHECK_EQUAL(buf.numSlabs(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferOrder)
+{
+    ChainBuffer buf(64);
+    string all;
+    for (int i = 0; i < 100; ++i)
+    {
+        string piece(static_cast<size_t>(i % 17 + 1), static_cast<char>('a' + i % 26));
+        buf.append(piece);
+        all += piece;
+    }
+    BOOST_CHECK_EQUAL(buf.readableBytes(), all.size());
+
+    struct iovec vec[64];
+    int n = buf.fillIovec(vec, 64);
+    string gathered;
+    for (int i = 0; i < n; ++i)
+    {
+        gathered.append(static_cast<const char*>(vec[i].iov_base), vec[i].iov_len);
+    }
+    BOOST_CHECK_EQUAL(gathered, all);
+    BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), all);
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferPrepend)
+{
+    ChainBuffer buf(64);
+    buf.append("body");
+    buf.prependInt32(4);
+    BOOST_CHECK_EQUAL(buf.readableBytes(), 8);
+    BOOST_CHECK_EQUAL(buf.numSlabs(), 1);
+    BOOST_CHECK_EQUAL(buf.peekInt32(), 4);
+
+    // 头部空间不够时插入新的slab，已有数据不动
+    const char* body = buf.peek() + 4;
+    const string header(100, 'h');
+    buf.prepend(header.data(), header.size());
+    BOOST_CHECK_EQUAL(buf.readableBytes(), 108);
+    BOOST_CHECK_EQUAL(buf.retrieveAsString(100), header);
+    BOOST_CHECK_EQUAL(buf.peekInt32(), 4);
+    BOOST_CHECK(buf.peek() + 4 == body);
+    buf.retrieve(4);
+    BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), string("body"));
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferReadWriteFd)
+{
+    int fds[2];
+    BOOST_REQUIRE(::pipe(fds) == 0);
+
+    ChainBuffer out(1024);
+    string all;
+    for (int i = 0; i < 40; ++i)
+    {
+        string piece(100, static_cast<char>('0' + i % 10));
+        out.append(piece);
+        all += piece;
+    }
+    int savedErrno = 0;
+    ssize_t n = out.writeFd(fds[1], &savedErrno);
+    BOOST_CHECK_EQUAL(n, static_cast<ssize_t>(all.size()));
+    BOOST_CHECK_EQUAL(out.readableBytes(), 0);
+
+    ChainBuffer in(1024);
+    in.append("prefix");
+    n = in.readFd(fds[0], &savedErrno);
+    BOOST_CHECK_EQUAL(n, static_cast<ssize_t>(all.size()));
+    BOOST_CHECK_EQUAL(in.retrieveAllAsString(), "prefix" + all);
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferExternal)
+{
+    ChainBuffer buf(64);
+    std::shared_ptr<string> payload(new string(1000, 'p'));
+    buf.append("head");
+    buf.appendExternal(payload->data(), payload->size(), payload);
+    buf.append("tail");
+    BOOST_CHECK_EQUAL(buf.readableBytes(), 1008);
+    BOOST_CHECK_EQUAL(payload.use_count(), 2);
+
+    struct iovec vec[8];
+    BOOST_CHECK_EQUAL(buf.fillIovec(vec, 8), 3);
+    BOOST_CHECK(vec[1].iov_base == payload->data());
+
+    // 外部节点只读，prepend()不会写进外部内存
+    buf.retrieve(4 + 10);
+    buf.prepend("xx", 2);
+    BOOST_CHECK_EQUAL(*payload, string(1000, 'p'));
+    BOOST_CHECK_EQUAL(buf.retrieveAsString(2), string("xx"));
+
+    buf.retrieve(990);
+    BOOST_CHECK_EQUAL(payload.use_count(), 1);
+    BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), string("tail"));
+
+    const string big(100, 'b');
+    buf.appendBlock(big.data(), big.size());
+    BOOST_CHECK_EQUAL(buf.numSlabs(), 1);
+    BOOST_CHECK_EQUAL(buf.peekableBytes(), 100);
+    BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), big);
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferFile)
+{
+    char name[] = "/tmp/chainbuffer_unittest_XXXXXX";
+    int filefd = ::mkstemp(name);
+    BOOST_REQUIRE(filefd >= 0);
+    ::unlink(name);
+    const string content("0123456789abcdefghij");
+    BOOST_REQUIRE(::write(filefd, content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+    std::shared_ptr<string> owner(new string);
+
+    ChainBuffer buf(64);
+    buf.append("head-");
+    buf.appendFile(filefd, 10, 10, owner);
+    buf.append("-tail");
+    BOOST_CHECK_EQUAL(buf.readableBytes(), 20);
+
+    // fillIovec()在文件节点前停止
+    struct iovec vec[8];
+    BOOST_CHECK_EQUAL(buf.fillIovec(vec, 8), 1);
+    off_t offset = 0;
+    size_t len = 0;
+    BOOST_CHECK_EQUAL(buf.peekFile(&offset, &len), -1);
+
+    int fds[2];
+    BOOST_REQUIRE(::pipe(fds) == 0);
+    int savedErrno = 0;
+    string got;
+    char tmp[64];
+    while (buf.readableBytes() > 0)
+    {
+        ssize_t n = buf.writeFd(fds[1], &savedErrno);
+        BOOST_REQUIRE(n > 0);
+        n = ::read(fds[0], tmp, sizeof tmp);
+        got.append(tmp, n);
+    }
+    BOOST_CHECK_EQUAL(got, string("head-abcdefghij-tail"));
+    BOOST_CHECK_EQUAL(owner.use_count(), 1);
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+    ::close(filefd);
+}
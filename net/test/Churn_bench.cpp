@@ -0,0 +1,155 @@
+//
+// Created by fight on 2023/7/16.
+//
+// 连接churn：kClients个客户端线程各自不停地connect()，服务端在连接建立的回调中立即forceClose()，
+// 客户端读到EOF后再发起下一个连接。比较每秒建立的连接数，以及平均每个连接的生命周期中operator new的次数：
+//   default : 每个连接单独new TcpConnection（默认）
+//   pooled  : TcpServer::setConnectionPooling()，连接对象从所属loop的ConnectionPool分配
+// 客户端只用系统调用，不经过operator new，计数基本都来自服务端。
+#include "../../base/CountDownlatch.h"
+#include "../../base/Logging.h"
+#include "../../base/Thread.h"
+#include "../EventLoop.h"
+#include "../EventLoopThread.h"
+#include "../InetAddress.h"
+#include "../TcpServer.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <memory>
+#include <netinet/in.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kClients = 4;
+const double kSeconds = 2.0;
+
+std::atomic<int64_t> g_allocations(0);
+std::atomic<bool> g_running(false);
+std::atomic<int64_t> g_connects(0);
+
+void* operator new(size_t size)
+{
+    ++g_allocations;
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+void clientThread(uint16_t port)
+{
+    sockaddr_in addr;
+    memZero(&addr, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    char buf[16];
+    while (g_running)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0)
+        {
+            while (::read(fd, buf, sizeof buf) > 0)
+            {
+            }
+            ++g_connects;
+        }
+        ::close(fd);
+    }
+}
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+    if (conn->connected())
+    {
+        conn->forceClose();
+    }
+}
+
+void run(EventLoop* baseLoop, uint16_t port, bool pooled)
+{
+    std::unique_ptr<TcpServer> server;
+    CountDownLatch started(1);
+    baseLoop->runInLoop([&]
+    {
+        server.reset(new TcpServer(baseLoop, InetAddress(port, true), "ChurnBench", TcpServer::kReusePort));
+        server->setThreadNum(1);
+        server->setConnectionPooling(pooled);
+        server->setConnectionCallback(onConnection);
+        server->start();
+        started.countDown();
+    });
+    started.wait();
+
+    // 预热：池中放进足够的连接对象，loop的各种容器也长到稳定的大小
+    std::vector<std::unique_ptr<Thread>> clients;
+    for (int round = 0; round < 2; ++round)
+    {
+        if (round == 1)
+        {
+            g_allocations = 0;
+        }
+        g_connects = 0;
+        g_running = true;
+        for (int i = 0; i < kClients; ++i)
+        {
+            clients.emplace_back(new Thread(std::bind(clientThread, port), "client"));
+            clients.back()->start();
+        }
+        usleep(static_cast<useconds_t>((round == 0 ? 0.5 : kSeconds) * 1000 * 1000));
+        g_running = false;
+        for (auto& thread : clients)
+        {
+            thread->join();
+        }
+        clients.clear();
+    }
+    // 客户端线程本身的分配，不算在连接上
+    const int64_t allocations = g_allocations - kClients * 2;
+    const int64_t connects = g_connects;
+
+    CountDownLatch stopped(1);
+    baseLoop->runInLoop([&server, &stopped]
+    {
+        server.reset();
+        stopped.countDown();
+    });
+    stopped.wait();
+
+    printf("%10s %12.0f %12.2f\n", pooled ? "pooled" : "default", static_cast<double>(connects) / kSeconds,
+           connects > 0 ? static_cast<double>(allocations) / static_cast<double>(connects) : 0.0);
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    uint16_t port = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : 2035;
+
+    EventLoopThread baseThread;
+    EventLoop* baseLoop = baseThread.startLoop();
+
+    printf("%d client threads, 1 IO loop, %.0fs per run\n", kClients, kSeconds);
+    printf("%10s %12s %12s\n", "mode", "conn/s", "news/conn");
+    run(baseLoop, port, false);
+    run(baseLoop, port, true);
+}
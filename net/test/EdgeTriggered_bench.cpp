@@ -0,0 +1,110 @@
+//
+// Created by fight on 2023/7/10.
+//
+// 请求/应答式echo：客户端发出一条消息，服务端原样发回，客户端收全后再发下一条。
+// 比较水平触发（LT）和边沿触发（ET）下每个请求平均的epoll_ctl次数和吞吐量。
+// 消息大于socket发送缓冲区时LT每个请求都要开关一次可写事件，ET只在连接建立/关闭时注册和删除；
+// ET每次可读事件都读到socket读空，大消息的吞吐量也会不同（LT默认每次事件只readv一次）。
+// 服务端和客户端在同一个loop中，统计的是两端合计的epoll_ctl次数。
+#include "../../base/Logging.h"
+#include "../EventLoop.h"
+#include "../InetAddress.h"
+#include "../TcpClient.h"
+#include "../TcpServer.h"
+
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kClients = 8;
+const double kSeconds = 2.0;
+
+bool g_edgeTriggered = false;
+bool g_running = false;
+int64_t g_rounds = 0;
+string g_message;
+
+void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+    conn->send(buf);
+}
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true);
+        conn->setEdgeTriggered(g_edgeTriggered);
+        conn->send(g_message);
+    }
+}
+
+void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+    while (buf->readableBytes() >= g_message.size())
+    {
+        buf->retrieve(g_message.size());
+        if (g_running)
+        {
+            ++g_rounds;
+            conn->send(g_message);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    uint16_t port = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : 2031;
+    EventLoop loop;
+    if (!loop.supportsEdgeTriggered())
+    {
+        printf("poller does not support EPOLLET (MUDUO_USE_POLL is set?)\n");
+        return 1;
+    }
+    InetAddress addr(port, true);
+
+    printf("%d clients echoing over loopback, %.0fs per run\n", kClients, kSeconds);
+    printf("%10s %6s %12s %12s %14s\n", "bytes", "mode", "requests/s", "epoll_ctl", "ctl/request");
+    const size_t sizes[] = { 256, 64 * 1024, 1024 * 1024, 8 * 1024 * 1024 };
+    for (size_t s = 0; s < sizeof sizes / sizeof sizes[0]; ++s)
+    {
+        for (int et = 0; et < 2; ++et)
+        {
+            g_message.assign(sizes[s], 'e');
+            g_edgeTriggered = et != 0;
+            g_rounds = 0;
+            g_running = true;
+
+            TcpServer server(&loop, addr, "EdgeTriggeredServer");
+            server.setMessageCallback(onServerMessage);
+            server.setEdgeTriggered(g_edgeTriggered);
+            server.start();
+
+            const int64_t ctl0 = loop.pollerCtlCalls();
+            std::vector<std::unique_ptr<TcpClient>> clients;
+            for (int i = 0; i < kClients; ++i)
+            {
+                clients.emplace_back(new TcpClient(&loop, addr, "EdgeTriggeredClient"));
+                clients.back()->setConnectionCallback(onClientConnection);
+                clients.back()->setMessageCallback(onClientMessage);
+                clients.back()->connect();
+            }
+            // 停止发起新的请求，等在途的应答收完再在loop中断开，避免带着未读数据关闭
+            loop.runAfter(kSeconds, [] { g_running = false; });
+            loop.runAfter(kSeconds + 0.2, [&clients] { clients.clear(); });
+            loop.runAfter(kSeconds + 0.3, std::bind(&EventLoop::quit, &loop));
+            loop.loop();
+
+            const int64_t ctl = loop.pollerCtlCalls() - ctl0;
+            printf("%10zu %6s %12.0f %12lld %14.3f\n",
+                   sizes[s], et ? "ET" : "LT",
+                   static_cast<double>(g_rounds) / kSeconds,
+                   static_cast<long long>(ctl),
+                   g_rounds > 0 ? static_cast<double>(ctl) / static_cast<double>(g_rounds) : 0.0);
+        }
+    }
+}
@@ -66,6 +66,42 @@ int main()
         assert(nextLoop == model.getNextLoop());
     }
 
+    {
+        printf("Dispatch policies:\n");
+        EventLoopThreadPool model(&loop, "dispatch");
+        model.setThreadNum(3);
+        model.start(init);
+        std::vector<EventLoop*> loops = model.getAllLoops();
+        // 第一个loop被一个长回调占住，后面排着的回调都还没执行
+        loops[0]->runInLoop([] { ::usleep(300 * 1000); });
+        for (int i = 0; i < 100; ++i)
+        {
+            loops[0]->queueInLoop([] { });
+        }
+        model.setDispatchPolicy(EventLoopThreadPool::kShortestQueue);
+        for (int i = 0; i < 10; ++i)
+        {
+            assert(model.getNextLoop() != loops[0]);
+        }
+        model.setDispatchFunction([](const std::vector<EventLoop*>& all) { return all.back(); });
+        assert(model.getNextLoop() == loops.back());
+        model.setDispatchFunction(EventLoopThreadPool::DispatchFunction());
+        model.setDispatchPolicy(EventLoopThreadPool::kPowerOfTwoChoices);
+        for (int i = 0; i < 10; ++i)
+        {
+            assert(model.getNextLoop() != &loop);
+        }
+
+        ::usleep(400 * 1000);
+        std::vector<LoopLoad> loads = model.loads();
+        for (const LoopLoad& load : loads)
+        {
+            printf("loop = %p, connections = %d, queued = %zu, busy = %.2f\n",
+                   load.loop, load.connections, load.queued, load.busyRatio);
+        }
+        assert(loads[0].busyRatio > loads[1].busyRatio);
+    }
+
     loop.loop();
 }
 
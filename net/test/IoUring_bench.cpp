@@ -0,0 +1,122 @@
+//
+// Created by fight on 2023/7/12.
+//
+// 请求/应答式echo：客户端发出一条消息，服务端原样发回，客户端收全后再发下一条。
+// 比较epoll和io_uring（MUDUO_USE_IO_URING）两种Poller的吞吐量，以及单独提交注册修改的系统调用次数：
+// epoll每次epoll_ctl都是一次系统调用，io_uring的注册修改和等待合并在一次io_uring_enter()中，
+// 只有删除channel和提交队列满时才单独提交。
+// 每次运行新建一个EventLoop，服务端和客户端在同一个loop中。
+#include "../../base/Logging.h"
+#include "../EventLoop.h"
+#include "../InetAddress.h"
+#include "../TcpClient.h"
+#include "../TcpServer.h"
+
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kClients = 16;
+const double kSeconds = 2.0;
+
+bool g_running = false;
+int64_t g_rounds = 0;
+string g_message;
+
+void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+    conn->send(buf);
+}
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true);
+        conn->send(g_message);
+    }
+}
+
+void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+    while (buf->readableBytes() >= g_message.size())
+    {
+        buf->retrieve(g_message.size());
+        if (g_running)
+        {
+            ++g_rounds;
+            conn->send(g_message);
+        }
+    }
+}
+
+void run(const InetAddress& addr, bool ioUring, size_t bytes)
+{
+    if (ioUring)
+    {
+        ::setenv("MUDUO_USE_IO_URING", "1", 1);
+    }
+    else
+    {
+        ::unsetenv("MUDUO_USE_IO_URING");
+    }
+    EventLoop loop;
+    if (ioUring && string(loop.pollerName()) != "io_uring")
+    {
+        printf("%10zu %9s %12s\n", bytes, "io_uring", "unavailable");
+        return;
+    }
+    g_message.assign(bytes, 'u');
+    g_rounds = 0;
+    g_running = true;
+
+    TcpServer server(&loop, addr, "IoUringServer");
+    server.setConnectionCallback([](const TcpConnectionPtr& conn)
+                                 {
+                                     if (conn->connected())
+                                     {
+                                         conn->setTcpNoDelay(true);
+                                     }
+                                 });
+    server.setMessageCallback(onServerMessage);
+    server.start();
+
+    const int64_t ctl0 = loop.pollerCtlCalls();
+    std::vector<std::unique_ptr<TcpClient>> clients;
+    for (int i = 0; i < kClients; ++i)
+    {
+        clients.emplace_back(new TcpClient(&loop, addr, "IoUringClient"));
+        clients.back()->setConnectionCallback(onClientConnection);
+        clients.back()->setMessageCallback(onClientMessage);
+        clients.back()->connect();
+    }
+    // 停止发起新的请求，等在途的应答收完再在loop中断开，避免带着未读数据关闭
+    loop.runAfter(kSeconds, [] { g_running = false; });
+    loop.runAfter(kSeconds + 0.2, [&clients] { clients.clear(); });
+    loop.runAfter(kSeconds + 0.3, std::bind(&EventLoop::quit, &loop));
+    loop.loop();
+
+    const double rounds = static_cast<double>(g_rounds) / kSeconds;
+    printf("%10zu %9s %12.0f %10.1f %12lld\n", bytes, loop.pollerName(), rounds,
+           rounds * static_cast<double>(bytes) * 2 / 1024 / 1024,
+           static_cast<long long>(loop.pollerCtlCalls() - ctl0));
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    uint16_t port = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : 2032;
+    InetAddress addr(port, true);
+
+    printf("%d clients echoing over loopback, %.0fs per run\n", kClients, kSeconds);
+    printf("%10s %9s %12s %10s %12s\n", "bytes", "poller", "rounds/s", "MiB/s", "ctl calls");
+    const size_t sizes[] = { 64, 4096, 64 * 1024 };
+    for (size_t s = 0; s < sizeof sizes / sizeof sizes[0]; ++s)
+    {
+        run(addr, false, sizes[s]);
+        run(addr, true, sizes[s]);
+    }
+}
@@ -0,0 +1,105 @@
+//
+// Created by fight on 2023/7/15.
+//
+
+#include "../LoopPlacement.h"
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::net::CpuInfo;
+using muduo::net::CpuSlot;
+using muduo::net::LoopPlacement;
+
+namespace
+{
+    // 两个节点，每个节点2个物理核，每个核2个超线程：
+    // 节点0的核0为CPU 0和4，核1为1和5；节点1的核0为2和6，核1为3和7
+    std::vector<CpuInfo> dualSocket()
+    {
+        std::vector<CpuInfo> topology;
+        for (int cpu = 0; cpu < 8; ++cpu)
+        {
+            CpuInfo info;
+            info.cpu = cpu;
+            info.core = cpu % 2;
+            info.package = (cpu % 4) / 2;
+            info.node = info.package;
+            topology.push_back(info);
+        }
+        return topology;
+    }
+
+    std::vector<int> cpus(std::initializer_list<int> list)
+    {
+        return std::vector<int>(list);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testParseCpuList)
+{
+    std::vector<int> result;
+    BOOST_CHECK(LoopPlacement::parseCpuList("0-3,8,10-11\n", &result));
+    BOOST_CHECK(result == cpus({ 0, 1, 2, 3, 8, 10, 11 }));
+    BOOST_CHECK(LoopPlacement::parseCpuList("5", &result));
+    BOOST_CHECK(result == cpus({ 5 }));
+    BOOST_CHECK(LoopPlacement::parseCpuList("", &result));
+    BOOST_CHECK(result.empty());
+    BOOST_CHECK(!LoopPlacement::parseCpuList("3-1", &result));
+    BOOST_CHECK(!LoopPlacement::parseCpuList("1;2", &result));
+    BOOST_CHECK(!LoopPlacement::parseCpuList("a", &result));
+}
+
+BOOST_AUTO_TEST_CASE(testToString)
+{
+    CpuSlot slot;
+    BOOST_CHECK_EQUAL(LoopPlacement::toString(slot), "unbound");
+    slot.cpus = cpus({ 0, 1, 2, 5, 7, 8 });
+    slot.node = 1;
+    BOOST_CHECK_EQUAL(LoopPlacement::toString(slot), "cpus 0-2,5,7-8 node 1");
+}
+
+BOOST_AUTO_TEST_CASE(testAssign)
+{
+    const std::vector<CpuInfo> topology(dualSocket());
+
+    BOOST_CHECK(LoopPlacement().assign(4, topology).empty());
+
+    // 不在拓扑中的CPU被忽略
+    std::vector<CpuSlot> slots = LoopPlacement::cpuList(cpus({ 6, 1, 42 })).assign(3, topology);
+    BOOST_REQUIRE_EQUAL(slots.size(), 3);
+    BOOST_CHECK(slots[0].cpus == cpus({ 6 }));
+    BOOST_CHECK_EQUAL(slots[0].node, 1);
+    BOOST_CHECK(slots[1].cpus == cpus({ 1 }));
+    BOOST_CHECK_EQUAL(slots[1].node, 0);
+    BOOST_CHECK(slots[2].cpus == cpus({ 6 }));
+
+    // 物理核在节点间轮流分配，每个loop拿到一个核的两个超线程
+    slots = LoopPlacement::physicalCores().assign(5, topology);
+    BOOST_REQUIRE_EQUAL(slots.size(), 5);
+    BOOST_CHECK(slots[0].cpus == cpus({ 0, 4 }));
+    BOOST_CHECK_EQUAL(slots[0].node, 0);
+    BOOST_CHECK(slots[1].cpus == cpus({ 2, 6 }));
+    BOOST_CHECK_EQUAL(slots[1].node, 1);
+    BOOST_CHECK(slots[2].cpus == cpus({ 1, 5 }));
+    BOOST_CHECK(slots[3].cpus == cpus({ 3, 7 }));
+    BOOST_CHECK(slots[4].cpus == slots[0].cpus);
+
+    slots = LoopPlacement::numaNodes().assign(3, topology);
+    BOOST_REQUIRE_EQUAL(slots.size(), 3);
+    BOOST_CHECK(slots[0].cpus == cpus({ 0, 1, 4, 5 }));
+    BOOST_CHECK_EQUAL(slots[0].node, 0);
+    BOOST_CHECK(slots[1].cpus == cpus({ 2, 3, 6, 7 }));
+    BOOST_CHECK_EQUAL(slots[1].node, 1);
+    BOOST_CHECK_EQUAL(slots[2].node, 0);
+}
+
+BOOST_AUTO_TEST_CASE(testDetectAndBind)
+{
+    const std::vector<CpuInfo> topology(LoopPlacement::detectTopology());
+    BOOST_REQUIRE(!topology.empty());
+    std::vector<CpuSlot> slots = LoopPlacement::physicalCores().assign(1, topology);
+    BOOST_REQUIRE_EQUAL(slots.size(), 1);
+    BOOST_CHECK(LoopPlacement::bindCurrentThread(slots[0]));
+}
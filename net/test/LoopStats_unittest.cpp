@@ -0,0 +1,128 @@
+//
+// Created by fight on 2023/7/16.
+//
+
+#include "../../base/CountDownlatch.h"
+#include "../EventLoop.h"
+#include "../EventLoopThread.h"
+#include "../EventLoopThreadPool.h"
+#include "../LoopStats.h"
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+
+using muduo::CountDownLatch;
+using muduo::net::EventLoop;
+using muduo::net::EventLoopThread;
+using muduo::net::EventLoopThreadPool;
+using muduo::net::Histogram;
+using muduo::net::LoopStats;
+
+BOOST_AUTO_TEST_CASE(testHistogramBuckets)
+{
+    BOOST_CHECK_EQUAL(Histogram::bucketOf(-5), 0);
+    BOOST_CHECK_EQUAL(Histogram::bucketOf(0), 0);
+    BOOST_CHECK_EQUAL(Histogram::bucketOf(1), 1);
+    BOOST_CHECK_EQUAL(Histogram::bucketOf(2), 2);
+    BOOST_CHECK_EQUAL(Histogram::bucketOf(3), 2);
+    BOOST_CHECK_EQUAL(Histogram::bucketOf(4), 3);
+    BOOST_CHECK_EQUAL(Histogram::bucketOf(1023), 10);
+    BOOST_CHECK_EQUAL(Histogram::bucketOf(1024), 11);
+    BOOST_CHECK_EQUAL(Histogram::bucketOf(INT64_MAX), Histogram::kBuckets - 1);
+    for (int b = 1; b < Histogram::kBuckets - 1; ++b)
+    {
+        BOOST_CHECK_EQUAL(Histogram::bucketOf(Histogram::bucketUpperBound(b)), b);
+        BOOST_CHECK_EQUAL(Histogram::bucketOf(Histogram::bucketUpperBound(b) + 1), b + 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testHistogramSummary)
+{
+    Histogram h;
+    BOOST_CHECK_EQUAL(h.percentile(0.5), 0);
+    BOOST_CHECK_EQUAL(h.summary().count, 0);
+
+    // 98个5，1个100，1个3000
+    for (int i = 0; i < 98; ++i)
+    {
+        h.record(5);
+    }
+    h.record(100);
+    h.record(3000);
+    Histogram::Summary s = h.summary();
+    BOOST_CHECK_EQUAL(s.count, 100);
+    BOOST_CHECK_CLOSE(s.mean, (98 * 5 + 100 + 3000) / 100.0, 1e-9);
+    BOOST_CHECK_EQUAL(s.p50, 7);            // [4, 8)的上界
+    BOOST_CHECK_EQUAL(s.p99, 127);          // 第99个是100，[64, 128)
+    BOOST_CHECK_EQUAL(s.max, 3000);
+    BOOST_CHECK_EQUAL(h.percentile(1.0), 3000);     // 不超过max
+}
+
+BOOST_AUTO_TEST_CASE(testLoopStats)
+{
+    EventLoopThread thread;
+    EventLoop* loop = thread.startLoop();
+    CountDownLatch enabled(1);
+    loop->runInLoop([loop, &enabled]
+    {
+        loop->setCallbackTiming(true);
+        enabled.countDown();
+    });
+    enabled.wait();
+
+    CountDownLatch done(2);
+    loop->runAfter(0.01, [&done] { done.countDown(); });
+    loop->queueInLoop([&done]
+    {
+        ::usleep(30 * 1000);
+        done.countDown();
+    });
+    done.wait();
+    // 等上面的回调所在的迭代结束
+    CountDownLatch flushed(1);
+    loop->runInLoop([&flushed] { flushed.countDown(); });
+    flushed.wait();
+    ::usleep(10 * 1000);
+
+    LoopStats s = loop->stats();
+    BOOST_CHECK(s.loop == loop);
+    BOOST_CHECK_GT(s.iterations, 0);
+    BOOST_CHECK_GE(s.functorMicroseconds, 30 * 1000);
+    BOOST_CHECK_GE(s.queueDepth.count, 1);
+    BOOST_CHECK_GE(s.queueDepth.max, 1);
+    BOOST_CHECK_GE(s.activeChannels.count, s.iterations - 1);
+    BOOST_CHECK_GE(s.callbackMicroseconds.max, 30 * 1000);
+    // 睡眠的回调执行期间定时器到期，实际执行晚了
+    BOOST_CHECK_EQUAL(s.timerLagMicroseconds.count, 1);
+    BOOST_CHECK_GE(s.timerLagMicroseconds.max, 10 * 1000);
+    BOOST_REQUIRE(!s.slowest.empty());
+    BOOST_CHECK(s.slowest.size() <= EventLoop::kSlowCallbacks);
+    BOOST_CHECK_EQUAL(s.slowest[0].what, "functor");
+    BOOST_CHECK_GE(s.slowest[0].microseconds, 30 * 1000);
+    for (size_t i = 1; i < s.slowest.size(); ++i)
+    {
+        BOOST_CHECK_GE(s.slowest[i - 1].microseconds, s.slowest[i].microseconds);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testPoolStats)
+{
+    EventLoop baseLoop;
+    EventLoopThreadPool pool(&baseLoop, "stats");
+    BOOST_CHECK_EQUAL(pool.stats().size(), 1u);
+    BOOST_CHECK(pool.stats()[0].loop == &baseLoop);
+
+    pool.setThreadNum(3);
+    pool.start();
+    std::vector<LoopStats> all = pool.stats();
+    std::vector<EventLoop*> loops = pool.getAllLoops();
+    BOOST_REQUIRE_EQUAL(all.size(), 3u);
+    for (size_t i = 0; i < all.size(); ++i)
+    {
+        BOOST_CHECK(all[i].loop == loops[i]);
+        BOOST_CHECK_EQUAL(all[i].connections, 0);
+    }
+}
@@ -0,0 +1,116 @@
+//
+// Created by fight on 2023/7/9.
+//
+// 请求/应答式pingpong：服务端每收到一条消息，分kParts次send()把它发回去（模拟先写头部再写各段内容），
+// 比较EventLoop的cork模式关闭和打开时的吞吐量，以及cork模式省下的write系统调用。
+// 服务端和客户端在同一个loop中。
+#include "../../base/Logging.h"
+#include "../EventLoop.h"
+#include "../InetAddress.h"
+#include "../TcpClient.h"
+#include "../TcpServer.h"
+
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t kMessageSize = 256;
+const int kParts = 4;
+const int kClients = 16;
+const double kSeconds = 2.0;
+
+bool g_running = false;
+int64_t g_rounds = 0;
+int64_t g_serverSends = 0;
+string g_message(kMessageSize, 'p');
+
+void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+    while (buf->readableBytes() >= kMessageSize)
+    {
+        const char* data = buf->peek();
+        const size_t part = kMessageSize / kParts;
+        for (int i = 0; i < kParts; ++i)
+        {
+            conn->send(data + i * part, static_cast<int>(part));
+            ++g_serverSends;
+        }
+        buf->retrieve(kMessageSize);
+    }
+}
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true);
+        conn->send(g_message);
+    }
+}
+
+void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+    while (buf->readableBytes() >= kMessageSize)
+    {
+        buf->retrieve(kMessageSize);
+        if (g_running)
+        {
+            ++g_rounds;
+            conn->send(g_message);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    uint16_t port = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : 2030;
+    EventLoop loop;
+    InetAddress addr(port, true);
+    TcpServer server(&loop, addr, "PingPongServer");
+    server.setConnectionCallback([](const TcpConnectionPtr& conn)
+                                 {
+                                     if (conn->connected())
+                                     {
+                                         conn->setTcpNoDelay(true);
+                                     }
+                                 });
+    server.setMessageCallback(onServerMessage);
+    server.start();
+
+    printf("%d clients, %zu-byte messages echoed in %d send() calls, %.0fs per run\n",
+           kClients, kMessageSize, kParts, kSeconds);
+    printf("%6s %12s %14s %14s %14s\n", "cork", "rounds/s", "server sends", "cork flushes", "syscalls saved");
+    for (int cork = 0; cork < 2; ++cork)
+    {
+        loop.setCorking(cork != 0);
+        const int64_t sends0 = loop.corkedSends();
+        const int64_t flushes0 = loop.corkFlushes();
+        g_rounds = 0;
+        g_serverSends = 0;
+        g_running = true;
+
+        std::vector<std::unique_ptr<TcpClient>> clients;
+        for (int i = 0; i < kClients; ++i)
+        {
+            clients.emplace_back(new TcpClient(&loop, addr, "PingPongClient"));
+            clients.back()->setConnectionCallback(onClientConnection);
+            clients.back()->setMessageCallback(onClientMessage);
+            clients.back()->connect();
+        }
+        // 停止发起新的请求，等在途的应答收完再在loop中断开，避免带着未读数据关闭
+        loop.runAfter(kSeconds, [] { g_running = false; });
+        loop.runAfter(kSeconds + 0.1, [&clients] { clients.clear(); });
+        loop.runAfter(kSeconds + 0.2, std::bind(&EventLoop::quit, &loop));
+        loop.loop();
+
+        printf("%6s %12.0f %14lld %14lld %14lld\n", cork ? "on" : "off",
+               static_cast<double>(g_rounds) / kSeconds,
+               static_cast<long long>(g_serverSends),
+               static_cast<long long>(loop.corkFlushes() - flushes0),
+               static_cast<long long>((loop.corkedSends() - sends0) - (loop.corkFlushes() - flushes0)));
+    }
+}
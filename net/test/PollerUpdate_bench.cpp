@@ -0,0 +1,123 @@
+//
+// Created by fight on 2023/7/13.
+//
+// 在一个loop上注册kChannels个eventfd，比较EPollPoller立即提交和批量提交（EventLoop::setBatchedPollerUpdates()）
+// 两种模式下修改注册的耗时和epoll_ctl次数：
+//   register : 注册全部channel（每个一次EPOLL_CTL_ADD）
+//   toggle   : 同一轮中每个channel先开再关可写事件，净变化为0，批量模式下不需要epoll_ctl
+//   flip     : 一轮打开全部可写事件，下一轮再全部关闭，两种模式都是每个channel两次epoll_ctl
+//   remove   : 关闭并删除全部channel
+// 每一步之后跑一轮loop，让批量模式的修改在poll之前提交，计入耗时。
+#include "../../base/Logging.h"
+#include "../Channel.h"
+#include "../EventLoop.h"
+
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kRounds = 10;
+
+// 跑一轮loop：quit()在pendingFunctors中，poll不阻塞
+void runOneIteration(EventLoop* loop)
+{
+    loop->queueInLoop(std::bind(&EventLoop::quit, loop));
+    loop->loop();
+}
+
+void report(const char* step, bool batched, int ops, int64_t ctl, Timestamp start)
+{
+    const double us = timeDifference(Timestamp::now(), start) * 1e6;
+    printf("%10s %8s %10d %12lld %12.1f\n", step, batched ? "batched" : "direct", ops,
+           static_cast<long long>(ctl), us * 1000 / ops);
+}
+
+void run(int channels, bool batched)
+{
+    EventLoop loop;
+    if (!loop.setBatchedPollerUpdates(batched))
+    {
+        printf("%s poller does not support batched updates\n", loop.pollerName());
+        return;
+    }
+
+    std::vector<std::unique_ptr<Channel>> list;
+    for (int i = 0; i < channels; ++i)
+    {
+        int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd < 0)
+        {
+            LOG_SYSFATAL << "eventfd";
+        }
+        list.emplace_back(new Channel(&loop, fd));
+    }
+
+    int64_t ctl0 = loop.pollerCtlCalls();
+    Timestamp start(Timestamp::now());
+    for (auto& channel : list)
+    {
+        channel->enableReading();
+    }
+    runOneIteration(&loop);
+    report("register", batched, channels, loop.pollerCtlCalls() - ctl0, start);
+
+    ctl0 = loop.pollerCtlCalls();
+    start = Timestamp::now();
+    for (int r = 0; r < kRounds; ++r)
+    {
+        for (auto& channel : list)
+        {
+            channel->enableWriting();
+            channel->disableWriting();
+        }
+        runOneIteration(&loop);
+    }
+    report("toggle", batched, 2 * channels * kRounds, loop.pollerCtlCalls() - ctl0, start);
+
+    ctl0 = loop.pollerCtlCalls();
+    start = Timestamp::now();
+    for (int r = 0; r < kRounds; ++r)
+    {
+        for (auto& channel : list)
+        {
+            channel->enableWriting();
+        }
+        runOneIteration(&loop);
+        for (auto& channel : list)
+        {
+            channel->disableWriting();
+        }
+        runOneIteration(&loop);
+    }
+    report("flip", batched, 2 * channels * kRounds, loop.pollerCtlCalls() - ctl0, start);
+
+    ctl0 = loop.pollerCtlCalls();
+    start = Timestamp::now();
+    for (auto& channel : list)
+    {
+        channel->disableAll();
+        channel->remove();
+        ::close(channel->fd());
+    }
+    list.clear();
+    runOneIteration(&loop);
+    report("remove", batched, channels, loop.pollerCtlCalls() - ctl0, start);
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    // 受RLIMIT_NOFILE限制
+    int channels = argc > 1 ? atoi(argv[1]) : 10000;
+
+    printf("%d eventfd channels, %d rounds of toggle/flip\n", channels, kRounds);
+    printf("%10s %8s %10s %12s %12s\n", "step", "mode", "updates", "epoll_ctl", "ns/update");
+    run(channels, false);
+    run(channels, true);
+}
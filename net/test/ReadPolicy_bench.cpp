@@ -0,0 +1,127 @@
+//
+// Created by fight on 2023/7/5.
+//
+// 在loopback上批量接收，比较不同ReadPolicy下每MB数据的readv次数和extrabuf拷贝量。
+// 客户端不停发送，服务端按固定长度的消息消费（不足一条的数据留在inputBuffer_中）。
+#include "../../base/Logging.h"
+#include "../EventLoop.h"
+#include "../InetAddress.h"
+#include "../TcpClient.h"
+#include "../TcpServer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t kTotal = 1024UL * 1024 * 1024;  // 每轮发送的字节数
+const size_t kChunk = 256 * 1024;            // 客户端每次send的大小
+
+EventLoop* g_loop;
+size_t g_messageSize = 0;
+size_t g_sent = 0;
+size_t g_received = 0;
+TcpConnectionPtr g_serverConn;
+string g_chunk(kChunk, 'r');
+
+void sendNext(const TcpConnectionPtr& conn)
+{
+    while (g_sent < kTotal && conn->outputBytes() == 0)
+    {
+        conn->send(g_chunk);
+        g_sent += g_chunk.size();
+    }
+}
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+    if (conn->connected())
+    {
+        sendNext(conn);
+    }
+}
+
+void onServerConnection(const TcpConnectionPtr& conn)
+{
+    if (conn->connected())
+    {
+        g_serverConn = conn;
+    }
+}
+
+void onServerMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+{
+    size_t n = buf->readableBytes() / g_messageSize * g_messageSize;
+    g_received += n;
+    buf->retrieve(n);
+    if (g_received >= kTotal)
+    {
+        g_loop->quit();
+    }
+}
+
+struct Case
+{
+    const char* name;
+    ReadPolicy policy;
+};
+
+int main(int argc, char* argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    uint16_t port = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : 2022;
+    EventLoop loop;
+    g_loop = &loop;
+    InetAddress addr(port, true);
+    TcpServer server(&loop, addr, "ReadPolicyServer");
+    server.setConnectionCallback(onServerConnection);
+    server.setMessageCallback(onServerMessage);
+    server.start();
+
+    Case cases[4];
+    cases[0].name = "default";
+    cases[1].name = "arena";
+    cases[1].policy.useLoopArena = true;
+    cases[2].name = "arena+budget";
+    cases[2].policy = cases[1].policy;
+    cases[2].policy.maxReadsPerEvent = 16;
+    cases[2].policy.maxBytesPerEvent = 4 * 1024 * 1024;
+    cases[3].name = "adaptive";
+    cases[3].policy = cases[2].policy;
+    cases[3].policy.adaptiveGrowth = true;
+
+    printf("total %zu MB per run over loopback, client sends %zuK per call\n",
+           kTotal / 1024 / 1024, kChunk / 1024);
+    printf("%10s %14s %10s %12s %14s\n", "message", "policy", "MB/s", "reads/MB", "copied MB/MB");
+    for (g_messageSize = 1024; g_messageSize <= 1024 * 1024; g_messageSize *= 32)
+    {
+        for (size_t i = 0; i < sizeof cases / sizeof cases[0]; ++i)
+        {
+            server.setReadPolicy(cases[i].policy);
+            g_sent = 0;
+            g_received = 0;
+
+            TcpClient client(&loop, addr, "ReadPolicyClient");
+            client.setConnectionCallback(onClientConnection);
+            client.setWriteCompleteCallback(sendNext);
+            Timestamp start(Timestamp::now());
+            client.connect();
+            loop.loop();
+            double seconds = timeDifference(Timestamp::now(), start);
+
+            double mb = static_cast<double>(g_serverConn->bytesRead()) / 1024 / 1024;
+            printf("%9zuK %14s %10.1f %12.2f %14.3f\n",
+                   g_messageSize / 1024, cases[i].name,
+                   static_cast<double>(g_received) / seconds / 1024 / 1024,
+                   static_cast<double>(g_serverConn->readCalls()) / mb,
+                   static_cast<double>(g_serverConn->bytesCopied()) / 1024 / 1024 / mb);
+            g_serverConn->forceClose();
+            g_serverConn.reset();
+            client.disconnect();
+        }
+    }
+    // 处理完最后一轮连接的关闭
+    loop.runAfter(0.1, std::bind(&EventLoop::quit, &loop));
+    loop.loop();
+}
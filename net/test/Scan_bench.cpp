@@ -0,0 +1,142 @@
+//
+// Created by fight on 2023/7/7.
+//
+// 在真实的HTTP请求头上比较std::search和各种scan::实现：
+// 逐行findCRLF（HttpContext::parseRequest的用法）、每行查找':'、以及一次findCRLFCRLF找头部结尾。
+#include "../Scan.h"
+#include "../../base/Timestamp.h"
+#include "../../base/Types.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kRounds = 1000000;
+
+// 浏览器发出的典型请求头，约700字节，每行20~150字节
+const char kHeaders[] =
+        "GET /search?q=muduo+event+loop&source=hp HTTP/1.1\r\n"
+        "Host: www.example.com\r\n"
+        "Connection: keep-alive\r\n"
+        "Cache-Control: max-age=0\r\n"
+        "sec-ch-ua: \"Chromium\";v=\"116\", \"Not)A;Brand\";v=\"24\"\r\n"
+        "Upgrade-Insecure-Requests: 1\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+        "Chrome/116.0.0.0 Safari/537.36\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,"
+        "image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.7\r\n"
+        "Sec-Fetch-Site: none\r\n"
+        "Sec-Fetch-Mode: navigate\r\n"
+        "Accept-Encoding: gzip, deflate, br\r\n"
+        "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+        "Cookie: session=4f1c2d9a8b7e6f5a4c3b2a1908f7e6d5; theme=dark; lang=zh-CN\r\n"
+        "\r\n";
+
+const char* stdFindCRLF(const char* begin, const char* end)
+{
+    static const char kCRLF[] = "\r\n";
+    const char* p = std::search(begin, end, kCRLF, kCRLF + 2);
+    return p == end ? NULL : p;
+}
+
+const char* stdFindColon(const char* begin, const char* end)
+{
+    const char* p = std::find(begin, end, ':');
+    return p == end ? NULL : p;
+}
+
+const char* scanFindColon(const char* begin, const char* end)
+{
+    return scan::findByte(begin, end, ':');
+}
+
+// 模拟HttpContext：逐行找CRLF，每行再找':'，返回找到的行数防止被优化掉
+int parseLines(const char* (*findCRLF)(const char*, const char*),
+               const char* (*findColon)(const char*, const char*))
+{
+    const char* p = kHeaders;
+    const char* end = kHeaders + sizeof kHeaders - 1;
+    int lines = 0;
+    const char* crlf;
+    while ((crlf = findCRLF(p, end)) != NULL)
+    {
+        if (findColon(p, crlf) != NULL)
+        {
+            ++lines;
+        }
+        p = crlf + 2;
+    }
+    return lines;
+}
+
+double benchLines(const char* (*findCRLF)(const char*, const char*),
+                  const char* (*findColon)(const char*, const char*))
+{
+    int total = 0;
+    Timestamp start(Timestamp::now());
+    for (int i = 0; i < kRounds; ++i)
+    {
+        total += parseLines(findCRLF, findColon);
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    if (total == 0)
+    {
+        printf("unexpected\n");
+    }
+    return seconds;
+}
+
+double benchBlock(const char* (*find)(const char*, const char*))
+{
+    const char* end = kHeaders + sizeof kHeaders - 1;
+    size_t total = 0;
+    Timestamp start(Timestamp::now());
+    for (int i = 0; i < kRounds; ++i)
+    {
+        total += find(kHeaders, end) - kHeaders;
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    if (total == 0)
+    {
+        printf("unexpected\n");
+    }
+    return seconds;
+}
+
+const char* stdFindCRLFCRLF(const char* begin, const char* end)
+{
+    static const char kCRLFCRLF[] = "\r\n\r\n";
+    const char* p = std::search(begin, end, kCRLFCRLF, kCRLFCRLF + 4);
+    return p == end ? NULL : p;
+}
+
+void report(const char* name, double seconds)
+{
+    const double mb = static_cast<double>(sizeof kHeaders - 1) * kRounds / 1024 / 1024;
+    printf("%-28s %8.3fs %10.1f MB/s %8.1f ns/request\n",
+           name, seconds, mb / seconds, seconds * 1e9 / kRounds);
+}
+
+int main()
+{
+    printf("header block %zu bytes, %d rounds\n", sizeof kHeaders - 1, kRounds);
+    report("lines: std::search", benchLines(stdFindCRLF, stdFindColon));
+    report("block: std::search", benchBlock(stdFindCRLFCRLF));
+
+    const scan::Isa isas[] = { scan::kScalar, scan::kSse2, scan::kAvx2 };
+    for (size_t i = 0; i < sizeof isas / sizeof isas[0]; ++i)
+    {
+        if (!scan::setIsa(isas[i]))
+        {
+            printf("%s not supported\n", scan::isaName(isas[i]));
+            continue;
+        }
+        char name[64];
+        snprintf(name, sizeof name, "lines: scan %s", scan::isaName(isas[i]));
+        report(name, benchLines(scan::findCRLF, scanFindColon));
+        snprintf(name, sizeof name, "block: scan %s", scan::isaName(isas[i]));
+        report(name, benchBlock(scan::findCRLFCRLF));
+    }
+}
@@ -0,0 +1,100 @@
+//
+// Created by fight on 2023/7/7.
+//
+
+#include "../Buffer.h"
+#include "../Scan.h"
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <stdlib.h>
+
+using muduo::string;
+using muduo::net::Buffer;
+namespace scan = muduo::net::scan;
+
+namespace
+{
+    const char* naiveSearch(const char* begin, const char* end, const char* needle, size_t len)
+    {
+        const char* p = std::search(begin, end, needle, needle + len);
+        return p == end ? NULL : p;
+    }
+
+    const char* naiveAnyOf(const char* begin, const char* end, const char* set, size_t setSize)
+    {
+        const char* p = std::find_first_of(begin, end, set, set + setSize);
+        return p == end ? NULL : p;
+    }
+
+    // 对每种实现，在各种起点和长度上与std::search/std::find_first_of比较
+    void checkAll(const string& data)
+    {
+        const scan::Isa isas[] = { scan::kScalar, scan::kSse2, scan::kAvx2 };
+        const scan::Isa saved = scan::isa();
+        const char set[] = ":; \t";
+        for (size_t k = 0; k < sizeof isas / sizeof isas[0]; ++k)
+        {
+            if (!scan::setIsa(isas[k]))
+            {
+                continue;
+            }
+            for (size_t start = 0; start < 40 && start <= data.size(); ++start)
+            {
+                for (size_t len = 0; start + len <= data.size(); len += (len < 80 ? 1 : 37))
+                {
+                    const char* b = data.data() + start;
+                    const char* e = b + len;
+                    BOOST_REQUIRE(scan::findCRLF(b, e) == naiveSearch(b, e, "\r\n", 2));
+                    BOOST_REQUIRE(scan::findCRLFCRLF(b, e) == naiveSearch(b, e, "\r\n\r\n", 4));
+                    BOOST_REQUIRE(scan::findByte(b, e, '\n') == naiveSearch(b, e, "\n", 1));
+                    BOOST_REQUIRE(scan::findAnyOf(b, e, set, 4) == naiveAnyOf(b, e, set, 4));
+                }
+            }
+        }
+        scan::setIsa(saved);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testScanHeaders)
+{
+    checkAll("GET /index.html HTTP/1.1\r\n"
+             "Host: www.chenshuo.com\r\n"
+             "User-Agent: Mozilla/5.0 (X11; Linux x86_64)\r\n"
+             "Accept: text/html,application/xhtml+xml;q=0.9\r\n"
+             "\r\r\n\r\r\n"
+             "Connection: keep-alive\r\n"
+             "\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(testScanRandom)
+{
+    // 只由这几个字符组成，各种相邻组合都会出现
+    const char alphabet[] = "\r\n\r\na: \t";
+    srand(1234);
+    for (int round = 0; round < 20; ++round)
+    {
+        string data;
+        for (int i = 0; i < 200; ++i)
+        {
+            data.push_back(alphabet[rand() % (sizeof alphabet - 1)]);
+        }
+        checkAll(data);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testBufferFind)
+{
+    Buffer buf;
+    buf.append("Host: example.com\r\nAccept: */*\r\n\r\nbody");
+    BOOST_CHECK_EQUAL(string(buf.peek(), buf.findCRLF()), string("Host: example.com"));
+    BOOST_CHECK_EQUAL(string(buf.peek(), buf.findCRLFCRLF()), string("Host: example.com\r\nAccept: */*"));
+    BOOST_CHECK_EQUAL(string(buf.peek(), buf.findChar(':')), string("Host"));
+    BOOST_CHECK_EQUAL(string(buf.peek(), buf.findAnyOf(".*")), string("Host: example"));
+    BOOST_CHECK_EQUAL(string(buf.peek(), buf.findEOL()), string("Host: example.com\r"));
+    BOOST_CHECK(buf.findChar('#') == NULL);
+    BOOST_CHECK(scan::isaName(scan::isa()) != NULL);
+}
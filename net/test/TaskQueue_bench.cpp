@@ -0,0 +1,182 @@
+//
+// Created by fight on 2023/7/11.
+//
+// 多个线程同时向一个消费者提交小任务，比较三种方式的吞吐量：
+//   mutex : 原来queueInLoop()的做法，加锁push_back到std::vector<std::function<void()>>，消费者swap后执行
+//   mpsc  : TaskQueue，无锁环形数组 + Task内联保存闭包，消费者popAll()批量取出
+//   loop  : 经过EventLoop::queueInLoop()，包括eventfd唤醒在内的完整路径，wakeups是实际写eventfd的次数
+// 任务是绑定了一个shared_ptr和一个计数器的std::bind，大小与TcpConnection中常见的回调相当。
+#include "../../base/CountDownlatch.h"
+#include "../../base/Logging.h"
+#include "../../base/Mutex.h"
+#include "../../base/Thread.h"
+#include "../EventLoop.h"
+#include "../EventLoopThread.h"
+#include "../TaskQueue.h"
+
+#include <functional>
+#include <memory>
+#include <sched.h>
+#include <stdio.h>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kTotalTasks = 1 << 20;
+
+int64_t g_executed = 0;   // 只在消费者线程中修改
+std::shared_ptr<int> g_owner(new int(1));
+
+void onTask(const std::shared_ptr<int>& owner, int64_t* counter)
+{
+    *counter += *owner;
+}
+
+// 原来的实现：mutex + std::vector<std::function<void()>>
+class MutexQueue : noncopyable
+{
+public:
+    void push(std::function<void()> f)
+    {
+        MutexLockGuard lock(mutex_);
+        queue_.push_back(std::move(f));
+    }
+
+    void popAll(std::vector<std::function<void()>>* out)
+    {
+        MutexLockGuard lock(mutex_);
+        out->swap(queue_);
+    }
+
+private:
+    MutexLock mutex_;
+    std::vector<std::function<void()>> queue_ GUARDED_BY(mutex_);
+};
+
+// 所有生产者线程就绪后同时开始，返回从开始到消费者执行完所有任务的秒数
+template<typename Produce, typename Consume>
+double run(int producers, Produce produce, Consume consume)
+{
+    CountDownLatch ready(producers);
+    CountDownLatch go(1);
+    std::vector<std::unique_ptr<Thread>> threads;
+    const int perThread = kTotalTasks / producers;
+    for (int i = 0; i < producers; ++i)
+    {
+        threads.emplace_back(new Thread([&ready, &go, &produce, perThread]
+        {
+            ready.countDown();
+            go.wait();
+            for (int n = 0; n < perThread; ++n)
+            {
+                produce();
+            }
+        }));
+        threads.back()->start();
+    }
+    ready.wait();
+    g_executed = 0;
+    Timestamp start(Timestamp::now());
+    go.countDown();
+    consume(static_cast<int64_t>(perThread) * producers);
+    double seconds = timeDifference(Timestamp::now(), start);
+    for (auto& thr : threads)
+    {
+        thr->join();
+    }
+    return seconds;
+}
+
+double runMutex(int producers)
+{
+    MutexQueue queue;
+    return run(producers,
+               [&queue] { queue.push(std::bind(onTask, g_owner, &g_executed)); },
+               [&queue](int64_t total)
+               {
+                   std::vector<std::function<void()>> functors;
+                   while (g_executed < total)
+                   {
+                       queue.popAll(&functors);
+                       if (functors.empty())
+                       {
+                           ::sched_yield();
+                       }
+                       for (const auto& f : functors)
+                       {
+                           f();
+                       }
+                       functors.clear();
+                   }
+               });
+}
+
+double runMpsc(int producers, int64_t* overflows)
+{
+    TaskQueue queue;
+    double seconds = run(producers,
+                         [&queue] { queue.push(std::bind(onTask, g_owner, &g_executed)); },
+                         [&queue](int64_t total)
+                         {
+                             std::vector<Task> tasks;
+                             while (g_executed < total)
+                             {
+                                 if (queue.popAll(&tasks) == 0)
+                                 {
+                                     ::sched_yield();
+                                 }
+                                 for (Task& task : tasks)
+                                 {
+                                     task();
+                                 }
+                                 tasks.clear();
+                             }
+                         });
+    *overflows = queue.overflows();
+    return seconds;
+}
+
+double runLoop(EventLoop* loop, int producers, int64_t* wakeups)
+{
+    CountDownLatch done(1);
+    int64_t total = static_cast<int64_t>(kTotalTasks / producers) * producers;
+    const int64_t issued = loop->wakeupsIssued();
+    double seconds = run(producers,
+               [loop, &done, total]
+               {
+                   loop->queueInLoop([&done, total]
+                                     {
+                                         onTask(g_owner, &g_executed);
+                                         if (g_executed == total)
+                                         {
+                                             done.countDown();
+                                         }
+                                     });
+               },
+               [&done](int64_t) { done.wait(); });
+    *wakeups = loop->wakeupsIssued() - issued;
+    return seconds;
+}
+
+int main()
+{
+    Logger::setLogLevel(Logger::WARN);
+    EventLoopThread loopThread;
+    EventLoop* loop = loopThread.startLoop();
+
+    // 生产者提交得比消费者快时环形数组会满，overflowed是退到加锁overflow_中的任务数
+    printf("%d tasks per run, Mtasks/s\n", kTotalTasks);
+    printf("%10s %10s %10s %10s %12s %10s\n", "producers", "mutex", "mpsc", "loop", "overflowed", "wakeups");
+    for (int producers = 1; producers <= 64; producers *= 2)
+    {
+        double mutex = runMutex(producers);
+        int64_t overflows = 0;
+        double mpsc = runMpsc(producers, &overflows);
+        int64_t wakeups = 0;
+        double looped = runLoop(loop, producers, &wakeups);
+        printf("%10d %10.2f %10.2f %10.2f %12lld %10lld\n", producers,
+               kTotalTasks / mutex / 1e6, kTotalTasks / mpsc / 1e6, kTotalTasks / looped / 1e6,
+               static_cast<long long>(overflows), static_cast<long long>(wakeups));
+    }
+}
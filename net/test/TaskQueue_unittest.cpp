@@ -0,0 +1,138 @@
+//
+// Created by fight on 2023/7/11.
+//
+
+#include "../TaskQueue.h"
+#include "../../base/Thread.h"
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+using muduo::net::Task;
+using muduo::net::TaskQueue;
+
+BOOST_AUTO_TEST_CASE(testTaskStorage)
+{
+    int count = 0;
+    Task small([&count] { ++count; });
+    BOOST_CHECK(small.isInline());
+    small();
+    BOOST_CHECK_EQUAL(count, 1);
+
+    // std::function和绑定了shared_ptr的std::bind都放得下
+    std::function<void()> func = [&count] { count += 10; };
+    Task wrapped(func);
+    BOOST_CHECK(wrapped.isInline());
+    std::shared_ptr<int> owner(new int(5));
+    Task bound(std::bind([](const std::shared_ptr<int>& p, int* c) { *c += *p; }, owner, &count));
+    BOOST_CHECK(bound.isInline());
+    BOOST_CHECK_EQUAL(owner.use_count(), 2);
+
+    // 超过kInlineSize的闭包放到堆上
+    char big[Task::kInlineSize * 2] = { 1 };
+    Task large([big, &count] { count += big[0]; });
+    BOOST_CHECK(!large.isInline());
+
+    // 移动后原对象为空，闭包只析构一次
+    std::vector<Task> tasks;
+    tasks.push_back(std::move(wrapped));
+    tasks.push_back(std::move(bound));
+    tasks.push_back(std::move(large));
+    BOOST_CHECK(!wrapped && !bound && !large);
+    BOOST_CHECK_EQUAL(owner.use_count(), 2);
+    for (Task& task : tasks)
+    {
+        task();
+    }
+    BOOST_CHECK_EQUAL(count, 1 + 10 + 5 + 1);
+    tasks.clear();
+    BOOST_CHECK_EQUAL(owner.use_count(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testTaskQueueOverflowOrder)
+{
+    TaskQueue queue(4);
+    BOOST_CHECK_EQUAL(queue.capacity(), 4);
+    std::vector<int> order;
+    for (int i = 0; i < 10; ++i)
+    {
+        queue.push([&order, i] { order.push_back(i); });
+    }
+    // 前4个在环形数组中，其余进入overflow_
+    BOOST_CHECK_EQUAL(queue.overflows(), 6);
+    BOOST_CHECK_EQUAL(queue.sizeApprox(), 10);
+
+    std::vector<Task> tasks;
+    BOOST_CHECK_EQUAL(queue.popAll(&tasks), 10);
+    for (Task& task : tasks)
+    {
+        task();
+    }
+    for (int i = 0; i < 10; ++i)
+    {
+        BOOST_CHECK_EQUAL(order[i], i);
+    }
+    BOOST_CHECK_EQUAL(queue.sizeApprox(), 0);
+
+    // overflow_取走之后重新使用环形数组
+    tasks.clear();
+    queue.push([] { });
+    BOOST_CHECK_EQUAL(queue.overflows(), 6);
+    BOOST_CHECK_EQUAL(queue.popAll(&tasks), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testTaskQueueProducers)
+{
+    const int kProducers = 8;
+    const int kTasks = 20000;
+    TaskQueue queue(64);
+    // 消费者记录每个生产者最后执行的序号，同一个生产者的任务必须按顺序执行
+    std::vector<int> last(kProducers, -1);
+    bool ordered = true;
+
+    std::vector<std::unique_ptr<muduo::Thread>> threads;
+    for (int p = 0; p < kProducers; ++p)
+    {
+        threads.emplace_back(new muduo::Thread([&queue, &last, &ordered, p, kTasks]
+        {
+            for (int i = 0; i < kTasks; ++i)
+            {
+                queue.push([&last, &ordered, p, i]
+                           {
+                               if (last[p] + 1 != i) ordered = false;
+                               last[p] = i;
+                           });
+            }
+        }));
+        threads.back()->start();
+    }
+
+    std::vector<Task> tasks;
+    int executed = 0;
+    while (executed < kProducers * kTasks)
+    {
+        queue.popAll(&tasks);
+        for (Task& task : tasks)
+        {
+            task();
+        }
+        executed += static_cast<int>(tasks.size());
+        tasks.clear();
+    }
+    for (auto& thr : threads)
+    {
+        thr->join();
+    }
+    BOOST_CHECK(ordered);
+    BOOST_CHECK_EQUAL(executed, kProducers * kTasks);
+    BOOST_CHECK_EQUAL(queue.sizeApprox(), 0);
+    for (int p = 0; p < kProducers; ++p)
+    {
+        BOOST_CHECK_EQUAL(last[p], kTasks - 1);
+    }
+}
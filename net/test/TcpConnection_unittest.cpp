@@ -0,0 +1,328 @@
+//
+// Created by fight on 2023/7/16.
+//
+
+#include "../../base/CountDownlatch.h"
+#include "../Buffer.h"
+#include "../BufferPool.h"
+#include "../EventLoop.h"
+#include "../EventLoopThread.h"
+#include "../InetAddress.h"
+#include "../TcpConnection.h"
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <functional>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using muduo::CountDownLatch;
+using muduo::net::EventLoop;
+using muduo::net::EventLoopThread;
+using muduo::net::InetAddress;
+using muduo::net::TcpConnection;
+using muduo::net::TcpConnectionPtr;
+using muduo::string;
+
+namespace
+{
+    // 在loop线程中执行f并等待它完成
+    void runSync(EventLoop* loop, const std::function<void()>& f)
+    {
+        CountDownLatch done(1);
+        loop->runInLoop([&f, &done]
+        {
+            f();
+            done.countDown();
+        });
+        done.wait();
+    }
+
+    // socketpair的一端交给TcpConnection，另一端由测试直接读写，不需要监听端口
+    struct ConnectionPair
+    {
+        explicit ConnectionPair(EventLoop* loop)
+                : loop_(loop)
+        {
+            int fds[2];
+            BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+            peer = fds[1];
+            // 发送缓冲区很小，对端读一点连接就写一点，outputBytes()逐步下降
+            int sndbuf = 4096;
+            ::setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof sndbuf);
+            conn = std::make_shared<TcpConnection>(loop, "test", fds[0], InetAddress(), InetAddress());
+            // TcpServer平时会设置这些回调
+            conn->setConnectionCallback([](const TcpConnectionPtr&) { });
+            conn->setMessageCallback([](const TcpConnectionPtr&, muduo::net::Buffer* buf, muduo::Timestamp)
+                                     { buf->retrieveAll(); });
+            conn->setCloseCallback([](const TcpConnectionPtr&) { });
+        }
+
+        ~ConnectionPair()
+        {
+            // 与TcpServer一样先关闭（handleClose()注销事件），再connectDestroyed()
+            TcpConnectionPtr c(conn);
+            conn.reset();
+            c->forceClose();
+            runSync(loop_, [] { });
+            runSync(loop_, [c] { c->connectDestroyed(); });
+            ::close(peer);
+        }
+
+        // 等待peer可读，返回read()的结果，超时返回-1
+        ssize_t readPeer(char* buf, size_t len, int timeoutMs = 1000)
+        {
+            struct pollfd pfd = { peer, POLLIN, 0 };
+            if (::poll(&pfd, 1, timeoutMs) <= 0)
+            {
+                return -1;
+            }
+            return ::read(peer, buf, len);
+        }
+
+        EventLoop* loop_;
+        int peer;
+        TcpConnectionPtr conn;
+    };
+}
+
+// cork模式下零长度的send()之后shutdown()：flush时没有数据要写，仍然要关闭写端、通知写完
+BOOST_AUTO_TEST_CASE(testCorkEmptySendShutdown)
+{
+    EventLoopThread thread;
+    EventLoop* loop = thread.startLoop();
+    ConnectionPair pair(loop);
+    std::atomic<int> writeCompletes(0);
+    TcpConnectionPtr conn(pair.conn);
+
+    runSync(loop, [loop, conn, &writeCompletes]
+    {
+        loop->setCorking(true);
+        conn->setWriteCompleteCallback([&writeCompletes](const TcpConnectionPtr&) { ++writeCompletes; });
+        conn->connectEstablished();
+    });
+    runSync(loop, [conn]
+    {
+        conn->send("", 0);
+        conn->shutdown();
+    });
+
+    char buf[16];
+    BOOST_CHECK_EQUAL(pair.readPeer(buf, sizeof buf), 0);
+    runSync(loop, [] { });
+    BOOST_CHECK_EQUAL(writeCompletes.load(), 1);
+    runSync(loop, [loop] { loop->setCorking(false); });
+}
+
+// cork模式下有数据时照常flush之后再关闭写端
+BOOST_AUTO_TEST_CASE(testCorkSendShutdown)
+{
+    EventLoopThread thread;
+    EventLoop* loop = thread.startLoop();
+    ConnectionPair pair(loop);
+    TcpConnectionPtr conn(pair.conn);
+
+    runSync(loop, [loop, conn]
+    {
+        loop->setCorking(true);
+        conn->connectEstablished();
+    });
+    runSync(loop, [conn]
+    {
+        conn->send("hello");
+        conn->send("", 0);
+        conn->shutdown();
+    });
+
+    char buf[16];
+    BOOST_CHECK_EQUAL(pair.readPeer(buf, sizeof buf), 5);
+    BOOST_CHECK_EQUAL(pair.readPeer(buf, sizeof buf), 0);
+    runSync(loop, [loop] { loop->setCorking(false); });
+}
+
+// 使用BufferPool的连接带着没处理完的输入关闭，借出的存储随连接释放，池中不留空壳
+BOOST_AUTO_TEST_CASE(testBufferPoolingPartialMessageClose)
+{
+    EventLoopThread thread;
+    EventLoop* loop = thread.startLoop();
+    {
+        ConnectionPair pair(loop);
+        TcpConnectionPtr conn(pair.conn);
+        CountDownLatch received(1);
+        conn->setMessageCallback([&received](const TcpConnectionPtr&, muduo::net::Buffer*, muduo::Timestamp)
+                                 { received.countDown(); });     // 不取走数据，相当于只收到半个消息
+        runSync(loop, [conn]
+        {
+            conn->setBufferPooling(true);
+            conn->connectEstablished();
+        });
+        BOOST_REQUIRE_EQUAL(::write(pair.peer, "partial", 7), 7);
+        received.wait();
+        runSync(loop, [loop] { BOOST_CHECK_EQUAL(loop->bufferPool()->husksHeld(), 1u); });
+    }
+    runSync(loop, [loop] { BOOST_CHECK_EQUAL(loop->bufferPool()->husksHeld(), 0u); });
+}
+
+namespace
+{
+    const size_t kHighMark = 64 * 1024;
+    const size_t kLowMark = 16 * 1024;
+
+    struct BackpressureState
+    {
+        bool throttled;
+        size_t outputBytes;
+    };
+
+    BackpressureState backpressureState(EventLoop* loop, const TcpConnectionPtr& conn)
+    {
+        BackpressureState state = { false, 0 };
+        runSync(loop, [&state, conn]
+        {
+            state.throttled = conn->readThrottled();
+            state.outputBytes = conn->outputBytes();
+        });
+        return state;
+    }
+}
+
+// 待发送数据超过高水位暂停读取，在两个水位之间保持暂停，降到低水位及以下恢复，统计暂停的次数和时长
+BOOST_AUTO_TEST_CASE(testReadBackpressure)
+{
+    EventLoopThread thread;
+    EventLoop* loop = thread.startLoop();
+    ConnectionPair pair(loop);
+    TcpConnectionPtr conn(pair.conn);
+    std::atomic<int> messages(0);
+    conn->setMessageCallback([&messages](const TcpConnectionPtr&, muduo::net::Buffer* buf, muduo::Timestamp)
+                             {
+                                 ++messages;
+                                 buf->retrieveAll();
+                             });
+    const size_t total = 1024 * 1024;
+    runSync(loop, [conn, total]
+    {
+        conn->setReadBackpressure(kHighMark, kLowMark);
+        conn->connectEstablished();
+        conn->send(string(total, 'x'));
+    });
+    BackpressureState state = backpressureState(loop, conn);
+    BOOST_CHECK(state.throttled);
+    BOOST_CHECK_GT(state.outputBytes, kHighMark);
+
+    // 暂停期间对端发来的数据不读
+    BOOST_REQUIRE_EQUAL(::write(pair.peer, "ping", 4), 4);
+    ::usleep(50 * 1000);
+    BOOST_CHECK_EQUAL(messages.load(), 0);
+    runSync(loop, [conn]
+    {
+        BOOST_CHECK_EQUAL(conn->throttledCount(), 1);
+        BOOST_CHECK_GE(conn->throttledSeconds(), 0.04);     // 包括正在暂停的这一段
+    });
+
+    // 对端一点一点地读，待发送数据只减不增
+    char buf[8192];
+    size_t received = 0;
+    bool sawBetweenMarks = false;
+    bool resumed = false;
+    while (received < total)
+    {
+        ssize_t n = pair.readPeer(buf, sizeof buf);
+        BOOST_REQUIRE_GT(n, 0);
+        received += n;
+        state = backpressureState(loop, conn);
+        if (state.outputBytes > kLowMark)
+        {
+            BOOST_CHECK(state.throttled);
+            sawBetweenMarks = sawBetweenMarks || state.outputBytes <= kHighMark;
+        }
+        else if (!state.throttled)
+        {
+            resumed = true;
+        }
+    }
+    BOOST_CHECK(sawBetweenMarks);
+    BOOST_CHECK(resumed);
+
+    // 恢复之后读到暂停期间的数据
+    for (int i = 0; i < 100 && messages.load() == 0; ++i)
+    {
+        ::usleep(10 * 1000);
+    }
+    BOOST_CHECK_EQUAL(messages.load(), 1);
+    double seconds = 0.0;
+    runSync(loop, [conn, &seconds]
+    {
+        BOOST_CHECK(!conn->readThrottled());
+        BOOST_CHECK_EQUAL(conn->throttledCount(), 1);
+        seconds = conn->throttledSeconds();
+    });
+    BOOST_CHECK_GE(seconds, 0.04);
+    ::usleep(20 * 1000);
+    runSync(loop, [conn, seconds] { BOOST_CHECK_EQUAL(conn->throttledSeconds(), seconds); });   // 不再增长
+}
+
+// setReadBackpressure()和linkReadBackpressure()各自使用自己的水位，解除一个不影响另一个
+BOOST_AUTO_TEST_CASE(testLinkedBackpressureIndependent)
+{
+    EventLoopThread thread;
+    EventLoop* loop = thread.startLoop();
+    ConnectionPair pairA(loop);
+    ConnectionPair pairB(loop);
+    TcpConnectionPtr a(pairA.conn);
+    TcpConnectionPtr b(pairB.conn);
+    runSync(loop, [a, b]
+    {
+        a->setReadBackpressure(kHighMark, kLowMark);
+        a->connectEstablished();
+        b->connectEstablished();
+    });
+    TcpConnection::linkReadBackpressure(a, b, 4 * 1024 * 1024, 1024 * 1024);
+    runSync(loop, [] { });
+
+    // a的待发送数据超过自己的高水位，没有超过连接对的高水位：只暂停a
+    runSync(loop, [a] { a->send(string(512 * 1024, 'x')); });
+    BOOST_CHECK(backpressureState(loop, a).throttled);
+    BOOST_CHECK(!backpressureState(loop, b).throttled);
+
+    // 解除连接对，a自己的背压仍然有效
+    TcpConnection::linkReadBackpressure(a, b, 0, 0);
+    runSync(loop, [] { });
+    BOOST_CHECK(backpressureState(loop, a).throttled);
+
+    // 连接对超过高水位时暂停对方，解除时恢复
+    TcpConnection::linkReadBackpressure(a, b, kHighMark, kLowMark);
+    runSync(loop, [] { });
+    BOOST_CHECK(backpressureState(loop, b).throttled);
+    TcpConnection::linkReadBackpressure(a, b, 0, 0);
+    runSync(loop, [] { });
+    BOOST_CHECK(!backpressureState(loop, b).throttled);
+    BOOST_CHECK(backpressureState(loop, a).throttled);
+
+    // 关闭a自己的背压
+    runSync(loop, [a] { a->setReadBackpressure(0, 0); });
+    BOOST_CHECK(!backpressureState(loop, a).throttled);
+}
+
+// 连接计数在构造时加一、析构时减一，对象还在（比如回调里还持有TcpConnectionPtr）就一直计入
+BOOST_AUTO_TEST_CASE(testConnectionCount)
+{
+    EventLoopThread thread;
+    EventLoop* loop = thread.startLoop();
+    BOOST_CHECK_EQUAL(loop->connectionCount(), 0);
+    TcpConnectionPtr held;
+    {
+        ConnectionPair pair(loop);
+        held = pair.conn;
+        BOOST_CHECK_EQUAL(loop->connectionCount(), 1);
+        runSync(loop, [held] { held->connectEstablished(); });
+    }
+    // connectDestroyed()之后还有引用
+    BOOST_CHECK_EQUAL(loop->connectionCount(), 1);
+    held.reset();
+    BOOST_CHECK_EQUAL(loop->connectionCount(), 0);
+}
@@ -0,0 +1,90 @@
+//
+// Created by fight on 2023/7/14.
+//
+// 比较TimerQueue默认的std::set实现和分层时间轮（EventLoop::useTimingWheel()）：
+//   add/cancel : 已有kBackground个长超时定时器时，在loop线程中做kCycles次runAfter()+cancel()，
+//                模拟大量连接各自的空闲超时不断被重置
+//   fire       : 一次添加kFired个0~100ms内随机到期的定时器，统计实际触发时刻比到期时刻晚多少
+#include "../../base/Logging.h"
+#include "../EventLoop.h"
+
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kBackground = 100000;
+const int kFired = 10000;
+
+int g_fired = 0;
+int64_t g_lateTotal = 0;
+int64_t g_lateMax = 0;
+
+void onFire(EventLoop* loop, Timestamp when)
+{
+    const int64_t late = Timestamp::now().microSecondsSinceEpoch() - when.microSecondsSinceEpoch();
+    g_lateTotal += late;
+    if (late > g_lateMax)
+    {
+        g_lateMax = late;
+    }
+    if (++g_fired == kFired)
+    {
+        loop->quit();
+    }
+}
+
+void run(const char* name, double tickSeconds, int cycles)
+{
+    EventLoop loop;
+    if (tickSeconds > 0 && !loop.useTimingWheel(tickSeconds))
+    {
+        printf("useTimingWheel(%g) failed\n", tickSeconds);
+        return;
+    }
+
+    std::mt19937 rng(2023);
+    std::uniform_real_distribution<double> longDelay(60.0, 600.0);
+    for (int i = 0; i < kBackground; ++i)
+    {
+        loop.runAfter(longDelay(rng), [] { });
+    }
+
+    Timestamp start(Timestamp::now());
+    for (int i = 0; i < cycles; ++i)
+    {
+        TimerId id = loop.runAfter(longDelay(rng), [] { });
+        loop.cancel(id);
+    }
+    const double cycleNs = timeDifference(Timestamp::now(), start) * 1e9 / cycles;
+
+    g_fired = 0;
+    g_lateTotal = 0;
+    g_lateMax = 0;
+    std::uniform_real_distribution<double> shortDelay(0.0, 0.1);
+    for (int i = 0; i < kFired; ++i)
+    {
+        const double delay = shortDelay(rng);
+        const Timestamp when = addTime(Timestamp::now(), delay);
+        loop.runAfter(delay, [&loop, when] { onFire(&loop, when); });
+    }
+    loop.loop();
+
+    printf("%12s %14.1f %14.1f %14lld\n", name, cycleNs,
+           static_cast<double>(g_lateTotal) / kFired, static_cast<long long>(g_lateMax));
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    int cycles = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    printf("%d background timers, %d add/cancel cycles, %d fired timers\n", kBackground, cycles, kFired);
+    printf("%12s %14s %14s %14s\n", "queue", "ns/cycle", "avg late(us)", "max late(us)");
+    run("set", 0, cycles);
+    run("wheel 1ms", 0.001, cycles);
+    run("wheel 10ms", 0.01, cycles);
+}
@@ -0,0 +1,126 @@
+//
+// Created by fight on 2023/7/14.
+//
+
+#include "../Timer.h"
+#include "../TimingWheel.h"
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <set>
+#include <vector>
+
+using muduo::Timestamp;
+using muduo::net::Timer;
+using muduo::net::TimingWheel;
+
+namespace
+{
+    const int64_t kTickUs = 1000;
+    const Timestamp kStart(1000000000LL * 1000000);
+
+    Timestamp after(int64_t us)
+    {
+        return Timestamp(kStart.microSecondsSinceEpoch() + us);
+    }
+}
+
+// 到期时间分布在各层（包括超出6层范围的），随机步长推进，
+// 每个定时器恰好触发一次，不提前，也不会比上一次推进的时刻晚一个tick以上
+BOOST_AUTO_TEST_CASE(testExpiration)
+{
+    TimingWheel wheel(kTickUs, kStart);
+    std::mt19937_64 rng(2023);
+    const int64_t horizons[] = { 100 * 1000LL,                       // 100ms，第0、1层
+                                 10 * 1000 * 1000LL,                 // 10s
+                                 86400LL * 1000 * 1000,              // 1天
+                                 2000LL * 86400 * 1000 * 1000 };     // 2000天，超出时间轮范围
+    std::multiset<int64_t> pending;
+    for (int64_t horizon : horizons)
+    {
+        std::uniform_int_distribution<int64_t> dist(0, horizon);
+        for (int i = 0; i < 5000; ++i)
+        {
+            int64_t us = dist(rng);
+            wheel.insert(wheel.allocate([] { }, after(us), 0.0));
+            pending.insert(us);
+        }
+    }
+    BOOST_CHECK_EQUAL(wheel.size(), pending.size());
+
+    int64_t now = 0;
+    int64_t late = 0;
+    std::vector<Timer*> expired;
+    std::uniform_int_distribution<int> shift(0, 42);
+    while (!pending.empty())
+    {
+        // 下一次需要推进的时刻不晚于最早的定时器到期的tick
+        const int64_t earliestTick = (*pending.begin() + kTickUs - 1) / kTickUs;
+        BOOST_REQUIRE(wheel.nextExpiration().microSecondsSinceEpoch() - kStart.microSecondsSinceEpoch()
+                      <= earliestTick * kTickUs);
+
+        const int64_t prev = now;
+        now += std::uniform_int_distribution<int64_t>(1, static_cast<int64_t>(1) << shift(rng))(rng);
+        expired.clear();
+        wheel.advance(after(now), &expired);
+        for (Timer* timer : expired)
+        {
+            const int64_t us = timer->expiration().microSecondsSinceEpoch() - kStart.microSecondsSinceEpoch();
+            BOOST_REQUIRE(us <= now);
+            if (us <= prev - kTickUs)
+            {
+                ++late;
+            }
+            std::multiset<int64_t>::iterator it = pending.find(us);
+            BOOST_REQUIRE(it != pending.end());
+            pending.erase(it);
+            wheel.release(timer);
+        }
+        // 剩下的都还没到期
+        BOOST_REQUIRE(pending.empty() || (*pending.begin() + kTickUs - 1) / kTickUs * kTickUs > now);
+    }
+    BOOST_CHECK_EQUAL(late, 0);
+    BOOST_CHECK_EQUAL(wheel.size(), 0);
+    BOOST_CHECK(!wheel.nextExpiration().valid());
+}
+
+BOOST_AUTO_TEST_CASE(testCancelAndReuse)
+{
+    TimingWheel wheel(kTickUs, kStart);
+    std::vector<Timer*> timers;
+    for (int i = 0; i < 1000; ++i)
+    {
+        timers.push_back(wheel.allocate([] { }, after(i * 10000LL), 0.0));
+        wheel.insert(timers.back());
+    }
+    // 删除一半
+    for (size_t i = 0; i < timers.size(); i += 2)
+    {
+        BOOST_CHECK(wheel.remove(timers[i]));
+        BOOST_CHECK(!wheel.remove(timers[i]));
+    }
+    BOOST_CHECK_EQUAL(wheel.size(), 500);
+
+    std::vector<Timer*> expired;
+    wheel.advance(after(1000 * 10000LL), &expired);
+    BOOST_CHECK_EQUAL(expired.size(), 500);
+    for (size_t i = 0; i < expired.size(); ++i)
+    {
+        // 同一个tick上只有一个定时器，按tick的先后取出
+        BOOST_CHECK(expired[i] == timers[2 * i + 1]);
+    }
+
+    // 释放后复用同一个Timer对象，序号改变，旧的TimerId因此失效
+    for (size_t i = 0; i < timers.size(); i += 2)
+    {
+        wheel.release(timers[i]);
+    }
+    BOOST_CHECK_EQUAL(wheel.pooled(), 500);
+    const int64_t oldSequence = timers[0]->sequence();
+    Timer* reused = wheel.allocate([] { }, after(20000 * 1000LL), 0.0);
+    BOOST_CHECK_EQUAL(wheel.pooled(), 499);
+    BOOST_CHECK(reused->sequence() != oldSequence);
+}
@@ -0,0 +1,113 @@
+//
+// Created by fight on 2023/7/4.
+//
+// 在loopback上比较普通发送和MSG_ZEROCOPY发送：服务端用send(data, owner)不停发送同一块消息，
+// 客户端只计数，对每种消息大小给出吞吐量和零拷贝的完成通知情况。
+//
+// 注意loopback上内核总是拷贝（完成通知带SO_EE_CODE_ZEROCOPY_COPIED），
+// TcpConnection在前若干次通知之后会自动退回普通发送，表中zc sends/copied会体现出来；
+// 真正的收益要在带scatter-gather网卡的两台机器之间才能看到，零拷贝通常在消息大于约10KB后才划算。
+#include "../../base/Logging.h"
+#include "../EventLoop.h"
+#include "../InetAddress.h"
+#include "../TcpClient.h"
+#include "../TcpServer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t kTotal = 1024UL * 1024 * 1024;  // 每轮发送的字节数
+
+EventLoop* g_loop;
+std::shared_ptr<string> g_message;
+bool g_zeroCopy = false;
+size_t g_sent = 0;
+size_t g_received = 0;
+TcpConnectionPtr g_serverConn;
+
+void sendNext(const TcpConnectionPtr& conn)
+{
+    // 每次保持输出队列里有两条消息，避免socket发送缓冲区空转
+    while (g_sent < kTotal && conn->outputBytes() < 2 * g_message->size())
+    {
+        conn->send(StringPiece(*g_message), g_message);
+        g_sent += g_message->size();
+    }
+}
+
+void onServerConnection(const TcpConnectionPtr& conn)
+{
+    if (conn->connected())
+    {
+        g_serverConn = conn;
+        conn->setTcpNoDelay(true);
+        if (g_zeroCopy && !conn->setZeroCopy(true, 4096))
+        {
+            LOG_WARN << "MSG_ZEROCOPY is not supported";
+        }
+        sendNext(conn);
+    }
+}
+
+void onClientMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+{
+    g_received += buf->readableBytes();
+    buf->retrieveAll();
+    if (g_received >= kTotal)
+    {
+        g_loop->quit();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+    uint16_t port = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : 2021;
+    EventLoop loop;
+    g_loop = &loop;
+    InetAddress addr(port, true);
+    TcpServer server(&loop, addr, "ZeroCopyServer");
+    server.setConnectionCallback(onServerConnection);
+    server.setWriteCompleteCallback(sendNext);
+    server.start();
+
+    printf("total %zu MB per run over loopback\n", kTotal / 1024 / 1024);
+    printf("%10s %6s %10s %10s %10s %10s %10s\n",
+           "message", "mode", "MB/s", "cpu(s)", "zc sends", "completed", "copied");
+    for (size_t size = 4096; size <= 4 * 1024 * 1024; size *= 4)
+    {
+        for (int zc = 0; zc < 2; ++zc)
+        {
+            g_message.reset(new string(size, 'z'));
+            g_zeroCopy = zc != 0;
+            g_sent = 0;
+            g_received = 0;
+
+            TcpClient client(&loop, addr, "ZeroCopyClient");
+            client.setMessageCallback(onClientMessage);
+            Timestamp start(Timestamp::now());
+            clock_t cpuStart = ::clock();
+            client.connect();
+            loop.loop();
+            double seconds = timeDifference(Timestamp::now(), start);
+            double cpu = static_cast<double>(::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+            printf("%9zuK %6s %10.1f %10.3f %10lld %10lld %10lld\n",
+                   size / 1024, zc ? "zc" : "copy",
+                   static_cast<double>(g_received) / seconds / 1024 / 1024, cpu,
+                   static_cast<long long>(g_serverConn->zeroCopySends()),
+                   static_cast<long long>(g_serverConn->zeroCopyCompleted()),
+                   static_cast<long long>(g_serverConn->zeroCopyCopied()));
+            g_serverConn->forceClose();
+            g_serverConn.reset();
+            client.disconnect();
+        }
+    }
+    // 处理完最后一轮连接的关闭
+    loop.runAfter(0.1, std::bind(&EventLoop::quit, &loop));
+    loop.loop();
+}